@@ -0,0 +1,70 @@
+﻿#pragma once
+
+#include <sl12/types.h>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+
+struct BenchOptions
+{
+	std::string		mode = "";
+	int				threadCount = 4;
+	int				fillPercent = 99;
+	int				slotCount = 1000000;
+	int				opCount = 1000000;
+	int				seed = 1;
+	long long		pageSize = 16 * 1024 * 1024;
+	std::string		tracePath = "";
+	std::string		saveTracePath = "";
+};	// struct BenchOptions
+
+class StopWatch
+{
+public:
+	StopWatch()
+		: start_(std::chrono::high_resolution_clock::now())
+	{}
+
+	double GetElapsedMs() const
+	{
+		auto now = std::chrono::high_resolution_clock::now();
+		return std::chrono::duration<double, std::milli>(now - start_).count();
+	}
+
+private:
+	std::chrono::high_resolution_clock::time_point	start_;
+};	// class StopWatch
+
+// small and fast random generator. same seed gives same sequence on every platform.
+class BenchRandom
+{
+public:
+	BenchRandom(sl12::u64 seed)
+		: state_(seed * 0x9E3779B97F4A7C15ULL + 1)
+	{}
+
+	sl12::u32 Next()
+	{
+		state_ ^= state_ << 13;
+		state_ ^= state_ >> 7;
+		state_ ^= state_ << 17;
+		return (sl12::u32)(state_ >> 16);
+	}
+	sl12::u32 Next(sl12::u32 range)
+	{
+		return range ? Next() % range : 0;
+	}
+
+private:
+	sl12::u64	state_;
+};	// class BenchRandom
+
+// each returns 0 when succeeded.
+int RunDescriptorBench(const BenchOptions& options);
+int RunBufferHeapBench(const BenchOptions& options);
+int RunSlotMapBench(const BenchOptions& options);
+int RunRingBench(const BenchOptions& options);
+
+
+//	EOF
@@ -0,0 +1,304 @@
+﻿#include "bench.h"
+
+#include <sl12/buffer_heap_allocator.h>
+
+#include <fstream>
+#include <map>
+#include <random>
+#include <vector>
+
+
+namespace
+{
+	static const size_t		kInitHeapSize = 64 * 1024 * 1024;
+	static const size_t		kHeapAlignment = 4;
+	static const sl12::u32	kFrameOpCount = 1000;		// BeginNewFrame interval in generated trace.
+
+	struct TraceOp
+	{
+		enum Type
+		{
+			Alloc,
+			Free,
+			NewFrame,
+		};
+
+		Type		type;
+		sl12::u32	id;				// allocation id. ids are not reused.
+		size_t		size;
+	};	// struct TraceOp
+
+	// mesh streaming like trace. mostly small submeshes, and sometimes a large mesh.
+	std::vector<TraceOp> GenerateTrace(int opCount, int seed)
+	{
+		std::vector<TraceOp> ret;
+		std::mt19937 rng(seed);
+		std::vector<sl12::u32> live;
+		sl12::u32 nextId = 0;
+		for (int op = 0; op < opCount; op++)
+		{
+			if (live.empty() || rng() % 100 < 51)
+			{
+				size_t size = (rng() % 50 == 0) ? rng() % (40 << 20) + 1 : rng() % 100000 + 1;
+				ret.push_back({ TraceOp::Alloc, nextId, size });
+				live.push_back(nextId++);
+			}
+			else
+			{
+				size_t pos = rng() % live.size();
+				ret.push_back({ TraceOp::Free, live[pos], 0 });
+				live[pos] = live.back();
+				live.pop_back();
+			}
+			if (op % kFrameOpCount == 0)
+			{
+				ret.push_back({ TraceOp::NewFrame, 0, 0 });
+			}
+		}
+		return ret;
+	}
+
+	// text format. one op per line.
+	//   a <id> <size> : allocate
+	//   f <id>        : free
+	//   n             : new frame
+	bool LoadTrace(const std::string& filePath, std::vector<TraceOp>& outTrace)
+	{
+		std::ifstream ifs(filePath);
+		if (!ifs.is_open())
+		{
+			return false;
+		}
+
+		std::string type;
+		while (ifs >> type)
+		{
+			TraceOp op{ TraceOp::NewFrame, 0, 0 };
+			if (type == "a")
+			{
+				op.type = TraceOp::Alloc;
+				ifs >> op.id >> op.size;
+			}
+			else if (type == "f")
+			{
+				op.type = TraceOp::Free;
+				ifs >> op.id;
+			}
+			else if (type != "n")
+			{
+				return false;
+			}
+			outTrace.push_back(op);
+		}
+		return true;
+	}
+
+	bool SaveTrace(const std::string& filePath, const std::vector<TraceOp>& trace)
+	{
+		std::ofstream ofs(filePath);
+		if (!ofs.is_open())
+		{
+			return false;
+		}
+
+		for (auto&& op : trace)
+		{
+			if (op.type == TraceOp::Alloc)
+				ofs << "a " << op.id << " " << op.size << "\n";
+			else if (op.type == TraceOp::Free)
+				ofs << "f " << op.id << "\n";
+			else
+				ofs << "n\n";
+		}
+		return true;
+	}
+
+	struct ReplayResult
+	{
+		double								elapsedMs = 0.0;
+		sl12::u64							opCount = 0;
+		float								maxFragmentation = 0.0f;
+		sl12::BufferHeapAllocator::Stats	stats;
+		sl12::u32							createCount = 0;
+		sl12::u32							killCount = 0;
+		bool								isValid = true;
+	};	// struct ReplayResult
+
+	// replay trace on allocator without device.
+	// when isVerify is true, allocated ranges are checked and time is not meaningful.
+	ReplayResult Replay(const std::vector<TraceOp>& trace, size_t pageSize, bool isVerify)
+	{
+		ReplayResult result;
+
+		sl12::BufferHeapAllocator::Hooks hooks;
+		hooks.createBufferFn = [&result](size_t size, sl12::Buffer*& outBuffer, sl12::BufferView*& outSrv)
+		{
+			outBuffer = nullptr;
+			outSrv = nullptr;
+			result.createCount++;
+			return true;
+		};
+		hooks.killBufferFn = [&result](sl12::Buffer* pBuffer, sl12::BufferView* pSrv)
+		{
+			result.killCount++;
+		};
+		hooks.copyBufferFn = [](sl12::CommandList* pCmdList, sl12::Buffer* pDst, sl12::Buffer* pSrc, size_t size)
+		{};
+
+		{
+			sl12::BufferHeapAllocator allocator(hooks, kInitHeapSize, kHeapAlignment, pageSize);
+			std::vector<sl12::BufferHeapAllocator::Handle> handles;
+			std::map<size_t, size_t> ranges;
+
+			StopWatch watch;
+			for (auto&& op : trace)
+			{
+				if (op.type == TraceOp::Alloc)
+				{
+					auto handle = allocator.Allocate(op.size);
+					if (handles.size() <= op.id)
+					{
+						handles.resize(op.id + 1);
+					}
+					handles[op.id] = handle;
+					result.opCount++;
+
+					if (isVerify)
+					{
+						// no overlap with other live allocations.
+						bool isValid = handle.IsValid() && handle.size >= op.size && (handle.offset % kHeapAlignment) == 0;
+						if (isValid && pageSize > 0)
+						{
+							// block is in one page.
+							size_t headLocal, tailLocal;
+							allocator.GetBuffer(handle.offset, headLocal);
+							allocator.GetBuffer(handle.offset + handle.size - 1, tailLocal);
+							isValid = (tailLocal == headLocal + handle.size - 1);
+						}
+						auto next = ranges.lower_bound(handle.offset);
+						if (next != ranges.end() && next->first < handle.offset + handle.size)
+							isValid = false;
+						if (next != ranges.begin() && std::prev(next)->first + std::prev(next)->second > handle.offset)
+							isValid = false;
+						ranges[handle.offset] = handle.size;
+						result.isValid = result.isValid && isValid;
+					}
+				}
+				else if (op.type == TraceOp::Free)
+				{
+					if (op.id >= handles.size() || !handles[op.id].IsValid())
+					{
+						result.isValid = false;
+						continue;
+					}
+					if (isVerify)
+					{
+						ranges.erase(handles[op.id].offset);
+					}
+					allocator.Free(handles[op.id]);
+					handles[op.id] = sl12::BufferHeapAllocator::Handle();
+					result.opCount++;
+				}
+				else
+				{
+					allocator.BeginNewFrame(nullptr);
+					if (isVerify)
+					{
+						result.maxFragmentation = std::max(result.maxFragmentation, allocator.GetStats().GetFragmentation());
+					}
+				}
+			}
+			result.elapsedMs = watch.GetElapsedMs();
+			result.stats = allocator.GetStats();
+
+			// all memory is coalesced after everything is freed.
+			for (auto&& handle : handles)
+			{
+				if (handle.IsValid())
+				{
+					allocator.Free(handle);
+				}
+			}
+			auto stats = allocator.GetStats();
+			if (stats.usedSize != 0 || stats.freeSize != stats.totalSize)
+			{
+				result.isValid = false;
+			}
+			if (pageSize == 0 && stats.freeBlockCount != 1)
+			{
+				result.isValid = false;
+			}
+		}
+
+		// every created buffer is released.
+		if (result.createCount != result.killCount)
+		{
+			result.isValid = false;
+		}
+		return result;
+	}
+}
+
+int RunBufferHeapBench(const BenchOptions& options)
+{
+	std::vector<TraceOp> trace;
+	if (!options.tracePath.empty())
+	{
+		if (!LoadTrace(options.tracePath, trace))
+		{
+			fprintf(stderr, "[ERROR] failed to load trace. (%s)\n", options.tracePath.c_str());
+			return -1;
+		}
+	}
+	else
+	{
+		trace = GenerateTrace(options.opCount, options.seed);
+	}
+	if (!options.saveTracePath.empty() && !SaveTrace(options.saveTracePath, trace))
+	{
+		fprintf(stderr, "[ERROR] failed to save trace. (%s)\n", options.saveTracePath.c_str());
+		return -1;
+	}
+
+	if (options.pageSize < 0 || (options.pageSize % kHeapAlignment) != 0)
+	{
+		fprintf(stderr, "[ERROR] page size must be multiple of %d. (%lld)\n", (int)kHeapAlignment, options.pageSize);
+		return -1;
+	}
+
+	fprintf(stdout, "buffer heap bench : %d trace ops\n", (int)trace.size());
+
+	// contiguous heap, and paged heap if page size is set.
+	int ret = 0;
+	std::vector<size_t> pageSizes = { 0 };
+	if (options.pageSize > 0)
+	{
+		pageSizes.push_back((size_t)options.pageSize);
+	}
+	for (auto pageSize : pageSizes)
+	{
+		auto result = Replay(trace, pageSize, false);
+		auto verify = Replay(trace, pageSize, true);
+		auto&& s = result.stats;
+		if (pageSize == 0)
+			fprintf(stdout, "  contiguous\n");
+		else
+			fprintf(stdout, "  paged (%lldMB pages)\n", (long long)(pageSize >> 20));
+		fprintf(stdout, "    replay   : %8.2f ms, %6.1f ns/op\n", result.elapsedMs, result.elapsedMs * 1e6 / (double)result.opCount);
+		fprintf(stdout, "    heap     : total %lldMB, used %lldMB, free %lldMB, largest free %lldMB, %u pages\n",
+			(long long)(s.totalSize >> 20), (long long)(s.usedSize >> 20), (long long)(s.freeSize >> 20), (long long)(s.largestFreeSize >> 20), s.pageCount);
+		fprintf(stdout, "    blocks   : %u used, %u free, fragmentation %.3f (max %.3f)\n",
+			s.usedBlockCount, s.freeBlockCount, s.GetFragmentation(), verify.maxFragmentation);
+		fprintf(stdout, "    growth   : %u grows, %lldMB copied, %lldMB peak\n",
+			s.growCount, (long long)(s.growCopyBytes >> 20), (long long)(s.growPeakBytes >> 20));
+		if (!result.isValid || !verify.isValid)
+		{
+			fprintf(stderr, "[ERROR] replay found overlapped or leaked block.\n");
+			ret = -1;
+		}
+	}
+	return ret;
+}
+
+
+//	EOF
@@ -0,0 +1,145 @@
+﻿#include "bench.h"
+
+#include <sl12/descriptor_index_allocator.h>
+
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+	static const sl12::u32	kWorkingSetSize = 1024;		// max slots held by a thread at once.
+
+	struct RunResult
+	{
+		double		elapsedMs = 0.0;
+		sl12::u64	opCount = 0;
+		sl12::u64	failCount = 0;
+		bool		isValid = true;
+	};	// struct RunResult
+
+	RunResult RunOnce(const BenchOptions& options, int fillPercent)
+	{
+		RunResult result;
+
+		sl12::DescriptorIndexAllocator allocator;
+		allocator.Initialize((sl12::u32)options.slotCount);
+
+		// fill heap from main thread. these slots are held until the end.
+		std::vector<sl12::u32> prefilled;
+		sl12::u32 prefillCount = (sl12::u32)((sl12::u64)options.slotCount * fillPercent / 100);
+		prefilled.reserve(prefillCount);
+		for (sl12::u32 i = 0; i < prefillCount; i++)
+		{
+			sl12::u32 index;
+			if (!allocator.Allocate(index))
+			{
+				break;
+			}
+			prefilled.push_back(index);
+		}
+
+		// each thread allocates and frees randomly in small working set.
+		std::vector<std::vector<sl12::u32>> heldSlots(options.threadCount);
+		std::vector<sl12::u64> failCounts(options.threadCount, 0);
+		StopWatch watch;
+		{
+			std::vector<std::thread> threads;
+			for (int t = 0; t < options.threadCount; t++)
+			{
+				threads.emplace_back([&, t]()
+				{
+					BenchRandom rand(options.seed + t);
+					auto&& held = heldSlots[t];
+					held.reserve(kWorkingSetSize);
+					for (int op = 0; op < options.opCount; op++)
+					{
+						bool isAlloc = held.empty() || (held.size() < kWorkingSetSize && (rand.Next() & 0x1));
+						if (isAlloc)
+						{
+							sl12::u32 index;
+							if (allocator.Allocate(index))
+								held.push_back(index);
+							else
+								failCounts[t]++;
+						}
+						else
+						{
+							sl12::u32 pos = rand.Next((sl12::u32)held.size());
+							allocator.Free(held[pos]);
+							held[pos] = held.back();
+							held.pop_back();
+						}
+					}
+				});
+			}
+			for (auto&& th : threads)
+			{
+				th.join();
+			}
+		}
+		result.elapsedMs = watch.GetElapsedMs();
+		result.opCount = (sl12::u64)options.opCount * options.threadCount;
+		for (auto&& c : failCounts)
+		{
+			result.failCount += c;
+		}
+
+		// no slot is held twice.
+		std::vector<bool> used(options.slotCount, false);
+		auto Check = [&](sl12::u32 index)
+		{
+			if (index >= (sl12::u32)options.slotCount || used[index])
+			{
+				result.isValid = false;
+				return;
+			}
+			used[index] = true;
+		};
+		for (auto&& index : prefilled)
+		{
+			Check(index);
+			allocator.Free(index);
+		}
+		for (auto&& held : heldSlots)
+		{
+			for (auto&& index : held)
+			{
+				Check(index);
+				allocator.Free(index);
+			}
+		}
+
+		allocator.Destroy();
+		return result;
+	}
+}
+
+int RunDescriptorBench(const BenchOptions& options)
+{
+	if (options.slotCount <= 0 || options.threadCount <= 0 || options.fillPercent < 0 || options.fillPercent > 100)
+	{
+		fprintf(stderr, "[ERROR] invalid options for descriptor bench.\n");
+		return -1;
+	}
+
+	fprintf(stdout, "descriptor bench : %d slots, %d threads, %d ops/thread\n", options.slotCount, options.threadCount, options.opCount);
+
+	int ret = 0;
+	int fills[] = { 0, options.fillPercent };
+	for (auto fill : fills)
+	{
+		auto result = RunOnce(options, fill);
+		fprintf(stdout, "    fill %3d%% : %8.2f ms, %6.1f ns/op, %lld failed\n",
+			fill, result.elapsedMs, result.elapsedMs * 1e6 / (double)result.opCount, (long long)result.failCount);
+		if (!result.isValid)
+		{
+			fprintf(stderr, "[ERROR] same slot is allocated twice. (fill %d%%)\n", fill);
+			ret = -1;
+		}
+	}
+	return ret;
+}
+
+
+//	EOF
@@ -0,0 +1,105 @@
+﻿#include "bench.h"
+
+
+void DisplayHelp()
+{
+	fprintf(stdout, "AllocatorBench : Measure sl12 allocators without GPU device.\n");
+	fprintf(stdout, "options:\n");
+	fprintf(stdout, "    -mode <name>     : bench mode.\n");
+	fprintf(stdout, "                       descriptor : allocate/free descriptor slots on empty and near-full heap.\n");
+	fprintf(stdout, "                       bufferheap : replay allocate/free trace on contiguous and paged mesh buffer heap.\n");
+	fprintf(stdout, "                       slotmap    : stress ConcurrentSlotMap with writer and reader threads. use Debug build to enable asserts.\n");
+	fprintf(stdout, "                       ring       : check copy ring offsets with requests larger than ring.\n");
+	fprintf(stdout, "    -threads <int>   : worker thread count. (default: 4)\n");
+	fprintf(stdout, "    -fill <int>      : heap fill percent before measurement. (default: 99)\n");
+	fprintf(stdout, "    -slots <int>     : descriptor slot count. (default: 1000000)\n");
+	fprintf(stdout, "    -ops <int>       : operation count per thread, generated trace length, or ring frame count. (default: 1000000)\n");
+	fprintf(stdout, "    -seed <int>      : random seed. (default: 1)\n");
+	fprintf(stdout, "    -trace <file>    : trace file to replay. trace is generated if not set.\n");
+	fprintf(stdout, "    -save <file>     : save replayed trace to file.\n");
+	fprintf(stdout, "    -page <int>      : page size of paged buffer heap in bytes. 0 is contiguous only. (default: 16777216)\n");
+	fprintf(stdout, "\n");
+	fprintf(stdout, "example:\n");
+	fprintf(stdout, "    AllocatorBench.exe -mode descriptor -threads 8 -fill 99\n");
+	fprintf(stdout, "    AllocatorBench.exe -mode bufferheap -ops 500000 -seed 7\n");
+	fprintf(stdout, "    AllocatorBench.exe -mode slotmap -threads 8 -ops 200000\n");
+}
+
+int main(int argv, char* argc[])
+{
+	if (argv == 1)
+	{
+		// display help.
+		DisplayHelp();
+		return 0;
+	}
+
+	// get options.
+	BenchOptions options;
+	for (int i = 1; i < argv; i++)
+	{
+		std::string op = argc[i];
+		if ((op[0] == '-' || op[0] == '/') && (i + 1 < argv))
+		{
+			if (op == "-mode" || op == "/mode")
+			{
+				options.mode = argc[++i];
+			}
+			else if (op == "-threads" || op == "/threads")
+			{
+				options.threadCount = std::stoi(argc[++i]);
+			}
+			else if (op == "-fill" || op == "/fill")
+			{
+				options.fillPercent = std::stoi(argc[++i]);
+			}
+			else if (op == "-slots" || op == "/slots")
+			{
+				options.slotCount = std::stoi(argc[++i]);
+			}
+			else if (op == "-ops" || op == "/ops")
+			{
+				options.opCount = std::stoi(argc[++i]);
+			}
+			else if (op == "-seed" || op == "/seed")
+			{
+				options.seed = std::stoi(argc[++i]);
+			}
+			else if (op == "-trace" || op == "/trace")
+			{
+				options.tracePath = argc[++i];
+			}
+			else if (op == "-save" || op == "/save")
+			{
+				options.saveTracePath = argc[++i];
+			}
+			else if (op == "-page" || op == "/page")
+			{
+				options.pageSize = std::stoll(argc[++i]);
+			}
+		}
+	}
+
+	if (options.mode == "descriptor")
+	{
+		return RunDescriptorBench(options);
+	}
+	if (options.mode == "bufferheap")
+	{
+		return RunBufferHeapBench(options);
+	}
+	if (options.mode == "slotmap")
+	{
+		return RunSlotMapBench(options);
+	}
+	if (options.mode == "ring")
+	{
+		return RunRingBench(options);
+	}
+
+	fprintf(stderr, "[ERROR] unknown mode. (%s)\n", options.mode.c_str());
+	return -1;
+}
+
+
+//	EOF
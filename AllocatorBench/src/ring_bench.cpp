@@ -0,0 +1,116 @@
+﻿#include "bench.h"
+
+#include <sl12/ring_offset_allocator.h>
+
+#include <vector>
+
+
+namespace
+{
+	static const sl12::u32	kInitRingSize = 64 * 1024;
+	static const sl12::u32	kCbSize = 256;
+
+	struct Range
+	{
+		sl12::u32	offset;
+		sl12::u32	size;
+	};	// struct Range
+
+	struct RingChecker
+	{
+		sl12::RingOffsetAllocator	allocator{ kInitRingSize };
+		std::vector<Range>			frameRanges;		// ranges in current frame of current ring.
+		sl12::u32					growCount = 0;
+		bool						isValid = true;
+
+		void BeginNewFrame()
+		{
+			allocator.BeginNewFrame();
+			frameRanges.clear();
+		}
+
+		// range must be in ring, and must not overwrite data of current frame.
+		void Allocate(sl12::u32 size)
+		{
+			sl12::u32 newSize;
+			sl12::u32 offset = allocator.Allocate(size, newSize);
+			if (newSize > 0)
+			{
+				// new ring buffer is created. old ranges are in old buffer.
+				growCount++;
+				frameRanges.clear();
+			}
+			if ((sl12::u64)offset + size > allocator.GetSize())
+			{
+				isValid = false;
+			}
+			for (auto&& r : frameRanges)
+			{
+				if (offset < r.offset + r.size && r.offset < offset + size)
+				{
+					isValid = false;
+				}
+			}
+			frameRanges.push_back({ offset, size });
+		}
+	};	// struct RingChecker
+}
+
+int RunRingBench(const BenchOptions& options)
+{
+	if (options.opCount <= 0)
+	{
+		fprintf(stderr, "[ERROR] invalid options for ring bench.\n");
+		return -1;
+	}
+
+	fprintf(stdout, "copy ring check : init %uKB, %d frames\n", kInitRingSize >> 10, options.opCount);
+
+	int ret = 0;
+	auto Report = [&ret](const char* name, const RingChecker& checker)
+	{
+		fprintf(stdout, "    %-24s : %u grows, ring %uKB%s\n", name, checker.growCount, checker.allocator.GetSize() >> 10, checker.isValid ? "" : " [FAILED]");
+		if (!checker.isValid)
+		{
+			ret = -1;
+		}
+	};
+
+	// merged resident cbs on the first frame. (ex. UploadBatcher with 300 cbs)
+	{
+		RingChecker checker;
+		checker.Allocate(300 * kCbSize);
+		Report("first frame over ring", checker);
+	}
+
+	// ring is full from head 0, and next request wraps.
+	{
+		RingChecker checker;
+		checker.Allocate(kInitRingSize / 2);
+		checker.Allocate(kInitRingSize / 2 - 1024);
+		checker.Allocate(4096);
+		Report("wrap on current frame", checker);
+	}
+
+	// random merged uploads over frames, sometimes larger than ring.
+	{
+		RingChecker checker;
+		BenchRandom rand(options.seed);
+		for (int frame = 0; frame < options.opCount; frame++)
+		{
+			checker.BeginNewFrame();
+			sl12::u32 count = rand.Next(8);
+			for (sl12::u32 i = 0; i < count; i++)
+			{
+				sl12::u32 cbCount = (rand.Next(100) == 0) ? rand.Next(2048) + 1 : rand.Next(64) + 1;
+				checker.Allocate(cbCount * kCbSize);
+			}
+		}
+		Report("random frames", checker);
+	}
+
+	return ret;
+}
+
+
+//	EOF
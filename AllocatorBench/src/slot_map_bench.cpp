@@ -0,0 +1,203 @@
+﻿#include "bench.h"
+
+#include <sl12/slot_map.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+	static const sl12::u32	kLiveCountPerThread = 256;		// max ids held by a writer.
+	static const sl12::u32	kRecentCount = 4096;			// published ids shared with readers.
+
+	struct StressItem
+	{
+		std::atomic<sl12::u64>	id{ 0 };
+	};	// struct StressItem
+
+	struct StressCounter
+	{
+		std::atomic<sl12::u64>	errorCount{ 0 };
+		std::atomic<sl12::u64>	readCount{ 0 };
+		std::atomic<sl12::u64>	hitCount{ 0 };
+	};	// struct StressCounter
+
+	// keep max generation freed on each index.
+	void UpdateFreedGeneration(std::atomic<sl12::u32>& freed, sl12::u32 gen)
+	{
+		sl12::u32 prev = freed.load(std::memory_order_relaxed);
+		while (prev < gen && !freed.compare_exchange_weak(prev, gen, std::memory_order_relaxed))
+		{}
+	}
+}
+
+int RunSlotMapBench(const BenchOptions& options)
+{
+	if (options.threadCount <= 0 || options.opCount <= 0)
+	{
+		fprintf(stderr, "[ERROR] invalid options for slot map bench.\n");
+		return -1;
+	}
+
+	using SlotMap = sl12::ConcurrentSlotMap<StressItem>;
+
+	fprintf(stdout, "slot map stress : %d writers, %d readers, %d ops/thread\n", options.threadCount, options.threadCount, options.opCount);
+
+	SlotMap slotMap;
+	StressCounter counter;
+	std::atomic<bool> isWriting{ true };
+
+	// free list is used before new slot, so index never exceeds max live count.
+	sl12::u32 maxSlotCount = kLiveCountPerThread * options.threadCount;
+	std::unique_ptr<std::atomic<sl12::u32>[]> freedGenerations(new std::atomic<sl12::u32>[maxSlotCount]);
+	std::unique_ptr<std::atomic<sl12::u64>[]> recentIds(new std::atomic<sl12::u64>[kRecentCount]);
+	for (sl12::u32 i = 0; i < maxSlotCount; i++)
+	{
+		freedGenerations[i].store(0, std::memory_order_relaxed);
+	}
+	for (sl12::u32 i = 0; i < kRecentCount; i++)
+	{
+		recentIds[i].store(0, std::memory_order_relaxed);
+	}
+
+	auto Error = [&counter](const char* message)
+	{
+		if (counter.errorCount.fetch_add(1) < 16)
+		{
+			fprintf(stderr, "[ERROR] %s\n", message);
+		}
+	};
+
+	// items are never reused, and are alive until readers finish.
+	std::vector<std::unique_ptr<StressItem[]>> itemPools(options.threadCount);
+	for (auto&& pool : itemPools)
+	{
+		pool.reset(new StressItem[options.opCount]);
+	}
+
+	StopWatch watch;
+	{
+		std::vector<std::thread> readers;
+		for (int t = 0; t < options.threadCount; t++)
+		{
+			readers.emplace_back([&, t]()
+			{
+				BenchRandom rand(options.seed * 1000 + t);
+				sl12::u64 reads = 0, hits = 0;
+				while (isWriting.load(std::memory_order_relaxed))
+				{
+					sl12::u64 id = recentIds[rand.Next(kRecentCount)].load(std::memory_order_relaxed);
+					if (id == 0)
+					{
+						continue;
+					}
+
+					// item is never reused, so item id must match when found.
+					StressItem* p = slotMap.Get(id);
+					reads++;
+					if (p)
+					{
+						hits++;
+						if (p->id.load(std::memory_order_relaxed) != id)
+						{
+							Error("Get returned item of other generation.");
+						}
+					}
+				}
+				counter.readCount += reads;
+				counter.hitCount += hits;
+			});
+		}
+
+		std::vector<std::thread> writers;
+		for (int t = 0; t < options.threadCount; t++)
+		{
+			writers.emplace_back([&, t]()
+			{
+				BenchRandom rand(options.seed + t);
+				auto&& items = itemPools[t];
+				std::vector<std::pair<sl12::u64, StressItem*>> live;
+				for (int op = 0; op < options.opCount; op++)
+				{
+					bool isAlloc = live.empty() || (live.size() < kLiveCountPerThread && (rand.Next() & 0x1));
+					if (isAlloc)
+					{
+						sl12::u64 id = slotMap.Allocate();
+						sl12::u32 index = SlotMap::GetIndex(id);
+						sl12::u32 gen = SlotMap::GetGeneration(id);
+						if (index >= maxSlotCount || gen == 0)
+						{
+							Error("Allocate returned invalid id.");
+							continue;
+						}
+						if (gen <= freedGenerations[index].load(std::memory_order_relaxed))
+						{
+							Error("Allocate reused generation of freed slot.");
+						}
+						if (slotMap.Get(id) != nullptr || !slotMap.IsAlive(id))
+						{
+							Error("allocated slot is not empty.");
+						}
+
+						StressItem* p = &items[op];
+						p->id.store(id, std::memory_order_relaxed);
+						if (!slotMap.Publish(id, p) || slotMap.Get(id) != p)
+						{
+							Error("published item is not found.");
+						}
+						recentIds[rand.Next(kRecentCount)].store(id, std::memory_order_relaxed);
+						live.push_back(std::make_pair(id, p));
+					}
+					else
+					{
+						sl12::u32 pos = rand.Next((sl12::u32)live.size());
+						auto v = live[pos];
+						live[pos] = live.back();
+						live.pop_back();
+
+						if (slotMap.Free(v.first) != v.second)
+						{
+							Error("Free returned other item.");
+						}
+						UpdateFreedGeneration(freedGenerations[SlotMap::GetIndex(v.first)], SlotMap::GetGeneration(v.first));
+
+						// freed id is dead forever.
+						if (slotMap.Get(v.first) != nullptr || slotMap.IsAlive(v.first) || slotMap.Publish(v.first, v.second) || slotMap.Free(v.first) != nullptr)
+						{
+							Error("freed id is still alive.");
+						}
+					}
+				}
+
+				for (auto&& v : live)
+				{
+					if (slotMap.Free(v.first) != v.second)
+					{
+						Error("Free returned other item.");
+					}
+				}
+			});
+		}
+
+		for (auto&& th : writers)
+		{
+			th.join();
+		}
+		isWriting.store(false, std::memory_order_relaxed);
+		for (auto&& th : readers)
+		{
+			th.join();
+		}
+	}
+	double elapsedMs = watch.GetElapsedMs();
+
+	fprintf(stdout, "    %8.2f ms, %lld reads (%lld hits), %lld errors\n",
+		elapsedMs, (long long)counter.readCount.load(), (long long)counter.hitCount.load(), (long long)counter.errorCount.load());
+	return counter.errorCount.load() == 0 ? 0 : -1;
+}
+
+
+//	EOF
@@ -145,8 +145,15 @@ bool SampleApplication::Initialize()
 	utilCmdList->Execute();
 	device_.WaitDrawDone();
 
-	// wait compile and load.
-	while (shaderMan_->IsCompiling() || resLoader_->IsLoading())
+	// wait load.
+	// mesh request is complete after its textures are loaded.
+	if (!resLoader_->WaitAll({ hResMesh_ }))
+	{
+		sl12::ConsolePrint("Error: failed to load mesh.");
+	}
+
+	// wait compile.
+	while (shaderMan_->IsCompiling())
 	{
 		std::this_thread::sleep_for(std::chrono::milliseconds(1));
 	}
@@ -252,6 +259,7 @@ bool SampleApplication::Execute()
 	device_.LoadRenderCommands(pCmdList);
 	meshMan_->BeginNewFrame(pCmdList);
 	cbvMan_->BeginNewFrame();
+	resLoader_->BeginNewFrame();
 
 	// texture streaming request.
 	if (bStream)
@@ -0,0 +1,2 @@
+md ../bin/ResourcePacker
+xcopy "..\x64\Release\ResourcePacker.exe" "..\bin\ResourcePacker\" /Y /C
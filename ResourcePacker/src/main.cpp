@@ -0,0 +1,206 @@
+﻿#include <sl12/resource_archive.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+struct ToolOptions
+{
+	std::string		inputPath = "";
+	std::string		outputFilePath = "";
+	int				alignment = sl12::ResourceArchive::kDefaultAlignment;
+};	// struct ToolOptions
+
+struct PackEntry
+{
+	std::string		name;
+	std::string		filePath;
+	sl12::u64		hash;
+	sl12::u64		size;
+};	// struct PackEntry
+
+void DisplayHelp()
+{
+	fprintf(stdout, "ResourcePacker : Pack resource directory to sl12 archive format.\n");
+	fprintf(stdout, "options:\n");
+	fprintf(stdout, "    -i <directory>  : input resource directory. entry names are relative to this directory.\n");
+	fprintf(stdout, "    -o <file_path>  : output archive file path.\n");
+	fprintf(stdout, "    -align <int>    : data alignment in bytes. power of 2. (default: 4096)\n");
+	fprintf(stdout, "\n");
+	fprintf(stdout, "example:\n");
+	fprintf(stdout, "    ResourcePacker.exe -i \"D:/resources/\" -o \"D:/output/resources.pak\"\n");
+}
+
+sl12::u64 AlignUp(sl12::u64 value, sl12::u64 alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void WritePadding(std::ofstream& ofs, sl12::u64 size)
+{
+	static const char kZero[256] = {};
+	while (size > 0)
+	{
+		sl12::u64 s = std::min<sl12::u64>(size, sizeof(kZero));
+		ofs.write(kZero, s);
+		size -= s;
+	}
+}
+
+int main(int argv, char* argc[])
+{
+	if (argv == 1)
+	{
+		// display help.
+		DisplayHelp();
+		return 0;
+	}
+
+	// get options.
+	ToolOptions options;
+	for (int i = 1; i < argv; i++)
+	{
+		std::string op = argc[i];
+		if (op[0] == '-' || op[0] == '/')
+		{
+			if (op == "-i" || op == "/i")
+			{
+				options.inputPath = argc[++i];
+			}
+			else if (op == "-o" || op == "/o")
+			{
+				options.outputFilePath = argc[++i];
+			}
+			else if (op == "-align" || op == "/align")
+			{
+				options.alignment = std::stoi(argc[++i]);
+			}
+		}
+	}
+
+	if (options.inputPath.empty() || options.outputFilePath.empty())
+	{
+		fprintf(stderr, "[ERROR] input and output must be set.\n");
+		return -1;
+	}
+	if (options.alignment <= 0 || (options.alignment & (options.alignment - 1)) != 0)
+	{
+		fprintf(stderr, "[ERROR] alignment must be power of 2. (%d)\n", options.alignment);
+		return -1;
+	}
+
+	// collect files.
+	std::filesystem::path root(options.inputPath);
+	std::filesystem::path output = std::filesystem::absolute(options.outputFilePath).lexically_normal();
+	std::error_code ec;
+	if (!std::filesystem::is_directory(root, ec))
+	{
+		fprintf(stderr, "[ERROR] input directory is not found. (%s)\n", options.inputPath.c_str());
+		return -1;
+	}
+
+	std::vector<PackEntry> entries;
+	for (auto&& it : std::filesystem::recursive_directory_iterator(root))
+	{
+		if (!it.is_regular_file())
+		{
+			continue;
+		}
+		// do not pack output itself.
+		if (std::filesystem::absolute(it.path()).lexically_normal() == output)
+		{
+			continue;
+		}
+
+		PackEntry e;
+		e.name = sl12::ResourceArchive::NormalizePath(it.path().lexically_relative(root).generic_string());
+		e.filePath = it.path().string();
+		e.hash = sl12::ResourceArchive::CalcPathHash(e.name);
+		e.size = (sl12::u64)it.file_size();
+		entries.push_back(e);
+	}
+
+	// entries are searched by hash.
+	std::sort(entries.begin(), entries.end(),
+		[](const PackEntry& l, const PackEntry& r)
+		{
+			if (l.hash != r.hash) return l.hash < r.hash;
+			return l.name < r.name;
+		});
+	auto dup = std::adjacent_find(entries.begin(), entries.end(),
+		[](const PackEntry& l, const PackEntry& r) { return l.name == r.name; });
+	if (dup != entries.end())
+	{
+		fprintf(stderr, "[ERROR] same name after normalization. (%s)\n", dup->name.c_str());
+		return -1;
+	}
+
+	// layout.
+	sl12::ResourceArchiveHeader header{};
+	header.magic = sl12::ResourceArchiveHeader::kMagic;
+	header.version = sl12::ResourceArchiveHeader::kVersion;
+	header.entryCount = (sl12::u32)entries.size();
+	header.alignment = (sl12::u32)options.alignment;
+	header.entryOffset = sizeof(header);
+
+	std::vector<sl12::ResourceArchiveEntry> tocs(entries.size());
+	std::string names;
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		tocs[i].hash = entries[i].hash;
+		tocs[i].nameOffset = (sl12::u32)names.size();
+		tocs[i].nameLength = (sl12::u32)entries[i].name.size();
+		tocs[i].dataSize = entries[i].size;
+		names += entries[i].name;
+	}
+	header.nameOffset = header.entryOffset + sizeof(sl12::ResourceArchiveEntry) * tocs.size();
+	header.nameSize = names.size();
+
+	sl12::u64 offset = AlignUp(header.nameOffset + header.nameSize, options.alignment);
+	for (auto&& toc : tocs)
+	{
+		toc.dataOffset = offset;
+		offset = AlignUp(offset + toc.dataSize, options.alignment);
+	}
+
+	// write.
+	std::ofstream ofs(options.outputFilePath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!ofs.is_open())
+	{
+		fprintf(stderr, "[ERROR] failed to open output file. (%s)\n", options.outputFilePath.c_str());
+		return -1;
+	}
+	ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	ofs.write(reinterpret_cast<const char*>(tocs.data()), sizeof(sl12::ResourceArchiveEntry) * tocs.size());
+	ofs.write(names.data(), names.size());
+
+	sl12::u64 written = header.nameOffset + header.nameSize;
+	std::vector<char> buffer;
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		WritePadding(ofs, tocs[i].dataOffset - written);
+		written = tocs[i].dataOffset;
+
+		std::ifstream ifs(entries[i].filePath, std::ios::in | std::ios::binary);
+		if (!ifs.is_open())
+		{
+			fprintf(stderr, "[ERROR] failed to read file. (%s)\n", entries[i].filePath.c_str());
+			return -1;
+		}
+		buffer.resize(tocs[i].dataSize);
+		ifs.read(buffer.data(), buffer.size());
+		ofs.write(buffer.data(), buffer.size());
+		written += tocs[i].dataSize;
+	}
+	ofs.close();
+
+	fprintf(stdout, "packed %d files. (%lld bytes)\n", (int)entries.size(), (long long)written);
+
+	return 0;
+}
+
+
+//	EOF
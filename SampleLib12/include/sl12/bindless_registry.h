@@ -0,0 +1,100 @@
+﻿#pragma once
+
+#include <sl12/util.h>
+#include <sl12/descriptor_heap.h>
+#include <sl12/death_list.h>
+
+#include <mutex>
+#include <vector>
+
+
+namespace sl12
+{
+	class Device;
+
+	//----------------
+	// index in bindless registry. generation is used to detect stale handle.
+	struct BindlessHandle
+	{
+		static const u32	kInvalidIndex = 0xffffffff;
+
+		u32		index = kInvalidIndex;
+		u32		generation = 0;
+
+		bool IsValid() const
+		{
+			return index != kInvalidIndex;
+		}
+	};	// struct BindlessHandle
+
+	//----------------
+	// Persistent shader visible descriptor range for bindless srv.
+	// view descriptors are copied once at registration, and whole range is bound as one table.
+	class BindlessRegistry
+	{
+		struct FreeItem
+			: public PendingKillItem
+		{
+			BindlessRegistry*	pRegistry = nullptr;
+			u32					index = 0;
+
+			FreeItem(BindlessRegistry* r, u32 i)
+				: pRegistry(r), index(i)
+			{}
+			~FreeItem()
+			{
+				pRegistry->FreeIndex(index);
+			}
+		};	// struct FreeItem
+
+	public:
+		BindlessRegistry()
+		{}
+		~BindlessRegistry()
+		{
+			Destroy();
+		}
+
+		bool Initialize(Device* pDev, GlobalDescriptorHeap* pHeap, u32 maxCount);
+		void Destroy();
+
+		// copy view descriptor to registry and return stable index.
+		BindlessHandle Register(D3D12_CPU_DESCRIPTOR_HANDLE srcHandle);
+		// generation is updated immediately, index is reused after GPU finished.
+		void Unregister(BindlessHandle& handle);
+
+		bool IsValid(const BindlessHandle& handle);
+
+		// getter
+		D3D12_GPU_DESCRIPTOR_HANDLE GetTableGpuHandle() const
+		{
+			return gpuHandleStart_;
+		}
+		u32 GetMaxCount() const
+		{
+			return maxCount_;
+		}
+		u32 GetRegisteredCount() const
+		{
+			return registeredCount_;
+		}
+
+	private:
+		void FreeIndex(u32 index);
+
+	private:
+		Device*						pParentDevice_ = nullptr;
+		D3D12_CPU_DESCRIPTOR_HANDLE	cpuHandleStart_{};
+		D3D12_GPU_DESCRIPTOR_HANDLE	gpuHandleStart_{};
+		u32							descSize_ = 0;
+		u32							maxCount_ = 0;
+		u32							registeredCount_ = 0;
+
+		std::mutex					mutex_;
+		std::vector<u32>			generations_;
+		std::vector<u32>			freeIndices_;
+	};	// class BindlessRegistry
+
+}	// namespace sl12
+
+//	EOF
@@ -0,0 +1,180 @@
+﻿#pragma once
+
+#include <sl12/util.h>
+#include <sl12/buffer.h>
+#include <sl12/buffer_view.h>
+#include <vector>
+#include <memory>
+#include <functional>
+
+
+namespace sl12
+{
+	class CommandList;
+
+	//----
+	// TLSF (two level segregated fit) allocator on GPU buffer.
+	// free blocks are listed by size class, and Allocate/Free are O(1).
+	// block nodes are pooled in vector and reused.
+	//
+	// pageSize == 0 : one buffer. growth creates larger buffer and copies whole buffer on GPU.
+	// pageSize > 0  : heap is made of page buffers. growth adds pages without copy.
+	//                 blocks never cross pages, and allocation larger than page size gets its own page.
+	//
+	// gpu buffers are created and released through Hooks, so block management can run without device.
+	class BufferHeapAllocator
+	{
+		friend class MeshManager;
+
+		static const u32	kInvalidBlock = 0xffffffff;
+		static const u32	kSLCountLog2 = 4;
+		static const u32	kSLCount = 1 << kSLCountLog2;
+		static const u32	kFLShift = kSLCountLog2 + 4;			// blocks smaller than 256 bytes are in first level 0.
+		static const u32	kFLCount = 48 - kFLShift + 1;			// up to 256TB.
+		static const size_t	kSmallBlockSize = (size_t)1 << kFLShift;
+		static const u32	kMaxPageTableCount = 4096;
+
+		struct Block
+		{
+			size_t	offset = 0;
+			size_t	size = 0;
+			u32		prevPhys = kInvalidBlock;
+			u32		nextPhys = kInvalidBlock;
+			u32		prevFree = kInvalidBlock;
+			u32		nextFree = kInvalidBlock;
+			bool	isUsed = false;
+		};	// struct Block
+
+		struct Page
+		{
+			Buffer*		pBuffer = nullptr;
+			BufferView*	pSrv = nullptr;
+			size_t		offset = 0;				// in heap.
+			size_t		size = 0;
+		};	// struct Page
+
+	public:
+		// gpu buffer operations. MeshManager sets functions working on device.
+		struct Hooks
+		{
+			// create buffer and its srv. returns false if failed.
+			std::function<bool(size_t size, Buffer*& outBuffer, BufferView*& outSrv)>				createBufferFn;
+			// release buffer and srv after gpu finished using them.
+			std::function<void(Buffer* pBuffer, BufferView* pSrv)>									killBufferFn;
+			// copy size bytes from head of src buffer to head of dst buffer.
+			std::function<void(CommandList* pCmdList, Buffer* pDst, Buffer* pSrc, size_t size)>	copyBufferFn;
+		};	// struct Hooks
+
+		struct Handle
+		{
+			const BufferHeapAllocator*	heap = nullptr;
+			size_t						offset = 0;
+			size_t						size = 0;
+			u32							block = kInvalidBlock;		// for O(1) free.
+
+			bool IsValid() const
+			{
+				return heap != nullptr;
+			}
+		};	// struct Handle
+
+		struct Stats
+		{
+			size_t	totalSize = 0;
+			size_t	usedSize = 0;
+			size_t	freeSize = 0;
+			size_t	largestFreeSize = 0;
+			u32		usedBlockCount = 0;
+			u32		freeBlockCount = 0;
+			u32		pageCount = 0;
+
+			// growth cost.
+			u32		growCount = 0;
+			size_t	growCopyBytes = 0;			// copied on GPU by growth. 0 in paged mode.
+			size_t	growPeakBytes = 0;			// max buffer memory alive at growth. old and new buffers in non paged mode.
+
+			// 0 : free memory is one block. near 1 : free memory is split into small blocks.
+			float GetFragmentation() const
+			{
+				return freeSize ? 1.0f - (float)largestFreeSize / (float)freeSize : 0.0f;
+			}
+		};	// struct Stats
+
+	public:
+		BufferHeapAllocator(const Hooks& hooks, size_t initSize, size_t align, size_t pageSize = 0);
+		~BufferHeapAllocator();
+
+		Handle Allocate(size_t inSize);
+		void Free(Handle handle);
+
+		void BeginNewFrame(CommandList* pCmdList);
+
+		bool IsPaged() const
+		{
+			return pageSize_ > 0;
+		}
+
+		// whole heap buffer. nullptr in paged mode.
+		Buffer* GetBuffer()
+		{
+			return pBuffer_;
+		}
+
+		// buffer and srv including heap offset. these are page buffer in paged mode.
+		Buffer* GetBuffer(size_t offset, size_t& outLocalOffset) const;
+		BufferView* GetBufferSRV(size_t offset, size_t& outLocalOffset) const;
+		D3D12_GPU_VIRTUAL_ADDRESS GetGpuAddress(size_t offset) const;
+
+		Stats GetStats() const;
+
+	private:
+		bool CreateNewBuffer(size_t alignedSize);
+		u32 CreateNewPage(size_t alignedSize);
+		const Page& FindPage(size_t offset) const;
+
+		static void Mapping(size_t size, u32& fl, u32& sl);
+		u32 NewBlock();
+		void DeleteBlock(u32 index);
+		void InsertFreeBlock(u32 index);
+		void RemoveFreeBlock(u32 index);
+		u32 FindFreeBlock(size_t size) const;
+
+	private:
+		Hooks			hooks_;
+		Buffer*			pBuffer_ = nullptr;
+		BufferView*		pBufferSrv_ = nullptr;
+		size_t			bufferSize_ = 0;
+		Buffer*			pNextBuffer_ = nullptr;			// grown buffer. replaces pBuffer_ in BeginNewFrame.
+		BufferView*		pNextBufferSrv_ = nullptr;
+		size_t			nextBufferSize_ = 0;			// 0 if not grown.
+		size_t			initSize_ = 0;
+		size_t			alignment_ = 0;
+
+		// pages are fixed array, and readers access them without lock.
+		size_t						pageSize_ = 0;
+		std::unique_ptr<Page[]>		pages_;
+		std::unique_ptr<u32[]>		pageTable_;			// heap offset / page size to page index.
+		u32							pageCount_ = 0;
+		u32							pageTableCount_ = 0;
+
+		std::vector<Block>	blocks_;
+		std::vector<u32>	unusedBlocks_;
+		u32					tailBlock_ = kInvalidBlock;
+		u64					flBitmap_ = 0;
+		u32					slBitmaps_[kFLCount] = {};
+		u32					freeHeads_[kFLCount][kSLCount];
+
+		size_t				totalSize_ = 0;
+		size_t				usedSize_ = 0;
+		size_t				freeSize_ = 0;
+		u32					usedBlockCount_ = 0;
+		u32					freeBlockCount_ = 0;
+		u32					growCount_ = 0;
+		size_t				growCopyBytes_ = 0;
+		size_t				growPeakBytes_ = 0;
+	};	// class BufferHeapAllocator
+
+}	// namespace sl12
+
+
+//	EOF
@@ -2,6 +2,7 @@
 
 #include <sl12/util.h>
 #include <sl12/descriptor_heap.h>
+#include <sl12/bindless_registry.h>
 
 
 namespace sl12
@@ -24,6 +25,10 @@ namespace sl12
 		bool Initialize(Device* pDev, Buffer* pBuffer, size_t offset = 0, size_t size = 0);
 		void Destroy();
 
+		// rewrite allocated descriptors to point other range.
+		// descriptors are not reallocated, so GPU must not reference previous range.
+		void UpdateView(Device* pDev, Buffer* pBuffer, size_t offset, size_t size);
+
 		// getter
 		DescriptorInfo& GetDescInfo() { return descInfo_; }
 		const DescriptorInfo& GetDescInfo() const { return descInfo_; }
@@ -106,11 +111,15 @@ namespace sl12
 		const DescriptorInfo& GetDescInfo() const { return descInfo_; }
 		DescriptorInfo& GetDynamicDescInfo() { return dynamicDescInfo_; }
 		const DescriptorInfo& GetDynamicDescInfo() const { return dynamicDescInfo_; }
+		const BindlessHandle& GetBindlessHandle() const { return bindlessHandle_; }
+		u32 GetBindlessIndex() const { return bindlessHandle_.index; }
 
 	private:
 		D3D12_SHADER_RESOURCE_VIEW_DESC	viewDesc_;
 		DescriptorInfo					descInfo_;
 		DescriptorInfo					dynamicDescInfo_;
+		BindlessRegistry*				pBindless_ = nullptr;
+		BindlessHandle					bindlessHandle_;
 	};	// class BufferView
 
 }	// namespace sl12
@@ -2,11 +2,14 @@
 
 #include <list>
 #include <map>
+#include <unordered_map>
 #include <mutex>
+#include <thread>
 #include <sl12/ring_buffer.h>
 #include <sl12/buffer_suballocator.h>
 #include <sl12/unique_handle.h>
 #include <sl12/buffer_view.h>
+#include <sl12/upload_batcher.h>
 
 
 namespace sl12
@@ -28,6 +31,7 @@ namespace sl12
 		UniqueHandle<ConstantBufferView>	view_;
 		u32									allocSize_;
 		u8									pendingCount_ = 0;
+		bool								isLinear_ = false;
 	};  // class CbvInstance
 
 	
@@ -72,12 +76,45 @@ namespace sl12
 	{
 		friend class CbvHandle;
 
-		struct CopyRequest
+		static const u32	kLinearPageSize = 64 * 1024;
+		static const u32	kLinearPageSlotCount = kLinearPageSize / D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+
+		// persistently mapped upload page for temporal cbs.
+		struct LinearPage
 		{
-			CopyRingBuffer::Result	copySrc;
-			CbvInstance*			copyDst;
-		};	// struct CopyRequest
-		
+			UniqueHandle<Buffer>		buffer;
+			u8*							pMapped = nullptr;
+			std::vector<CbvInstance*>	instances;
+			u32							offset = 0;
+			u32							instanceCount = 0;
+			u8							pendingCount = 0;
+
+			~LinearPage();
+		};	// struct LinearPage
+
+		// linear allocation state of a recording thread.
+		struct LinearContext
+		{
+			LinearPage*					pCurrentPage = nullptr;
+			std::vector<LinearPage*>	usedPages;
+
+			// payload hash to instance. for dedupe mode.
+			std::unordered_map<u64, CbvInstance*>	dedupeMap;
+			u32							requestCount = 0;
+			u32							hitCount = 0;
+			u64							requestBytes = 0;
+			u64							savedBytes = 0;
+		};	// struct LinearContext
+
+	public:
+		struct TemporalStats
+		{
+			u32		requestCount = 0;	// number of GetTemporal calls.
+			u32		hitCount = 0;		// number of calls that reused a cbv.
+			u64		requestBytes = 0;	// total size of requested data.
+			u64		savedBytes = 0;		// upload size saved by dedupe.
+		};	// struct TemporalStats
+
 	public:
 		CbvManager(Device* pDev);
 		~CbvManager();
@@ -85,13 +122,42 @@ namespace sl12
 		void BeginNewFrame();
 		
 		CbvHandle GetResident(size_t size);
+
+		// temporal cb is available in current frame only.
+		// each thread bump-allocates from its own page without locking.
 		CbvHandle GetTemporal(const void* pData, size_t size);
 
+		// if enabled, same payload in a frame returns the same temporal cbv.
+		void SetTemporalDedupe(bool enable)
+		{
+			isTemporalDedupe_ = enable;
+		}
+		bool IsTemporalDedupe() const
+		{
+			return isTemporalDedupe_;
+		}
+		// temporal stats of last frame.
+		const TemporalStats& GetTemporalStats() const
+		{
+			return lastTemporalStats_;
+		}
+
 		void RequestResidentCopy(CbvHandle& Handle, const void* pData, size_t size);
 		void ExecuteCopy(CommandList* pCmdList, bool bTransition = true);
 
+		// copy request/command count of last ExecuteCopy.
+		const UploadBatcher::Stats& GetCopyStats() const
+		{
+			return uploadBatcher_->GetLastStats();
+		}
+
 	private:
 		void ReturnInstance(CbvInstance* Instance);
+
+		CbvHandle GetTemporalFromPool(const void* pData, size_t size);
+
+		LinearContext* GetLinearContext();
+		LinearPage* AcquireLinearPage();
 		
 	private:
 		Device*     pParentDevice_ = nullptr;
@@ -99,14 +165,22 @@ namespace sl12
 		UniqueHandle<BufferSuballocAllocator>   residentAllocator_;
 		UniqueHandle<BufferSuballocAllocator>   temporalAllocator_;
 		UniqueHandle<CopyRingBuffer>            ringBuffer_;
+		UniqueHandle<UploadBatcher>				uploadBatcher_;
 
 		std::map<u32, std::list<CbvInstance*>>	residentUnused_;
 		std::map<u32, std::list<CbvInstance*>>	temporalUnused_;
 		std::vector<CbvInstance*>				pendingInstances_;
-
-		std::vector<CopyRequest>				copyRequests_;
 		
 		std::mutex								mutex_;
+
+		u64										managerId_ = 0;
+		std::map<std::thread::id, std::unique_ptr<LinearContext>>	linearContexts_;
+		std::vector<LinearPage*>				linearFreePages_;
+		std::vector<LinearPage*>				linearPendingPages_;
+		std::mutex								linearMutex_;
+
+		bool									isTemporalDedupe_ = false;
+		TemporalStats							lastTemporalStats_;
 	};  // class CbvManager
 
 }   // namespace sl12
@@ -151,6 +151,22 @@ namespace sl12
 		LatestCommandList* GetDxrCommandList() { return pLatestCmdList_; }
 		//ID3D12GraphicsCommandList4* GetDxrCommandList() { return pDxrCmdList_; }
 
+	private:
+		// copy view descriptors to view stack and return gpu handle of the table.
+		// same table in this command list is reused without copy.
+		D3D12_GPU_DESCRIPTOR_HANDLE CopyViewDescriptorTable(u32 count, const D3D12_CPU_DESCRIPTOR_HANDLE* handles);
+
+	private:
+		static const u32	kViewTableCacheSize = 64;
+
+		struct ViewTableCacheEntry
+		{
+			u64							hash = 0;
+			u32							keyOffset = 0;
+			u32							count = 0;
+			D3D12_GPU_DESCRIPTOR_HANDLE	gpuHandle{};
+		};	// struct ViewTableCacheEntry
+
 	private:
 		Device*						pParentDevice_{ nullptr };
 		CommandQueue*				pParentQueue_{ nullptr };
@@ -164,6 +180,10 @@ namespace sl12
 		ID3D12DescriptorHeap*		pPrevSamplerHeap_{ nullptr };
 		bool						changeHeap_{ true };
 
+		ViewTableCacheEntry							viewTableCache_[kViewTableCacheSize];
+		std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>	viewTableKeys_;			// view handles of cached tables.
+		std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>	viewHandleScratch_;
+
 		std::vector<D3D12_RESOURCE_BARRIER>	requestBarriers_;
 	};	// class CommandList
 
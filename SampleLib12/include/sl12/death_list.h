@@ -1,23 +1,170 @@
 ﻿#pragma once
 
 #include <sl12/util.h>
-#include <list>
+#include <atomic>
+#include <mutex>
+#include <vector>
 #include <sl12/swapchain.h>
 
 
 namespace sl12
 {
+	//----------------
+	// fixed size block pool for kill items.
+	// free blocks are in lock free stack. head is (tag << 32) | (block index + 1), and tag is changed on every update against ABA.
+	// blocks are allocated by chunk, and are not freed until pool is destroyed.
+	class PendingKillItemPool
+	{
+	public:
+		static const size_t	kBlockSize = 64;
+
+		static void* Alloc(size_t size)
+		{
+			if (size > kBlockSize)
+			{
+				return ::operator new(size);
+			}
+			return GetPool().Pop();
+		}
+
+		static void Free(void* p, size_t size)
+		{
+			if (size > kBlockSize)
+			{
+				::operator delete(p);
+				return;
+			}
+			GetPool().Push(p);
+		}
+
+	private:
+		struct Pool
+		{
+			static const u32	kChunkShift = 8;
+			static const u32	kChunkSize = 1 << kChunkShift;
+			static const u32	kMaxChunks = 4096;
+			static const u32	kInvalidIndex = 0xffffffff;
+			static const size_t	kHeaderSize = 16;					// block index, and padding for alignment.
+			static const size_t	kStride = kHeaderSize + kBlockSize;
+
+			struct alignas(16) Chunk
+			{
+				std::atomic<u32>	next[kChunkSize];				// next free block index + 1. 0 is end.
+				u8					blocks[kChunkSize * kStride];
+			};	// struct Chunk
+
+			std::atomic<u64>		head{ 0 };
+			std::atomic<u32>		blockCount{ 0 };
+			std::atomic<Chunk*>		chunks[kMaxChunks];
+			std::mutex				chunkMutex;
+
+			Pool()
+			{
+				for (auto&& chunk : chunks)
+				{
+					chunk.store(nullptr, std::memory_order_relaxed);
+				}
+			}
+			~Pool()
+			{
+				for (auto&& chunk : chunks)
+				{
+					delete chunk.load(std::memory_order_relaxed);
+				}
+			}
+
+			std::atomic<u32>& GetNext(u32 index)
+			{
+				return chunks[index >> kChunkShift].load(std::memory_order_acquire)->next[index & (kChunkSize - 1)];
+			}
+			u8* GetBlock(u32 index)
+			{
+				return chunks[index >> kChunkShift].load(std::memory_order_acquire)->blocks + (index & (kChunkSize - 1)) * kStride;
+			}
+
+			void* Pop()
+			{
+				u64 h = head.load(std::memory_order_acquire);
+				while (h & 0xffffffff)
+				{
+					// next may be changed by other threads, but then tag is also changed and exchange fails.
+					u32 index = (u32)h - 1;
+					u64 newHead = (((h >> 32) + 1) << 32) | GetNext(index).load(std::memory_order_relaxed);
+					if (head.compare_exchange_weak(h, newHead, std::memory_order_acquire, std::memory_order_acquire))
+					{
+						return GetBlock(index) + kHeaderSize;
+					}
+				}
+				return NewBlock();
+			}
+
+			void Push(void* p)
+			{
+				u8* block = (u8*)p - kHeaderSize;
+				u32 index = *(u32*)block;
+				if (index == kInvalidIndex)
+				{
+					::operator delete(block);
+					return;
+				}
+
+				u64 h = head.load(std::memory_order_relaxed);
+				u64 newHead;
+				do
+				{
+					GetNext(index).store((u32)h, std::memory_order_relaxed);
+					newHead = (((h >> 32) + 1) << 32) | (index + 1);
+				} while (!head.compare_exchange_weak(h, newHead, std::memory_order_release, std::memory_order_relaxed));
+			}
+
+			void* NewBlock()
+			{
+				u32 index = blockCount.fetch_add(1, std::memory_order_relaxed);
+				if ((index >> kChunkShift) >= kMaxChunks)
+				{
+					// pool is full. this block is not pooled.
+					u8* block = (u8*)::operator new(kStride);
+					*(u32*)block = kInvalidIndex;
+					return block + kHeaderSize;
+				}
+
+				auto&& chunk = chunks[index >> kChunkShift];
+				if (!chunk.load(std::memory_order_acquire))
+				{
+					std::lock_guard<std::mutex> lock(chunkMutex);
+					if (!chunk.load(std::memory_order_relaxed))
+					{
+						chunk.store(new Chunk(), std::memory_order_release);
+					}
+				}
+
+				u8* block = GetBlock(index);
+				*(u32*)block = index;
+				return block + kHeaderSize;
+			}
+		};	// struct Pool
+
+		static Pool& GetPool()
+		{
+			static Pool sPool;
+			return sPool;
+		}
+	};	// class PendingKillItemPool
+
 	struct PendingKillItem
 	{
-		int		pendingTime = 0;
+		PendingKillItem*	pNext = nullptr;
 
 		virtual ~PendingKillItem()
 		{}
 
-		bool CanKill()
+		static void* operator new(size_t size)
 		{
-			pendingTime--;
-			return pendingTime <= 0;
+			return PendingKillItemPool::Alloc(size);
+		}
+		static void operator delete(void* p, size_t size)
+		{
+			PendingKillItemPool::Free(p, size);
 		}
 	};	// struct PendingKillItem
 
@@ -51,8 +198,19 @@ namespace sl12
 		}
 	};
 
+	//----------------
+	// Items are pushed from any thread, and killed after kMaxBuffer frames.
+	// SyncKill must be called from one thread.
 	class DeathList
 	{
+		static const u32	kBucketCount = sl12::Swapchain::kMaxBuffer;
+
+		struct Bucket
+		{
+			PendingKillItem*	pHead = nullptr;
+			PendingKillItem*	pTail = nullptr;
+		};	// struct Bucket
+
 	public:
 		DeathList()
 		{}
@@ -63,37 +221,45 @@ namespace sl12
 
 		void Destroy()
 		{
-			auto it = items_.begin();
-			while (it != items_.end())
+			// killing items may push new items.
+			while (true)
 			{
-				auto p = *it;
-				it = items_.erase(it);
-				SafeDelete(p);
-			}
-		}
+				MoveQueueToBucket(buckets_[0]);
 
-		void SyncKill()
-		{
-			auto it = items_.begin();
-			while (it != items_.end())
-			{
-				auto p = *it;
-				if (p->CanKill())
+				bool isEmpty = true;
+				for (auto&& bucket : buckets_)
 				{
-					it = items_.erase(it);
-					SafeDelete(p);
+					if (bucket.pHead)
+					{
+						isEmpty = false;
+						KillBucket(bucket);
+					}
 				}
-				else
+				if (isEmpty)
 				{
-					it++;
+					break;
 				}
 			}
 		}
 
+		void SyncKill()
+		{
+			// items pushed in this frame.
+			MoveQueueToBucket(buckets_[frameCount_ % kBucketCount]);
+
+			// kill items pushed kMaxBuffer frames ago.
+			KillBucket(buckets_[(frameCount_ + 1) % kBucketCount]);
+			frameCount_++;
+		}
+
+		// lock free.
 		void PendingKill(PendingKillItem* p)
 		{
-			p->pendingTime = sl12::Swapchain::kMaxBuffer;
-			items_.push_back(p);
+			auto head = queueHead_.load(std::memory_order_relaxed);
+			do
+			{
+				p->pNext = head;
+			} while (!queueHead_.compare_exchange_weak(head, p, std::memory_order_release, std::memory_order_relaxed));
 		}
 
 		template <typename T>
@@ -104,7 +270,52 @@ namespace sl12
 		}
 
 	private:
-		std::list<PendingKillItem*>		items_;
+		void MoveQueueToBucket(Bucket& bucket)
+		{
+			auto p = queueHead_.exchange(nullptr, std::memory_order_acquire);
+			if (!p)
+			{
+				return;
+			}
+
+			// reverse to keep pushed order.
+			PendingKillItem* pHead = nullptr;
+			PendingKillItem* pTail = p;
+			while (p)
+			{
+				auto next = p->pNext;
+				p->pNext = pHead;
+				pHead = p;
+				p = next;
+			}
+
+			if (bucket.pTail)
+			{
+				bucket.pTail->pNext = pHead;
+			}
+			else
+			{
+				bucket.pHead = pHead;
+			}
+			bucket.pTail = pTail;
+		}
+
+		void KillBucket(Bucket& bucket)
+		{
+			auto p = bucket.pHead;
+			bucket.pHead = bucket.pTail = nullptr;
+			while (p)
+			{
+				auto next = p->pNext;
+				delete p;
+				p = next;
+			}
+		}
+
+	private:
+		std::atomic<PendingKillItem*>	queueHead_{ nullptr };
+		Bucket							buckets_[kBucketCount];
+		u64								frameCount_ = 0;
 	};	// class DeathList
 
 }	// namespace sl12
@@ -1,11 +1,14 @@
 ﻿#pragma once
 
 #include <sl12/util.h>
+#include <sl12/descriptor_index_allocator.h>
 #include <mutex>
 #include <atomic>
 #include <vector>
 #include <map>
 #include <list>
+#include <memory>
+#include <thread>
 
 
 namespace sl12
@@ -82,19 +85,21 @@ namespace sl12
 			return pHeap_;
 		}
 
+		// number of slots taken from heap. includes slots in thread caches.
+		u32 GetAllocCount() const
+		{
+			return indexAllocator_.GetAllocCount();
+		}
+
 	private:
-		std::mutex					mutex_;
 		ID3D12DescriptorHeap*		pHeap_ = nullptr;
 		D3D12_DESCRIPTOR_HEAP_DESC	heapDesc_{};
 		D3D12_CPU_DESCRIPTOR_HANDLE cpuHandleStart_;
 		D3D12_GPU_DESCRIPTOR_HANDLE gpuHandleStart_;
-		u8*							pUseFlags_ = nullptr;
 		u32							descSize_ = 0;
-		u32							allocCount_ = 0;
-		u32							currentPosition_ = 0;
+		DescriptorIndexAllocator	indexAllocator_;
 	};	// class DescriptorAllocator
 
-
 	class DescriptorStack
 	{
 		friend class GlobalDescriptorHeap;
@@ -122,6 +127,9 @@ namespace sl12
 
 	class DescriptorStackList
 	{
+	public:
+		static const u32	kStackSize = 4096;
+
 	public:
 		DescriptorStackList()
 		{}
@@ -129,22 +137,43 @@ namespace sl12
 		{}
 
 		bool Initialilze(class GlobalDescriptorHeap* parent);
+		void Destroy();
 
+		// owner command list is recorded by one thread, so no lock is needed except adding stack.
 		void Allocate(u32 count, D3D12_CPU_DESCRIPTOR_HANDLE& cpuHandle, D3D12_GPU_DESCRIPTOR_HANDLE& gpuHandle);
 
+		// call after GPU finished the previous recording.
+		// stacks not used in the previous recording are returned to parent heap.
 		void Reset();
 
+		// peak number of descriptors used in a recording.
+		u32 GetPeakUsage() const
+		{
+			return peakUsage_;
+		}
+
 	private:
-		bool AddStack();
+		bool AddStack(u32 count);
 
 	private:
 		class GlobalDescriptorHeap*		pParentHeap_ = nullptr;
 		std::vector<DescriptorStack>	stacks_;
 		u32								stackIndex_ = 0;
+		u32								usage_ = 0;
+		u32								peakUsage_ = 0;
 	};	// class DescriptorStackList
 
 	class GlobalDescriptorHeap
 	{
+	public:
+		struct Stats
+		{
+			u32		totalCount = 0;			// number of descriptors in heap.
+			u32		reservedCount = 0;		// number of descriptors carved out for stacks.
+			u32		usedCount = 0;			// number of descriptors held by stack lists.
+			u32		peakUsedCount = 0;		// peak of usedCount.
+		};	// struct Stats
+
 	public:
 		GlobalDescriptorHeap()
 		{}
@@ -157,6 +186,9 @@ namespace sl12
 		void Destroy();
 
 		bool AllocateStack(DescriptorStack& stack, u32 count);
+		void FreeStack(const DescriptorStack& stack);
+
+		Stats GetStats();
 
 		// getter
 		ID3D12DescriptorHeap* GetHeap() { return pHeap_; }
@@ -169,6 +201,9 @@ namespace sl12
 		D3D12_GPU_DESCRIPTOR_HANDLE gpuHandleStart_;
 		u32							descSize_ = 0;
 		u32							allocCount_ = 0;
+		u32							usedCount_ = 0;
+		u32							peakUsedCount_ = 0;
+		std::vector<DescriptorStack>	freeStacks_;
 	};	// class GlobalDescriptorHeap
 
 	class SamplerDescriptorHeap
@@ -200,12 +235,15 @@ namespace sl12
 	class SamplerDescriptorCache
 	{
 	private:
-		struct MapItem
+		// open addressing table entry. count 0 is empty.
+		struct CacheEntry
 		{
+			u64							hash = 0;
+			u32							keyOffset = 0;
+			u32							count = 0;
 			SamplerDescriptorHeap*		pHeap = nullptr;
-			D3D12_CPU_DESCRIPTOR_HANDLE	cpuHandle;
 			D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle;
-		};	// struct MapItem
+		};	// struct CacheEntry
 
 	public:
 		SamplerDescriptorCache()
@@ -216,7 +254,13 @@ namespace sl12
 		bool Initialize(Device* pDev);
 		void Destroy();
 
-		bool AllocateAndCopy(u32 count, D3D12_CPU_DESCRIPTOR_HANDLE* cpuHandles, D3D12_GPU_DESCRIPTOR_HANDLE& gpuHandle);
+		// thread safe.
+		bool AllocateAndCopy(u32 count, const D3D12_CPU_DESCRIPTOR_HANDLE* cpuHandles, D3D12_GPU_DESCRIPTOR_HANDLE& gpuHandle, ID3D12DescriptorHeap*& pHeap);
+		// heap can be got by GetHeap().
+		bool AllocateAndCopy(u32 count, const D3D12_CPU_DESCRIPTOR_HANDLE* cpuHandles, D3D12_GPU_DESCRIPTOR_HANDLE& gpuHandle);
+
+		// register sampler tables before rendering.
+		bool Prewarm(const std::vector<std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>>& tables);
 
 		// getter
 		ID3D12DescriptorHeap* GetHeap()
@@ -227,13 +271,19 @@ namespace sl12
 
 	private:
 		bool AddHeap();
+		CacheEntry* FindEntry(u64 hash, u32 count, const D3D12_CPU_DESCRIPTOR_HANDLE* cpuHandles);
+		void InsertEntry(const CacheEntry& entry);
 
 	private:
 		Device*													pParentDevice_ = nullptr;
 		std::vector<std::unique_ptr<SamplerDescriptorHeap>>		heapList_;
 		SamplerDescriptorHeap*									pLastAllocateHeap_ = nullptr;
 		SamplerDescriptorHeap*									pCurrentHeap_ = nullptr;
-		std::map<u32, MapItem>									descCache_;
+
+		std::mutex									mutex_;
+		std::vector<CacheEntry>						table_;			// size is power of 2.
+		u32											entryCount_ = 0;
+		std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>	keys_;			// sampler handles of all entries.
 	};	// class SamplerDescriptorCache
 
 
@@ -0,0 +1,88 @@
+﻿#pragma once
+
+#include <sl12/types.h>
+#include <mutex>
+#include <map>
+#include <memory>
+#include <thread>
+
+
+namespace sl12
+{
+	//----------------
+	// slot index allocator for descriptor heaps.
+	// free slots are managed by bitset, and each thread reserves some slots to own cache.
+	// this class does not depend on device, so cpu only tools can use it.
+	class DescriptorIndexAllocator
+	{
+		static const u32	kThreadCacheSize = 64;
+		static const u32	kThreadCacheRefill = 32;
+
+		// descriptor slots reserved by a thread.
+		// mutex is locked by owner thread on every access, and is contended only when other threads drain it.
+		struct ThreadCache
+		{
+			std::mutex	mutex;
+			u32			count = 0;
+			u32			indices[kThreadCacheSize];
+		};	// struct ThreadCache
+
+		// thread local lookup table. returns cached slots to allocators when thread exits.
+		struct ThreadEntries;
+
+	public:
+		DescriptorIndexAllocator()
+		{}
+		~DescriptorIndexAllocator()
+		{
+			Destroy();
+		}
+
+		bool Initialize(u32 slotCount);
+		void Destroy();
+
+		bool IsInitialized() const
+		{
+			return pFreeBits_ != nullptr;
+		}
+
+		// allocate a slot.
+		// when bitset has no free slot, slots reserved by other threads are drained.
+		bool Allocate(u32& index);
+		void Free(u32 index);
+
+		u32 GetSlotCount() const
+		{
+			return slotCount_;
+		}
+		// number of slots taken from bitset. includes slots in thread caches.
+		u32 GetAllocCount() const
+		{
+			return allocCount_;
+		}
+
+	private:
+		ThreadCache* GetThreadCache();
+		void ReleaseThreadCache(std::thread::id threadId);
+		u32 DrainThreadCaches(ThreadCache* pSelf, u32* pIndices, u32 count);
+		bool AllocateIndex(u32& index);
+		void FreeIndex(u32 index);
+
+	private:
+		std::mutex			mutex_;
+		u64*				pFreeBits_ = nullptr;		// 1 bit per slot. 1 is free.
+		u64*				pSummaryBits_ = nullptr;	// 1 bit per pFreeBits_ word. 1 if word has free slot.
+		u32					wordCount_ = 0;
+		u32					summaryCount_ = 0;
+		u32					slotCount_ = 0;
+		u32					allocCount_ = 0;
+		u32					currentPosition_ = 0;		// word index to start search.
+
+		u64					allocatorId_ = 0;			// 0 means not initialized.
+		std::map<std::thread::id, std::unique_ptr<ThreadCache>>	threadCaches_;
+	};	// class DescriptorIndexAllocator
+
+}	// namespace sl12
+
+
+//	EOF
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include <array>
+#include <atomic>
 #include <list>
 #include <memory>
 #include <mutex>
@@ -24,17 +25,43 @@ namespace sl12
 	class TextureView;
 	class CopyRingBuffer;
 	class TextureStreamAllocator;
+	class BindlessRegistry;
+
+	struct RenderCommandPhase
+	{
+		enum Type
+		{
+			Copy,			// copy to new resources only. loaded before other commands.
+			Default,
+
+			Max
+		};
+	};	// struct RenderCommandPhase
 
 	struct IRenderCommand
 	{
+		IRenderCommand*		pNext = nullptr;
+
 		virtual ~IRenderCommand()
 		{}
 
 		virtual void LoadCommand(CommandList* pCmdlist) = 0;
+
+		// called after all commands in same phase are loaded.
+		// use CommandList::AddTransitionBarrier to batch barriers.
+		virtual void LoadBarrier(CommandList* pCmdlist)
+		{}
+
+		virtual RenderCommandPhase::Type GetPhase() const
+		{
+			return RenderCommandPhase::Default;
+		}
 	};	// struct IRenderCommand
 
 	struct IQueueCommand
 	{
+		IQueueCommand*		pNext = nullptr;
+
 		virtual ~IQueueCommand()
 		{}
 
@@ -76,6 +103,7 @@ namespace sl12
 		u32				featureFlags = FeatureFlag::All;
 		bool			enableDebugLayer = true;
 		bool			enableDynamicResource = false;
+		u32				numBindless = 65536;	// descriptor count of bindless registry. 0 is disabled.
 	};
 
 	class Device
@@ -115,35 +143,20 @@ namespace sl12
 			deathList_.KillObject<T>(p);
 		}
 
+		// lock free. can be called from any thread.
 		void AddRenderCommand(std::unique_ptr<IRenderCommand>& rc)
 		{
-			std::lock_guard<std::mutex> lock(renderCommandMutex_);
-			renderCommands_.push_back(std::move(rc));
-		}
-		void LoadRenderCommands(CommandList* pCmdlist)
-		{
-			std::lock_guard<std::mutex> lock(renderCommandMutex_);
-			for (auto&& rc : renderCommands_)
-			{
-				rc->LoadCommand(pCmdlist);
-			}
-			renderCommands_.clear();
+			PushCommand(renderCommandHead_, rc.release());
 		}
+		// load commands by phase order. commands added while loading are loaded next time.
+		void LoadRenderCommands(CommandList* pCmdlist);
 
+		// lock free. can be called from any thread.
 		void AddQueueCommand(std::unique_ptr<IQueueCommand>& rc)
 		{
-			std::lock_guard<std::mutex> lock(queueCommandMutex_);
-			queueCommands_.push_back(std::move(rc));
-		}
-		void ExecuteQueueCommands()
-		{
-			std::lock_guard<std::mutex> lock(queueCommandMutex_);
-			for (auto&& qc : queueCommands_)
-			{
-				qc->ExecuteCommand(pGraphicsQueue_);
-			}
-			queueCommands_.clear();
+			PushCommand(queueCommandHead_, rc.release());
 		}
+		void ExecuteQueueCommands();
 
 		// getter
 		IDXGIFactory4*	GetFactoryDep()
@@ -198,6 +211,10 @@ namespace sl12
 		{
 			return *pGlobalViewDescHeap_;
 		}
+		BindlessRegistry* GetBindlessRegistry()
+		{
+			return pBindlessRegistry_;
+		}
 		DescriptorAllocator& GetViewDescriptorHeap()
 		{
 			return *pViewDescHeap_;
@@ -255,8 +272,41 @@ namespace sl12
 
 		void CopyToBuffer(CommandList* pCmdList, Buffer* pDstBuffer, u32 dstOffset, const void* pSrcData, u32 srcSize);
 
+		// ring buffer used by CopyToBuffer. for UploadBatcher.
+		CopyRingBuffer* GetCopyRingBuffer()
+		{
+			return pRingBuffer_.get();
+		}
+
 		void CaptureGPUonPIX(const std::string& filename);
 
+	private:
+		// intrusive multi producer single consumer list.
+		template <typename T>
+		static void PushCommand(std::atomic<T*>& head, T* p)
+		{
+			auto h = head.load(std::memory_order_relaxed);
+			do
+			{
+				p->pNext = h;
+			} while (!head.compare_exchange_weak(h, p, std::memory_order_release, std::memory_order_relaxed));
+		}
+		// take all commands in pushed order.
+		template <typename T>
+		static T* PopAllCommands(std::atomic<T*>& head)
+		{
+			T* p = head.exchange(nullptr, std::memory_order_acquire);
+			T* ret = nullptr;
+			while (p)
+			{
+				T* next = static_cast<T*>(p->pNext);
+				p->pNext = ret;
+				ret = p;
+				p = next;
+			}
+			return ret;
+		}
+
 	private:
 		IDXGIFactory7*	pFactory_{ nullptr };
 		IDXGIAdapter4*	pAdapter_{ nullptr };
@@ -287,6 +337,7 @@ namespace sl12
 		DescriptorAllocator*	pDynamicSamplerDescHeap_ = nullptr;
 		DescriptorAllocator*	pRtvDescHeap_ = nullptr;
 		DescriptorAllocator*	pDsvDescHeap_ = nullptr;
+		BindlessRegistry*		pBindlessRegistry_ = nullptr;
 
 		DescriptorInfo	defaultViewDescInfo_;
 		DescriptorInfo	defaultSamplerDescInfo_;
@@ -303,11 +354,10 @@ namespace sl12
 
 		DeathList		deathList_;
 
-		std::mutex									renderCommandMutex_;
-		std::list<std::unique_ptr<IRenderCommand>>	renderCommands_;
+		std::atomic<IRenderCommand*>				renderCommandHead_{ nullptr };
+		std::vector<IRenderCommand*>				renderCommandPhases_[RenderCommandPhase::Max];
 
-		std::mutex									queueCommandMutex_;
-		std::list<std::unique_ptr<IQueueCommand>>	queueCommands_;
+		std::atomic<IQueueCommand*>					queueCommandHead_{ nullptr };
 
 		std::unique_ptr<CopyRingBuffer>				pRingBuffer_;
 		std::unique_ptr<TextureStreamAllocator>		pTextureStreamAllocator_;
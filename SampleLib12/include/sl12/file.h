@@ -25,6 +25,7 @@ namespace sl12
 		{
 			std::ifstream fin;
 
+			Destroy();
 			fin.open(filename, std::ios::in | std::ios::binary | std::ios::ate);
 			if (!fin.is_open())
 			{
@@ -42,18 +43,58 @@ namespace sl12
 			return true;
 		}
 
+		// read a part of file.
+		bool ReadFileRange(const char* filename, uint64_t offset, uint64_t size)
+		{
+			std::ifstream fin;
+
+			Destroy();
+			fin.open(filename, std::ios::in | std::ios::binary | std::ios::ate);
+			if (!fin.is_open())
+			{
+				return false;
+			}
+
+			uint64_t fileSize = static_cast<uint64_t>(fin.tellg());
+			if (offset + size > fileSize)
+			{
+				return false;
+			}
+			fin.seekg(offset, std::ios::beg);
+
+			size_ = size;
+			data_.reset(new uint8_t[size_]);
+			fin.read(reinterpret_cast<char*>(data_.get()), size_);
+
+			fin.close();
+
+			return true;
+		}
+
+		// refer external memory without copy. (ex. memory mapped archive)
+		// memory must be valid while this object refers it.
+		void AttachMemory(void* pData, uint64_t size)
+		{
+			Destroy();
+			pView_ = pData;
+			size_ = size;
+		}
+
 		void Destroy()
 		{
 			data_.reset(nullptr);
+			pView_ = nullptr;
 			size_ = 0;
 		}
 
 		// getter
-		void* GetData() { return data_.get(); }
+		void* GetData() { return data_ ? data_.get() : pView_; }
 		uint64_t GetSize() { return size_; }
+		bool IsView() const { return pView_ != nullptr; }
 
 	private:
 		std::unique_ptr<uint8_t[]>	data_{};
+		void*						pView_{ nullptr };
 		uint64_t					size_{ 0 };
 	};	// File
 
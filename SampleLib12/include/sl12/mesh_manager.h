@@ -3,8 +3,8 @@
 #include <sl12/util.h>
 #include <sl12/buffer.h>
 #include <sl12/buffer_view.h>
+#include <sl12/buffer_heap_allocator.h>
 #include <vector>
-#include <list>
 #include <memory>
 #include <mutex>
 
@@ -15,89 +15,59 @@ namespace sl12
 	class CommandList;
 
 	//----
-	class BufferHeapAllocator
+	// deployed data is written to staging (upload heap) memory, and copied to heaps in BeginNewFrame.
+	class MeshManager
 	{
-		friend class MeshManager;
-
-		struct Block
-		{
-			size_t	offset = 0;
-			size_t	size = 0;
-			bool	isUsed = false;
-
-			Block()
-			{}
-			Block(size_t _offset, size_t _size, bool _isUsed)
-				: offset(_offset), size(_size), isUsed(_isUsed)
-			{}
-		};	// struct Block
-
-	public:
-		struct Handle
-		{
-			const BufferHeapAllocator*	heap = nullptr;
-			size_t						offset = 0;
-			size_t						size = 0;
+		static const size_t	kStagingPageSize = 16 * 1024 * 1024;
+		static const size_t	kStagingAlignment = 16;
 
-			bool IsValid() const
-			{
-				return heap != nullptr;
-			}
-		};	// struct Handle
-
-	public:
-		BufferHeapAllocator(Device* pDev, size_t initSize, size_t align, u32 usage);
-		~BufferHeapAllocator();
-
-		Handle Allocate(size_t inSize);
-		void Free(Handle handle);
-
-		void BeginNewFrame(CommandList* pCmdList);
-
-		Buffer* GetBuffer()
+		struct StagingPage
 		{
-			return pBuffer_;
-		}
+			Buffer*		pBuffer = nullptr;
+			u8*			pMapped = nullptr;
+			size_t		size = 0;
+			size_t		usedSize = 0;
+			u32			pendingCount = 0;		// deploys not finished by caller.
+			u64			retiredFrame = 0;
+		};	// struct StagingPage
 
-	private:
-		bool CreateNewBuffer(size_t alignedSize);
-
-	private:
-		Device*			pParentDevice_ = nullptr;
-		Buffer*			pBuffer_ = nullptr;
-		Buffer*			pNextBuffer_ = nullptr;
-		BufferView*		pBufferSrv_ = nullptr;
-		size_t			initSize_ = 0;
-		size_t			alignment_ = 0;
-		u32				usage_;
-
-		std::list<Block>	memoryBlocks_;
-	};	// class BufferHeapAllocator
-
-	//----
-	class MeshManager
-	{
 		struct CopySrc
 		{
-			std::vector<u8>	src;
-			size_t			offset;
+			StagingPage*	pStaging;
+			size_t			stagingOffset;
+			size_t			size;
+			size_t			offset;				// in heap.
+			bool			isReady;
 		};	// struct CopySrc
 
 	public:
 		using Handle = BufferHeapAllocator::Handle;
 
 	public:
-		MeshManager(Device* pDev, size_t vertexSize, size_t indexSize);
+		// pageSize > 0 : vertex and index heaps are paged. (see BufferHeapAllocator)
+		MeshManager(Device* pDev, size_t vertexSize, size_t indexSize, size_t pageSize = 0);
 		~MeshManager();
 
 		void BeginNewFrame(CommandList* pCmdList);
 
+		// copy data to staging memory. (ex. mapped file memory)
 		Handle DeployVertexBuffer(const void* pData, size_t size);
 		Handle DeployIndexBuffer(const void* pData, size_t size);
 
+		// caller writes data to returned staging memory directly, and calls EndDeploy.
+		// staging memory is write combined. do not read from it.
+		// unfinished deploys are not copied, and EndDeploy is needed before release even if writing failed.
+		void* BeginDeployVertexBuffer(size_t size, Handle& outHandle);
+		void* BeginDeployIndexBuffer(size_t size, Handle& outHandle);
+		void EndDeploy(const Handle& handle);
+
 		void ReleaseVertexBuffer(Handle handle);
 		void ReleaseIndexBuffer(Handle handle);
 
+		BufferHeapAllocator::Stats GetVertexHeapStats();
+		BufferHeapAllocator::Stats GetIndexHeapStats();
+
+		// whole heap srv. nullptr in paged mode, use BufferHeapAllocator::GetBufferSRV with handle.
 		BufferView* GetVertexBufferSRV()
 		{
 			return pVertexHeap_->pBufferSrv_;
@@ -110,7 +80,7 @@ namespace sl12
 		static D3D12_VERTEX_BUFFER_VIEW CreateVertexView(const Handle& handle, size_t additionalOffset, size_t size, size_t stride)
 		{
 			D3D12_VERTEX_BUFFER_VIEW ret;
-			ret.BufferLocation = handle.heap->pBuffer_->GetResourceDep()->GetGPUVirtualAddress() + handle.offset + additionalOffset;
+			ret.BufferLocation = handle.heap->GetGpuAddress(handle.offset) + additionalOffset;
 			ret.SizeInBytes = size == 0 ? (UINT)handle.size : (UINT)size;
 			ret.StrideInBytes = (UINT)stride;
 			return ret;
@@ -118,12 +88,16 @@ namespace sl12
 		static D3D12_INDEX_BUFFER_VIEW CreateIndexView(const Handle& handle, size_t additionalOffset, size_t size, size_t stride)
 		{
 			D3D12_INDEX_BUFFER_VIEW ret;
-			ret.BufferLocation = handle.heap->pBuffer_->GetResourceDep()->GetGPUVirtualAddress() + handle.offset + additionalOffset;
+			ret.BufferLocation = handle.heap->GetGpuAddress(handle.offset) + additionalOffset;
 			ret.SizeInBytes = size == 0 ? (UINT)handle.size : (UINT)size;
 			ret.Format = (stride == 4) ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
 			return ret;
 		}
 
+	private:
+		u8* DeployNoLock(BufferHeapAllocator* pHeap, std::vector<CopySrc>& src, size_t size, bool isReady, Handle& outHandle);
+		StagingPage* AllocateStaging(size_t size, size_t& outOffset);
+
 	private:
 		Device*			pParentDevice_ = nullptr;
 		std::mutex		mutex_;
@@ -131,8 +105,14 @@ namespace sl12
 		std::unique_ptr<BufferHeapAllocator>	pVertexHeap_;
 		std::unique_ptr<BufferHeapAllocator>	pIndexHeap_;
 
-		std::vector<std::unique_ptr<CopySrc>>	vertexSrc_;
-		std::vector<std::unique_ptr<CopySrc>>	indexSrc_;
+		std::vector<CopySrc>	vertexSrc_;
+		std::vector<CopySrc>	indexSrc_;
+
+		// last page is used for new deploys.
+		std::vector<std::unique_ptr<StagingPage>>	stagingPages_;
+		// retired pages in retired order. reused after GPU finished.
+		std::vector<std::unique_ptr<StagingPage>>	freeStagingPages_;
+		u64											frameCount_ = 0;
 	};	// class MeshManager
 
 }	// namespace sl12
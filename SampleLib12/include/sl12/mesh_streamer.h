@@ -0,0 +1,66 @@
+﻿#pragma once
+
+#include "sl12/types.h"
+#include "sl12/resource_loader.h"
+
+
+namespace sl12
+{
+	class Device;
+
+	//--------
+	// streams submeshes of partial mesh on demand. (ResourceItemMesh::LoadFunctionPartial)
+	// submeshes not requested for a while are evicted.
+	class MeshStreamer
+	{
+	public:
+		MeshStreamer()
+		{}
+		~MeshStreamer();
+
+		bool Initialize(Device* pDevice);
+		void Destroy();
+
+		// request submesh used in this frame. if not resident, it is loaded on streaming thread.
+		void RequestSubmesh(ResourceHandle handle, u32 submeshIndex);
+
+		// advance frame, and evict submeshes not requested in unusedFrameCount frames.
+		// call on render thread before submesh streams are used.
+		void BeginNewFrame(u32 unusedFrameCount);
+
+		u32 GetTrackedSubmeshCount() const
+		{
+			std::lock_guard<std::mutex> lock(listMutex_);
+			return (u32)trackedMap_.size();
+		}
+
+	private:
+		bool ThreadBody();
+
+	private:
+		using Key = std::pair<u64, u32>;		// handle id, submesh index.
+
+		struct TrackItem
+		{
+			ResourceHandle	handle;
+			u32				submeshIndex;
+			u64				lastRequestedFrame;
+			bool			isRequested;
+		};	// struct TrackItem
+
+		Device*				pDevice_ = nullptr;
+		u64					currentFrame_ = 0;
+
+		std::mutex					requestMutex_;
+		mutable std::mutex			listMutex_;
+		std::condition_variable		requestCV_;
+		std::thread					loadingThread_;
+		std::list<Key>				requestList_;
+		std::map<Key, TrackItem>	trackedMap_;		// guarded by listMutex_.
+		bool						isAlive_ = false;
+	};	// class MeshStreamer
+
+}	// namespace sl12
+
+
+//	EOF
@@ -0,0 +1,89 @@
+﻿#pragma once
+
+#include "sl12/util.h"
+#include <string>
+
+
+namespace sl12
+{
+	// packed archive layout.
+	//   header | entries (sorted by hash) | name table | data (aligned)
+	struct ResourceArchiveHeader
+	{
+		static const u32	kMagic = 0x4b504c53;	// "SLPK"
+		static const u32	kVersion = 1;
+
+		u32		magic;
+		u32		version;
+		u32		entryCount;
+		u32		alignment;
+		u64		entryOffset;
+		u64		nameOffset;
+		u64		nameSize;
+	};	// struct ResourceArchiveHeader
+
+	struct ResourceArchiveEntry
+	{
+		u64		hash;			// hash of normalized path.
+		u64		dataOffset;		// from file head.
+		u64		dataSize;
+		u32		nameOffset;		// from name table head.
+		u32		nameLength;
+	};	// struct ResourceArchiveEntry
+
+	//----------------
+	// memory mapped read only archive.
+	class ResourceArchive
+	{
+	public:
+		static const u32	kDefaultAlignment = 4096;
+
+		ResourceArchive()
+		{}
+		~ResourceArchive()
+		{
+			Close();
+		}
+
+		bool Open(const std::string& filePath);
+		void Close();
+
+		// find entry. returned memory is valid until Close.
+		// NOTE: pages are mapped as copy on write, writing to data does not modify archive.
+		bool Find(const std::string& path, void** ppData, u64* pSize) const;
+
+		// touch pages of entry data.
+		void Prefetch(const void* pData, u64 size) const;
+
+		u32 GetEntryCount() const
+		{
+			return pHeader_ ? pHeader_->entryCount : 0;
+		}
+		const std::string& GetFilePath() const
+		{
+			return filePath_;
+		}
+
+		// lower case, '/' separated, and relative.
+		static std::string NormalizePath(const std::string& path);
+		static u64 CalcPathHash(const std::string& normalizedPath)
+		{
+			return CalcMurmur64(normalizedPath.data(), normalizedPath.size());
+		}
+
+	private:
+		std::string		filePath_;
+		HANDLE			hFile_ = INVALID_HANDLE_VALUE;
+		HANDLE			hMapping_ = nullptr;
+		u8*				pMapped_ = nullptr;
+		u64				mappedSize_ = 0;
+
+		const ResourceArchiveHeader*	pHeader_ = nullptr;
+		const ResourceArchiveEntry*		pEntries_ = nullptr;
+		const char*						pNames_ = nullptr;
+	};	// class ResourceArchive
+
+}	// namespace sl12
+
+
+//	EOF
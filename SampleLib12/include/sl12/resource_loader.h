@@ -1,15 +1,21 @@
 ﻿#pragma once
 
 #include "sl12/types.h"
+#include "sl12/resource_archive.h"
 
 #include <atomic>
 #include <list>
 #include <map>
 #include <mutex>
 #include <condition_variable>
+#include <functional>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "mesh_manager.h"
+#include "slot_map.h"
+#include "file.h"
 
 
 namespace sl12
@@ -23,6 +29,18 @@ namespace sl12
 		return ((u32(s[0]) << 24) | (u32(s[1]) << 16) | (u32(s[2]) << 8) | (u32(s[3]) << 0));
 	}
 
+	struct ResourceLoadPriority
+	{
+		enum Type
+		{
+			High,
+			Normal,
+			Low,
+
+			Max
+		};
+	};	// struct ResourceLoadPriority
+
 	class ResourceHandle
 	{
 		friend class ResourceLoader;
@@ -41,6 +59,11 @@ namespace sl12
 			return id_;
 		}
 
+		ResourceLoader* GetLoader() const
+		{
+			return pParentLoader_;
+		}
+
 		const ResourceItemBase* GetItemBase() const;
 
 		template <typename T>
@@ -67,6 +90,7 @@ namespace sl12
 	class ResourceItemBase
 	{
 		friend class ResourceLoader;
+		friend class ResourceHandle;
 
 	public:
 		static const u32 kType = TYPE_FOURCC("BASE");
@@ -90,12 +114,39 @@ namespace sl12
 			return typeID_;
 		}
 
+		// memory cost for residency.
+		virtual u64 GetCpuMemorySize() const
+		{
+			return 0;
+		}
+		virtual u64 GetGpuMemorySize() const
+		{
+			return 0;
+		}
+
+		// last frame accessed through ResourceHandle.
+		u64 GetLastUsedFrame() const
+		{
+			return lastUsedFrame_.load(std::memory_order_relaxed);
+		}
+
+	protected:
+		// dependencies are released with this item.
+		void AddDependency(const ResourceHandle& handle)
+		{
+			dependencies_.push_back(handle);
+		}
+
 	protected:
 		ResourceLoader* pParentLoader_ = nullptr;
 		ResourceHandle	handle_;
 		std::string		filePath_;
 		std::string		fullPath_;
 		u32				typeID_;
+
+	private:
+		std::vector<ResourceHandle>	dependencies_;
+		mutable std::atomic<u64>	lastUsedFrame_ = 0;
 	};	// class ResourceItemBase
 
 	//----
@@ -116,24 +167,98 @@ namespace sl12
 
 	public:
 		typedef ResourceItemBase*	(*LoadFunc)(ResourceLoader*, ResourceHandle, const std::string&);
+		typedef std::function<void(const ResourceHandle& handle, bool isSuccess)>	CompletionCallback;
+
+		// read ahead limits between io and decode stage.
+		static const u32	kMaxPrefetchCount = 32;
+		static const u64	kMaxPrefetchBytes = 256 * 1024 * 1024;
 
+		struct Stats
+		{
+			u64		ioCount = 0;				// number of prefetched files.
+			u64		ioBytes = 0;				// total size of prefetched files.
+			float	ioTime = 0.0f;				// total read time in io stage. (ms)
+			u64		decodeCount = 0;			// number of load functions called.
+			float	decodeTime = 0.0f;			// total load function time in decode stage. (ms)
+			u32		ioQueueCount = 0;			// requests waiting read.
+			u32		decodeQueueCount = 0;		// requests waiting decode.
+			u32		peakDecodeQueueCount = 0;
+			u64		prefetchBytes = 0;			// read but not decoded bytes.
+			u64		archiveHitCount = 0;		// files found in mounted archives.
+		};	// struct Stats
+
+	public:
 		ResourceLoader()
 		{}
 		~ResourceLoader();
 
-		bool Initialize(Device* pDevice, MeshManager* pMeshMan, const std::string& basePath);
+		// numThreads == 0 : use (hardware threads - 1) decode workers.
+		// numIoThreads : number of reads in flight.
+		bool Initialize(Device* pDevice, MeshManager* pMeshMan, const std::string& basePath, u32 numThreads = 0, u32 numIoThreads = 2);
 		void Destroy();
 
 		std::string MakeFullPath(const std::string& filePath);
 
-		ResourceHandle LoadRequest(const std::string& filepath, LoadFunc func);
+		// open file for load function.
+		// if file was prefetched in io stage, it is returned without reading.
+		// mounted archives are searched before base path. files in archive refer mapped memory.
+		std::unique_ptr<File> OpenFile(const std::string& filePath);
+		// open a part of file. (ex. on demand streaming)
+		// this is not prefetched, and can be called from any thread.
+		std::unique_ptr<File> OpenFileRange(const std::string& filePath, u64 offset, u64 size);
+
+		// mount packed archive. archives are searched in mount order.
+		// archives must not be unmounted while loading.
+		bool MountArchive(const std::string& archivePath);
+		void UnmountAllArchives();
+
+		// same path and function returns the same handle and adds reference.
+		// requests from load functions use parent priority if it is higher.
+		ResourceHandle LoadRequest(const std::string& filepath, LoadFunc func, ResourceLoadPriority::Type priority = ResourceLoadPriority::Normal);
 
 		template <typename T>
-		ResourceHandle LoadRequest(const std::string& filepath)
+		ResourceHandle LoadRequest(const std::string& filepath, ResourceLoadPriority::Type priority = ResourceLoadPriority::Normal)
+		{
+			return LoadRequest(filepath, T::LoadFunction, priority);
+		}
+
+		// cancel request. this releases one reference.
+		// if loading is already started, loaded item is discarded.
+		bool CancelRequest(const ResourceHandle& handle);
+
+		// release one reference.
+		// item is killed through device when the last reference is released.
+		void ReleaseResource(const ResourceHandle& handle);
+
+		// add one reference to an item which is not released yet.
+		// returns false if the item is already released. (ex. keep item alive while streaming into it)
+		bool AddReference(const ResourceHandle& handle);
+
+		u32 GetRefCount(const ResourceHandle& handle) const;
+
+		// completion.
+		// a request is complete when the item and all of its dependencies are loaded.
+		// callback is called on loader thread. if already finished, it is called immediately.
+		// if request failed or is released before completion, isSuccess is false.
+		void AddCompletionCallback(const ResourceHandle& handle, CompletionCallback func);
+
+		bool IsComplete(const ResourceHandle& handle) const;
+
+		// block until requests are finished. return true if all requests are complete.
+		bool Wait(const ResourceHandle& handle);
+		bool WaitAll(const std::vector<ResourceHandle>& handles);
+
+		// run tasks on decode threads. caller also runs tasks, and returns when all tasks are finished.
+		// load functions use this to split heavy work. (ex. stream decompression)
+		void ParallelRun(std::vector<std::function<void()>>& tasks);
+
+		u32 GetThreadCount() const
 		{
-			return LoadRequest(filepath, T::LoadFunction);
+			return (u32)loadingThreads_.size();
 		}
 
+		Stats GetStats() const;
+
 		Device* GetDevice()
 		{
 			return pDevice_;
@@ -146,12 +271,28 @@ namespace sl12
 
 		bool IsLoading() const
 		{
-			return !requestList_.empty() || isLoading_;
+			return pendingCount_ > 0;
 		}
 
-	private:
-		bool ThreadBody();
-		const ResourceItemBase* GetItemBaseFromID(u64 id) const;
+		// residency.
+		// budget 0 : items are killed when the last reference is released.
+		// otherwise, unreferenced items stay resident and are evicted in LRU order over budget.
+		void SetMemoryBudget(u64 bytes);
+		u64 GetMemoryBudget() const
+		{
+			return memoryBudget_;
+		}
+		u64 GetResidentMemorySize() const
+		{
+			return residentMemorySize_;
+		}
+
+		// recalculate memory size of loaded item. items call this when their size is changed. (ex. streaming)
+		// over budget items are evicted on next BeginNewFrame.
+		void UpdateMemorySize(const ResourceHandle& handle);
+
+		// advance frame for last used frame, and evict over budget.
+		void BeginNewFrame();
 
 	private:
 		struct RequestItem
@@ -160,22 +301,106 @@ namespace sl12
 			std::string		filePath;
 			LoadFunc		funcLoad;
 			ResourceHandle	handle;
+			ResourceLoadPriority::Type	priority;
+			std::unique_ptr<File>		file;		// prefetched in io stage.
 		};	// struct RequestItem
 
+		struct ResourceState
+		{
+			enum Type
+			{
+				Loading,
+				WaitDependencies,
+				Complete,
+				Failed,
+			};
+		};	// struct ResourceState
+
+		struct ResourceEntry
+		{
+			std::unique_ptr<ResourceItemBase>	item;
+			std::string							pathKey;
+			u32									refCount = 0;
+			u64									memorySize = 0;
+
+			ResourceState::Type					state = ResourceState::Loading;
+			u32									pendingDependencyCount = 0;
+			std::vector<u64>					waiters;		// ids of items waiting this item.
+			std::vector<CompletionCallback>		callbacks;
+		};	// struct ResourceEntry
+
+		struct TaskGroup
+		{
+			u32		remainCount = 0;		// guarded by listMutex_.
+		};	// struct TaskGroup
+
+		struct TaskItem
+		{
+			std::function<void()>*	pFunc;
+			TaskGroup*				pGroup;
+		};	// struct TaskItem
+
+		struct CallbackItem
+		{
+			CompletionCallback	func;
+			ResourceHandle		handle;
+			bool				isSuccess;
+		};	// struct CallbackItem
+
+		void IoThreadBody();
+		void ThreadBody();
+		void LoadItem(RequestItem& item);
+		// lock free.
+		const ResourceItemBase* GetItemBaseFromID(u64 id) const;
+		ResourceEntry* FindEntry(u64 id);
+		bool RemoveRequest(u64 id);
+		void ReleaseDependencies(ResourceItemBase* pItem);
+		ResourceItemBase* RemoveEntry(u64 id, ResourceEntry* entry);
+		void CompleteEntry(u64 id, ResourceEntry* entry, bool isSuccess, std::vector<CallbackItem>& outCallbacks);
+		bool IsFinishedNoLock(u64 id, bool* pIsSuccess);
+		void EvictOverBudget();
+		void RunTask(TaskItem& task);
+		std::unique_ptr<File> ReadFileDirect(const std::string& filePath, bool bPrefetch);
+
+	private:
+
 		Device*				pDevice_ = nullptr;
 		MeshManager*		pMeshManager_ = nullptr;
-		std::atomic<u64>	handleID_ = 0;
 		std::string			resourceBasePath_;
 
-		std::map<u64, std::unique_ptr<ResourceItemBase>>	resourceMap_;
-
-		std::mutex				requestMutex_;
-		std::mutex				listMutex_;
-		std::condition_variable	requestCV_;
-		std::thread				loadingThread_;
-		std::list<RequestItem>	requestList_;
-		bool					isAlive_ = false;
-		bool					isLoading_ = false;
+		std::mutex										archiveMutex_;
+		std::vector<std::unique_ptr<ResourceArchive>>	archives_;
+
+		// readers access items through slot map without lock.
+		// entries are indexed by slot index, and guarded by listMutex_.
+		ConcurrentSlotMap<ResourceItemBase>		resourceSlots_;
+		std::vector<ResourceEntry>				resourceEntries_;
+		std::unordered_map<std::string, u64>	pathMap_;
+
+		// io stage -> decode stage.
+		mutable std::mutex			listMutex_;
+		std::condition_variable		ioCV_;
+		std::condition_variable		requestCV_;
+		std::condition_variable		completeCV_;
+		std::condition_variable		taskCV_;
+		std::vector<std::thread>	ioThreads_;
+		std::vector<std::thread>	loadingThreads_;
+		std::list<RequestItem>		ioLists_[ResourceLoadPriority::Max];
+		std::list<RequestItem>		requestLists_[ResourceLoadPriority::Max];
+		std::list<TaskItem>			taskList_;
+		std::vector<LoadFunc>		noPrefetchFuncs_;		// read files by OpenFileRange. set in Initialize.
+		u32							prefetchCount_ = 0;
+		u64							prefetchBytes_ = 0;
+		std::atomic<u32>			pendingCount_ = 0;
+		std::atomic<bool>			isAlive_ = false;
+
+		std::atomic<u64>			currentFrame_ = 0;
+		std::atomic<u64>			memoryBudget_ = 0;
+		std::atomic<u64>			residentMemorySize_ = 0;
+		u32							cachedCount_ = 0;		// unreferenced resident items. guarded by listMutex_.
+
+		// guarded by listMutex_.
+		Stats						stats_;
 	};	// class ResourceLoader
 
 }	// namespace sl12
@@ -132,6 +132,31 @@ namespace sl12
 		}
 	};	// class ResourceMeshMaterial
 
+	struct ResourceMeshLod
+	{
+		u32		indexOffset;		// in index buffer.
+		u32		indexCount;
+		float	error;				// simplification error in object space.
+
+		template <class Archive>
+		void serialize(Archive& ar)
+		{
+			ar(CEREAL_NVP(indexOffset), CEREAL_NVP(indexCount), CEREAL_NVP(error));
+		}
+	};	// struct ResourceMeshLod
+
+	struct ResourceMeshClusterLod
+	{
+		ResourceMeshBoundingSphere	sphere;
+		float						error;		// simplification error in object space.
+
+		template <class Archive>
+		void serialize(Archive& ar)
+		{
+			ar(CEREAL_NVP(sphere), CEREAL_NVP(error));
+		}
+	};	// struct ResourceMeshClusterLod
+
 	class ResourceMeshMeshlet
 	{
 		friend class cereal::access;
@@ -206,6 +231,14 @@ namespace sl12
 		}
 	};	// class ResourceMeshMeshlet
 
+	struct ResourceMeshCluster
+	{
+		ResourceMeshMeshlet			meshlet;	// offsets are relative to submesh.
+		u32							level;
+		ResourceMeshClusterLod		lod;
+		ResourceMeshClusterLod		parentLod;
+	};	// struct ResourceMeshCluster
+
 	class ResourceMeshSubmesh
 	{
 		friend class cereal::access;
@@ -264,6 +297,14 @@ namespace sl12
 		{
 			return boundingBox_;
 		}
+		const std::vector<ResourceMeshLod>& GetLods() const
+		{
+			return lods_;
+		}
+		const std::vector<ResourceMeshCluster>& GetClusters() const
+		{
+			return clusters_;
+		}
 
 	private:
 		int									materialIndex_;
@@ -278,6 +319,8 @@ namespace sl12
 		std::vector<ResourceMeshMeshlet>	meshlets_;
 		ResourceMeshBoundingSphere			boundingSphere_;
 		ResourceMeshBoundingBox				boundingBox_;
+		std::vector<ResourceMeshLod>		lods_;				// LOD1 and coarser. not serialized in v1.
+		std::vector<ResourceMeshCluster>	clusters_;			// cluster dag. not serialized in v1.
 
 
 		template <class Archive>
@@ -386,6 +429,164 @@ namespace sl12
 		}
 	};	// class ResourceMesh
 
+	//----
+	// rmesh v2 binary layout.
+	//   header | blobs (aligned to kBlobAlignment)
+	// offsets are from file head, and blobs can be used in place.
+	// v1 is cereal binary archive of ResourceMesh.
+	struct ResourceMeshBlobType
+	{
+		enum Type
+		{
+			Material,					// ResourceMeshFileMaterial[materialCount]
+			Submesh,					// ResourceMeshFileSubmesh[submeshCount]
+			Meshlet,					// ResourceMeshFileMeshlet[meshletCount]
+			String,						// names of materials and textures.
+			Position,
+			Normal,
+			Tangent,
+			Texcoord,
+			Index,
+			MeshletPackedPrimitive,
+			MeshletVertexIndex,
+			Lod,						// ResourceMeshFileLod[] sorted by submesh and level. (version 3)
+			Cluster,					// ResourceMeshFileCluster[] sorted by submesh. (version 4)
+
+			Max,
+
+			StreamBegin = Position,
+			StreamEnd = Lod,
+		};
+	};	// struct ResourceMeshBlobType
+
+	struct ResourceMeshBlob
+	{
+		u64		offset;
+		u64		size;
+	};	// struct ResourceMeshBlob
+
+	struct ResourceMeshFileString
+	{
+		u32		offset;					// from String blob head.
+		u32		length;
+	};	// struct ResourceMeshFileString
+
+	struct ResourceMeshFileFlag
+	{
+		enum Type
+		{
+			// stream blobs start with ResourceMeshStreamHeader.
+			CompressedStreams	= 0x1 << 0,
+		};
+	};	// struct ResourceMeshFileFlag
+
+	struct ResourceMeshStreamCodec
+	{
+		enum Type
+		{
+			None,						// raw data.
+			Vertex,						// meshopt vertex codec.
+			VertexOct,					// meshopt vertex codec and octahedral filter. (4 byte normal/tangent)
+			IndexBuffer,				// meshopt index codec for triangle list.
+			IndexSequence,				// meshopt index sequence codec.
+		};
+	};	// struct ResourceMeshStreamCodec
+
+	struct ResourceMeshStreamHeader
+	{
+		u32		codec;					// ResourceMeshStreamCodec
+		u32		elementSize;
+		u64		elementCount;			// decoded size is elementSize * elementCount.
+	};	// struct ResourceMeshStreamHeader
+
+	struct ResourceMeshFileHeader
+	{
+		static const u32	kMagic = TYPE_FOURCC("RMSH");
+		static const u32	kVersion = 4;
+		static const u32	kMinVersion = 2;
+		static const u32	kBlobAlignment = 256;
+
+		// blobs after this count are not stored in older versions, and must be treated as empty.
+		static u32 GetBlobCount(u32 version)
+		{
+			return (version >= 4) ? (u32)ResourceMeshBlobType::Max
+				: (version == 3) ? (u32)ResourceMeshBlobType::Cluster
+				: (u32)ResourceMeshBlobType::Lod;
+		}
+
+		u32							magic;
+		u32							version;
+		u32							materialCount;
+		u32							submeshCount;
+		u32							meshletCount;
+		u32							flags;					// ResourceMeshFileFlag
+		ResourceMeshBoundingSphere	boundingSphere;
+		ResourceMeshBoundingBox		boundingBox;
+		ResourceMeshBlob			blobs[ResourceMeshBlobType::Max];
+	};	// struct ResourceMeshFileHeader
+
+	struct ResourceMeshFileMaterial
+	{
+		static const u32	kTextureCount = 4;	// base color, normal, orm, emissive.
+
+		ResourceMeshFileString			name;
+		ResourceMeshFileString			textureNames[kTextureCount];
+		float							baseColor[4];
+		float							emissiveColor[3];
+		float							roughness;
+		float							metallic;
+		ResourceMeshMaterialBlendType	blendType;
+		ResourceMeshMaterialCullMode	cullMode;
+		u8								padding[2];
+	};	// struct ResourceMeshFileMaterial
+
+	struct ResourceMeshFileSubmesh
+	{
+		s32							materialIndex;
+		u32							vertexOffset;
+		u32							vertexCount;
+		u32							indexOffset;
+		u32							indexCount;
+		u32							meshletPrimitiveOffset;
+		u32							meshletPrimitiveCount;
+		u32							meshletVertexIndexOffset;
+		u32							meshletVertexIndexCount;
+		u32							meshletOffset;			// in Meshlet blob.
+		u32							meshletCount;
+		ResourceMeshBoundingSphere	boundingSphere;
+		ResourceMeshBoundingBox		boundingBox;
+	};	// struct ResourceMeshFileSubmesh
+
+	struct ResourceMeshFileLod
+	{
+		u32							submeshIndex;
+		u32							indexOffset;
+		u32							indexCount;
+		float						error;
+	};	// struct ResourceMeshFileLod
+
+	struct ResourceMeshFileMeshlet
+	{
+		u32							indexOffset;
+		u32							indexCount;
+		u32							primitiveOffset;
+		u32							primitiveCount;
+		u32							vertexIndexOffset;
+		u32							vertexIndexCount;
+		ResourceMeshBoundingSphere	boundingSphere;
+		ResourceMeshBoundingBox		boundingBox;
+		ResourceMeshMeshletCone		cone;
+	};	// struct ResourceMeshFileMeshlet
+
+	struct ResourceMeshFileCluster
+	{
+		u32							submeshIndex;
+		u32							level;					// 0 is the finest.
+		ResourceMeshFileMeshlet		meshlet;				// offsets are relative to submesh, same as Meshlet blob.
+		ResourceMeshClusterLod		lod;					// bounds of the group this cluster is simplified from.
+		ResourceMeshClusterLod		parentLod;				// bounds of the group this cluster is simplified into. error is FLT_MAX for root.
+	};	// struct ResourceMeshFileCluster
+
 	class ResourceItemMesh
 		: public ResourceItemBase
 	{
@@ -435,6 +636,31 @@ namespace sl12
 			Bounding	boundingInfo;
 		};	// struct Meshlet
 
+		struct ClusterLod
+		{
+			DirectX::XMFLOAT3	center;
+			float				radius;
+			float				error;
+		};	// struct ClusterLod
+
+		// node of cluster dag.
+		// a cluster is drawn if its lod error is acceptable and its parent lod error is not.
+		struct Cluster
+		{
+			Meshlet				meshlet;
+			u32					level;
+			ClusterLod			lod;
+			ClusterLod			parentLod;
+		};	// struct Cluster
+
+		struct Lod
+		{
+			u32					indexCount;
+			size_t				indexOffsetBytes;
+			size_t				indexSizeBytes;
+			float				error;				// simplification error in object space.
+		};	// struct Lod
+
 		struct Submesh
 		{
 			int					materialIndex;
@@ -460,13 +686,29 @@ namespace sl12
 			Bounding			boundingInfo;
 
 			std::vector<Meshlet>	meshlets;
+			std::vector<Lod>		lods;			// lods[0] is the base mesh. meshlets are built for lods[0] only.
+			std::vector<Cluster>	clusters;		// cluster dag. empty if not built.
 		};	// struct Submesh
 
+		struct SubmeshState
+		{
+			enum Type
+			{
+				NotResident,
+				Loading,
+				Resident,
+			};
+		};	// struct SubmeshState
+
 	public:
 		static const u32 kType = TYPE_FOURCC("MESH");
+		static const u32 kStreamCount = ResourceMeshBlobType::StreamEnd - ResourceMeshBlobType::StreamBegin;
 
 		~ResourceItemMesh();
 
+		u64 GetCpuMemorySize() const override;
+		u64 GetGpuMemorySize() const override;
+
 		const std::vector<Material>& GetMaterials() const
 		{
 			return mateirals_;
@@ -480,6 +722,7 @@ namespace sl12
 			return boundingInfo_;
 		}
 
+		// whole stream handles. invalid in partial mesh.
 		const MeshManager::Handle& GetPositionHandle() const
 		{
 			return hPosition_;
@@ -513,7 +756,27 @@ namespace sl12
 			return mtxBoxToLocal_;
 		}
 
+		// partial mesh loads tables only, and submesh streams are loaded on demand. (ex. MeshStreamer)
+		bool IsPartial() const
+		{
+			return isPartial_;
+		}
+		SubmeshState::Type GetSubmeshState(u32 submeshIndex) const;
+
+		// get stream of submesh.
+		// byte offsets in Submesh are from stream head. subtract outBaseOffsetBytes for offsets in outHandle.
+		// return false if submesh is not resident.
+		bool GetSubmeshStream(u32 submeshIndex, ResourceMeshBlobType::Type type, MeshManager::Handle& outHandle, size_t& outBaseOffsetBytes) const;
+
 		static ResourceItemBase* LoadFunction(ResourceLoader* pLoader, ResourceHandle handle, const std::string& filepath);
+		// v2 uncompressed file can be loaded partially. otherwise, whole mesh is loaded.
+		// partial load reads header and tables only, and file is not prefetched.
+		static ResourceItemBase* LoadFunctionPartial(ResourceLoader* pLoader, ResourceHandle handle, const std::string& filepath);
+
+		// read submesh streams from file and deploy to mesh manager. called on streaming thread.
+		static bool StreamInSubmesh(ResourceItemMesh* pMesh, u32 submeshIndex);
+		// release submesh streams after GPU finished. must be called on the same thread as GetSubmeshStream.
+		static bool EvictSubmesh(Device* pDevice, ResourceItemMesh* pMesh, u32 submeshIndex);
 
 		static size_t GetPositionStride()
 		{
@@ -557,10 +820,25 @@ namespace sl12
 		}
 
 	private:
+		struct SourceData;
+
+		// streams of one submesh in partial mesh.
+		struct SubmeshStream
+		{
+			std::atomic<u32>	state = SubmeshState::NotResident;
+			size_t				offsetBytes[kStreamCount] = {};		// from stream head.
+			size_t				sizeBytes[kStreamCount] = {};
+			MeshManager::Handle	handles[kStreamCount];
+		};	// struct SubmeshStream
+
 		ResourceItemMesh(ResourceHandle handle)
 			: ResourceItemBase(handle, ResourceItemMesh::kType)
 		{}
 
+		static ResourceItemBase* LoadImpl(ResourceLoader* pLoader, ResourceHandle handle, const std::string& filepath, bool bPartial);
+		static ResourceItemMesh* CreateFromSource(ResourceLoader* pLoader, ResourceHandle handle, const std::string& filepath, SourceData& src, bool bPartial);
+		bool SetupSubmeshStreams(const SourceData& src);
+
 	private:
 		std::vector<Material>	mateirals_;
 		std::vector<Submesh>	Submeshes_;
@@ -575,6 +853,14 @@ namespace sl12
 		MeshManager::Handle	hMeshletVertexIndex_;
 
 		DirectX::XMFLOAT4X4 mtxBoxToLocal_;
+
+		// buffers are released to this. item may be killed after loader is destroyed.
+		MeshManager*		pMeshManager_ = nullptr;
+
+		// partial mesh.
+		bool								isPartial_ = false;
+		ResourceMeshBlob					streamBlobs_[kStreamCount] = {};	// stream locations in file.
+		std::unique_ptr<SubmeshStream[]>	submeshStreams_;
 	};	// class ResourceItemMesh
 
 }	// namespace sl12
@@ -62,6 +62,8 @@ namespace sl12
 		u32 GetMipLevelFromMemSize(u32 memSize) const;
 		void GetCurrentSize(u32& width, u32& height) const;
 
+		u64 GetGpuMemorySize() const override;
+
 
 		static ResourceItemBase* LoadFunction(ResourceLoader* pLoader, ResourceHandle handle, const std::string& filepath);
 		static bool ChangeMiplevel(Device* pDevice, ResourceItemStreamingTexture* pSTex, u32 nextWidth);
@@ -39,6 +39,8 @@ namespace sl12
 			return true;
 		}
 
+		u64 GetGpuMemorySize() const override;
+
 
 		static ResourceItemBase* LoadFunction(ResourceLoader* pLoader, ResourceHandle handle, const std::string& filepath);
 
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include "sl12/types.h"
+#include "sl12/ring_offset_allocator.h"
 
 #include <atomic>
 #include <mutex>
@@ -41,11 +42,8 @@ namespace sl12
 		Device*		pParentDevice_ = nullptr;
 		Buffer*		pCopySource_ = nullptr;
 
-		std::mutex	mutex_;
-		u32			size_;
-		u32			head_;
-		u32			tail_;
-		u32			prevHead_;
+		std::mutex				mutex_;
+		RingOffsetAllocator		offsetAllocator_;
 	};	// class CopyRingBuffer
 
 }	// namespace sl12
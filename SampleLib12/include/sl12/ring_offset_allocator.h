@@ -0,0 +1,51 @@
+﻿#pragma once
+
+#include <sl12/types.h>
+
+
+namespace sl12
+{
+	//----------------
+	// offset allocator for copy ring buffer.
+	// data of current frame is kept, and ring is grown when request does not fit.
+	// this class does not depend on device, so cpu only tools can use it.
+	class RingOffsetAllocator
+	{
+	public:
+		static const u32	kWaterMark = 16;
+
+	public:
+		RingOffsetAllocator(u32 initSize)
+			: size_(initSize)
+		{}
+
+		// need to call when frame begin.
+		void BeginNewFrame()
+		{
+			head_ = tail_;
+		}
+
+		// return offset of allocated range.
+		// if ring is grown, outNewSize is set to new ring size and all offsets are reset. otherwise, 0.
+		u32 Allocate(u32 size, u32& outNewSize);
+
+		u32 GetSize() const
+		{
+			return size_;
+		}
+		// offset of current frame head.
+		u32 GetHead() const
+		{
+			return head_;
+		}
+
+	private:
+		u32		size_;
+		u32		head_ = 0;
+		u32		tail_ = 0;
+	};	// class RingOffsetAllocator
+
+}	// namespace sl12
+
+
+//	EOF
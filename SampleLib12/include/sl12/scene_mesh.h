@@ -161,6 +161,20 @@ namespace sl12
 		void UpdateMaterial(u32 index, const MeshMaterialData& data);
 		void LoadUpdateMaterialCommand(CommandList* pCmdList);
 
+		// select the coarsest lod whose projected error is under thresholdPixels.
+		// projScale is (screen height / (2 * tan(fovY / 2))).
+		u32 SelectLod(u32 submeshIndex, const DirectX::XMFLOAT3& cameraPos, float projScale, float thresholdPixels) const;
+		// select lods of all submeshes.
+		void UpdateLod(const DirectX::XMFLOAT3& cameraPos, float projScale, float thresholdPixels);
+		u32 GetSubmeshLod(u32 submeshIndex) const
+		{
+			return (submeshIndex < lodIndices_.size()) ? lodIndices_[submeshIndex] : 0;
+		}
+
+		// select clusters of the dag cut whose error is under thresholdPixels and parent error is not.
+		// outClusters receives indices of ResourceItemMesh::Submesh::clusters.
+		void SelectClusterCut(u32 submeshIndex, const DirectX::XMFLOAT3& cameraPos, float projScale, float thresholdPixels, std::vector<u32>& outClusters) const;
+
 	private:
 		Device*	pParentDevice_ = nullptr;
 		const ResourceItemMesh*	pParentResource_ = nullptr;
@@ -182,6 +196,8 @@ namespace sl12
 
 		DirectX::XMFLOAT4X4	mtxLocalToWorld_;
 		DirectX::XMFLOAT4X4	mtxPrevLocalToWorld_;
+
+		std::vector<u32>	lodIndices_;
 	};	// class SceneMesh
 
 }	// namespace sl12
@@ -0,0 +1,191 @@
+﻿#pragma once
+
+#include <sl12/types.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cassert>
+
+
+namespace sl12
+{
+	//----------------
+	// generational slot map for pointers.
+	// Get is lock free, and can be called while other threads allocate or free slots.
+	// id = (generation << 32) | index. id 0 is always invalid.
+	template <typename T>
+	class ConcurrentSlotMap
+	{
+		static const u32	kChunkShift = 10;
+		static const u32	kChunkSize = 1 << kChunkShift;
+		static const u32	kMaxChunks = 4096;
+
+		struct Slot
+		{
+			std::atomic<u32>	generation{ 1 };
+			std::atomic<T*>		pItem{ nullptr };
+		};	// struct Slot
+
+	public:
+		ConcurrentSlotMap()
+		{
+			for (auto&& chunk : chunks_)
+			{
+				chunk.store(nullptr, std::memory_order_relaxed);
+			}
+		}
+		~ConcurrentSlotMap()
+		{
+			Clear();
+		}
+
+		// NOTE: no other thread may access this map while clearing.
+		void Clear()
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			for (u32 i = 0; i < chunkCount_; i++)
+			{
+				delete[] chunks_[i].exchange(nullptr, std::memory_order_relaxed);
+			}
+			chunkCount_ = 0;
+			slotCount_ = 0;
+			freeIndices_.clear();
+		}
+
+		// allocate empty slot.
+		u64 Allocate()
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+
+			u32 index;
+			if (!freeIndices_.empty())
+			{
+				index = freeIndices_.back();
+				freeIndices_.pop_back();
+			}
+			else
+			{
+				index = slotCount_;
+				if ((index >> kChunkShift) >= chunkCount_)
+				{
+					assert(chunkCount_ < kMaxChunks);
+					chunks_[chunkCount_].store(new Slot[kChunkSize], std::memory_order_release);
+					chunkCount_++;
+				}
+				slotCount_++;
+			}
+
+			auto&& slot = GetSlot(index);
+			u32 gen = slot.generation.load(std::memory_order_relaxed);
+			return MakeID(index, gen);
+		}
+
+		// publish item to readers.
+		bool Publish(u64 id, T* p)
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (!IsAliveNoLock(id))
+			{
+				return false;
+			}
+			GetSlot(GetIndex(id)).pItem.store(p, std::memory_order_release);
+			return true;
+		}
+
+		// free slot, and return published item.
+		T* Free(u64 id)
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (!IsAliveNoLock(id))
+			{
+				return nullptr;
+			}
+
+			u32 index = GetIndex(id);
+			auto&& slot = GetSlot(index);
+			T* ret = slot.pItem.exchange(nullptr, std::memory_order_acq_rel);
+			u32 gen = slot.generation.load(std::memory_order_relaxed) + 1;
+			// generation 0 is never used.
+			slot.generation.store(gen ? gen : 1, std::memory_order_release);
+			freeIndices_.push_back(index);
+			return ret;
+		}
+
+		// lock free.
+		T* Get(u64 id) const
+		{
+			u32 index = GetIndex(id);
+			if ((index >> kChunkShift) >= kMaxChunks)
+			{
+				return nullptr;
+			}
+			const Slot* chunk = chunks_[index >> kChunkShift].load(std::memory_order_acquire);
+			if (!chunk)
+			{
+				return nullptr;
+			}
+
+			auto&& slot = chunk[index & (kChunkSize - 1)];
+			u32 gen = GetGeneration(id);
+			if (slot.generation.load(std::memory_order_acquire) != gen)
+			{
+				return nullptr;
+			}
+			T* ret = slot.pItem.load(std::memory_order_acquire);
+			// slot may be freed while reading.
+			if (slot.generation.load(std::memory_order_acquire) != gen)
+			{
+				return nullptr;
+			}
+			return ret;
+		}
+
+		// slot is allocated and not freed. item may not be published.
+		bool IsAlive(u64 id) const
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			return IsAliveNoLock(id);
+		}
+
+		static u32 GetIndex(u64 id)
+		{
+			return (u32)(id & 0xffffffff);
+		}
+		static u32 GetGeneration(u64 id)
+		{
+			return (u32)(id >> 32);
+		}
+
+	private:
+		static u64 MakeID(u32 index, u32 generation)
+		{
+			return ((u64)generation << 32) | (u64)index;
+		}
+
+		Slot& GetSlot(u32 index) const
+		{
+			return chunks_[index >> kChunkShift].load(std::memory_order_relaxed)[index & (kChunkSize - 1)];
+		}
+
+		bool IsAliveNoLock(u64 id) const
+		{
+			u32 index = GetIndex(id);
+			if (index >= slotCount_ || GetGeneration(id) == 0)
+			{
+				return false;
+			}
+			return GetSlot(index).generation.load(std::memory_order_relaxed) == GetGeneration(id);
+		}
+
+	private:
+		mutable std::mutex	mutex_;
+		std::atomic<Slot*>	chunks_[kMaxChunks];
+		u32					chunkCount_ = 0;
+		u32					slotCount_ = 0;
+		std::vector<u32>	freeIndices_;
+	};	// class ConcurrentSlotMap
+
+}	// namespace sl12
+
+
+//	EOF
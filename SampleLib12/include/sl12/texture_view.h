@@ -2,6 +2,7 @@
 
 #include <sl12/util.h>
 #include <sl12/descriptor_heap.h>
+#include <sl12/bindless_registry.h>
 #include <DirectXTex.h>
 
 
@@ -30,10 +31,14 @@ namespace sl12
 		const DescriptorInfo& GetDescInfo() const { return descInfo_; }
 		DescriptorInfo& GetDynamicDescInfo() { return dynamicDescInfo_; }
 		const DescriptorInfo& GetDynamicDescInfo() const { return dynamicDescInfo_; }
+		const BindlessHandle& GetBindlessHandle() const { return bindlessHandle_; }
+		u32 GetBindlessIndex() const { return bindlessHandle_.index; }
 
 	private:
-		DescriptorInfo	descInfo_;
-		DescriptorInfo	dynamicDescInfo_;
+		DescriptorInfo		descInfo_;
+		DescriptorInfo		dynamicDescInfo_;
+		BindlessRegistry*	pBindless_ = nullptr;
+		BindlessHandle		bindlessHandle_;
 	};	// class TextureView
 
 
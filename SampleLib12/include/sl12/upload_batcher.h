@@ -0,0 +1,77 @@
+﻿#pragma once
+
+#include "sl12/types.h"
+
+#include <mutex>
+#include <vector>
+
+
+namespace sl12
+{
+	class Buffer;
+	class CommandList;
+	class CopyRingBuffer;
+
+	//----------------
+	// Collect small buffer copies and merge contiguous ranges.
+	class UploadBatcher
+	{
+		struct CopyRequest
+		{
+			Buffer*		pDstBuffer;
+			u32			dstOffset;
+			u32			size;
+			u32			dataOffset;
+			u32			order;
+		};	// struct CopyRequest
+
+	public:
+		struct Stats
+		{
+			u32		requestCount = 0;	// number of requested copies.
+			u32		commandCount = 0;	// number of CopyBufferRegion after merging.
+			u64		requestBytes = 0;	// total size of requested data.
+			u64		uploadBytes = 0;	// total size of copied data.
+		};	// struct Stats
+
+	public:
+		UploadBatcher(CopyRingBuffer* pRing);
+		~UploadBatcher();
+
+		// store copy request. data is copied immediately.
+		void RequestCopy(Buffer* pDstBuffer, u32 dstOffset, const void* pData, u32 size);
+
+		// sort and merge requests, and load dma copy commands.
+		// if bTransition is true, dst buffers are transitioned GENERIC_READ -> COPY_DEST -> GENERIC_READ.
+		// set bTransition to false for copy queue command list. (buffers are promoted from COMMON state.)
+		void Flush(CommandList* pCmdList, bool bTransition = true);
+
+		// discard all requests.
+		void Clear();
+
+		bool IsEmpty()
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			return requests_.empty();
+		}
+
+		// stats of last flush.
+		const Stats& GetLastStats() const
+		{
+			return lastStats_;
+		}
+
+	private:
+		CopyRingBuffer*			pRingBuffer_ = nullptr;
+
+		std::mutex				mutex_;
+		std::vector<CopyRequest>	requests_;
+		std::vector<u8>			data_;
+		std::vector<u8>			mergedData_;
+
+		Stats					lastStats_;
+	};	// class UploadBatcher
+
+}	// namespace sl12
+
+//	EOF
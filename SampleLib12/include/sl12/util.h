@@ -104,6 +104,49 @@ namespace sl12
 		return hash;
 	}
 
+	// MurmurHash64A. process 8 bytes at a time, faster than fnv1a for large data.
+	inline u64 CalcMurmur64(const void* data, size_t numBytes, u64 seed = 0)
+	{
+		assert(data);
+		const u64 m = 0xc6a4a7935bd1e995ULL;
+		const int r = 47;
+
+		u64 hash = seed ^ (numBytes * m);
+
+		const u8* ptr = reinterpret_cast<const u8*>(data);
+		const u8* end = ptr + (numBytes / 8) * 8;
+		while (ptr != end)
+		{
+			u64 k;
+			memcpy(&k, ptr, sizeof(k));
+			ptr += 8;
+
+			k *= m;
+			k ^= k >> r;
+			k *= m;
+
+			hash ^= k;
+			hash *= m;
+		}
+
+		switch (numBytes & 7)
+		{
+		case 7: hash ^= u64(ptr[6]) << 48;
+		case 6: hash ^= u64(ptr[5]) << 40;
+		case 5: hash ^= u64(ptr[4]) << 32;
+		case 4: hash ^= u64(ptr[3]) << 24;
+		case 3: hash ^= u64(ptr[2]) << 16;
+		case 2: hash ^= u64(ptr[1]) << 8;
+		case 1: hash ^= u64(ptr[0]);
+			hash *= m;
+		};
+
+		hash ^= hash >> r;
+		hash *= m;
+		hash ^= hash >> r;
+		return hash;
+	}
+
 	// compute aligned size.
 	constexpr u32 GetAlignedSize(const u32 size, const u32 align)
 	{
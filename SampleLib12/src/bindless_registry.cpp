@@ -0,0 +1,128 @@
+﻿#include <sl12/bindless_registry.h>
+
+#include <sl12/device.h>
+
+
+namespace sl12
+{
+	//----
+	bool BindlessRegistry::Initialize(Device* pDev, GlobalDescriptorHeap* pHeap, u32 maxCount)
+	{
+		// take persistent range from global heap.
+		DescriptorStack stack;
+		if (!pHeap->AllocateStack(stack, maxCount))
+		{
+			return false;
+		}
+		if (!stack.Allocate(maxCount, cpuHandleStart_, gpuHandleStart_))
+		{
+			return false;
+		}
+
+		pParentDevice_ = pDev;
+		descSize_ = pDev->GetDeviceDep()->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+		maxCount_ = maxCount;
+		registeredCount_ = 0;
+
+		// fill default view not to read uninitialized descriptors.
+		auto def_view = pDev->GetDefaultViewDescInfo().cpuHandle;
+		D3D12_CPU_DESCRIPTOR_HANDLE dst = cpuHandleStart_;
+		for (u32 i = 0; i < maxCount; i++, dst.ptr += descSize_)
+		{
+			pDev->GetDeviceDep()->CopyDescriptorsSimple(1, dst, def_view, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+		}
+
+		generations_.resize(maxCount, 0);
+		freeIndices_.resize(maxCount);
+		for (u32 i = 0; i < maxCount; i++)
+		{
+			// pop from back, small index first.
+			freeIndices_[i] = maxCount - 1 - i;
+		}
+
+		return true;
+	}
+
+	//----
+	void BindlessRegistry::Destroy()
+	{
+		generations_.clear();
+		freeIndices_.clear();
+		maxCount_ = 0;
+		pParentDevice_ = nullptr;
+	}
+
+	//----
+	BindlessHandle BindlessRegistry::Register(D3D12_CPU_DESCRIPTOR_HANDLE srcHandle)
+	{
+		BindlessHandle ret;
+
+		u32 index;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (freeIndices_.empty())
+			{
+				ConsolePrint("Error : bindless registry is full. (max %d)\n", maxCount_);
+				return ret;
+			}
+			index = freeIndices_.back();
+			freeIndices_.pop_back();
+			registeredCount_++;
+
+			ret.index = index;
+			ret.generation = generations_[index];
+		}
+
+		D3D12_CPU_DESCRIPTOR_HANDLE dst = cpuHandleStart_;
+		dst.ptr += descSize_ * index;
+		pParentDevice_->GetDeviceDep()->CopyDescriptorsSimple(1, dst, srcHandle, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+		return ret;
+	}
+
+	//----
+	void BindlessRegistry::Unregister(BindlessHandle& handle)
+	{
+		if (!handle.IsValid() || !pParentDevice_)
+		{
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			assert(handle.index < maxCount_);
+			assert(generations_[handle.index] == handle.generation);
+			generations_[handle.index]++;
+		}
+
+		// GPU may still reference this index.
+		pParentDevice_->PendingKill(new FreeItem(this, handle.index));
+		handle = BindlessHandle();
+	}
+
+	//----
+	bool BindlessRegistry::IsValid(const BindlessHandle& handle)
+	{
+		if (!handle.IsValid() || handle.index >= maxCount_)
+		{
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		return generations_[handle.index] == handle.generation;
+	}
+
+	//----
+	void BindlessRegistry::FreeIndex(u32 index)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (index < maxCount_)
+		{
+			freeIndices_.push_back(index);
+			registeredCount_--;
+		}
+	}
+
+}	// namespace sl12
+
+//	EOF
@@ -0,0 +1,532 @@
+﻿#include <sl12/buffer_heap_allocator.h>
+
+#include <algorithm>
+
+
+namespace sl12
+{
+	namespace
+	{
+		inline u32 CountTrailingZeros(u64 bits)
+		{
+			assert(bits != 0);
+			unsigned long index;
+			_BitScanForward64(&index, bits);
+			return (u32)index;
+		}
+
+		inline u32 FindMostSignificantBit(u64 bits)
+		{
+			assert(bits != 0);
+			unsigned long index;
+			_BitScanReverse64(&index, bits);
+			return (u32)index;
+		}
+	}
+
+	//----------------
+	//----
+	BufferHeapAllocator::BufferHeapAllocator(const Hooks& hooks, size_t initSize, size_t align, size_t pageSize)
+		: hooks_(hooks)
+		, initSize_(initSize)
+		, alignment_(align)
+		, pageSize_(pageSize)
+	{
+		for (auto&& heads : freeHeads_)
+		{
+			for (auto&& head : heads)
+			{
+				head = kInvalidBlock;
+			}
+		}
+
+		if (pageSize_ > 0)
+		{
+			assert((pageSize_ % alignment_) == 0);
+			pages_.reset(new Page[kMaxPageTableCount]);
+			pageTable_.reset(new u32[kMaxPageTableCount]);
+			for (size_t size = 0; size < initSize; size += pageSize_)
+			{
+				u32 index = CreateNewPage(pageSize_);
+				assert(index != kInvalidBlock);
+			}
+			growPeakBytes_ = 0;
+			return;
+		}
+
+		bool bSuccess = hooks_.createBufferFn(initSize, pBuffer_, pBufferSrv_);
+		assert(bSuccess);
+		bufferSize_ = initSize;
+
+		u32 index = NewBlock();
+		blocks_[index].size = initSize;
+		tailBlock_ = index;
+		totalSize_ = initSize;
+		InsertFreeBlock(index);
+	}
+
+	//----
+	BufferHeapAllocator::~BufferHeapAllocator()
+	{
+		if (bufferSize_ > 0)
+		{
+			hooks_.killBufferFn(pBuffer_, pBufferSrv_);
+		}
+		if (nextBufferSize_ > 0)
+		{
+			hooks_.killBufferFn(pNextBuffer_, pNextBufferSrv_);
+		}
+		for (u32 i = 0; i < pageCount_; i++)
+		{
+			hooks_.killBufferFn(pages_[i].pBuffer, pages_[i].pSrv);
+		}
+	}
+
+	//----
+	// size class of block.
+	// first level is power of 2, and second level splits it linearly.
+	void BufferHeapAllocator::Mapping(size_t size, u32& fl, u32& sl)
+	{
+		if (size < kSmallBlockSize)
+		{
+			fl = 0;
+			sl = (u32)(size / (kSmallBlockSize / kSLCount));
+		}
+		else
+		{
+			u32 msb = FindMostSignificantBit(size);
+			sl = (u32)(size >> (msb - kSLCountLog2)) ^ kSLCount;
+			fl = msb - kFLShift + 1;
+		}
+	}
+
+	//----
+	u32 BufferHeapAllocator::NewBlock()
+	{
+		if (!unusedBlocks_.empty())
+		{
+			u32 index = unusedBlocks_.back();
+			unusedBlocks_.pop_back();
+			blocks_[index] = Block();
+			return index;
+		}
+		blocks_.push_back(Block());
+		return (u32)(blocks_.size() - 1);
+	}
+
+	//----
+	void BufferHeapAllocator::DeleteBlock(u32 index)
+	{
+		unusedBlocks_.push_back(index);
+	}
+
+	//----
+	void BufferHeapAllocator::InsertFreeBlock(u32 index)
+	{
+		auto&& block = blocks_[index];
+		u32 fl, sl;
+		Mapping(block.size, fl, sl);
+		assert(fl < kFLCount);
+
+		u32 head = freeHeads_[fl][sl];
+		block.prevFree = kInvalidBlock;
+		block.nextFree = head;
+		if (head != kInvalidBlock)
+		{
+			blocks_[head].prevFree = index;
+		}
+		freeHeads_[fl][sl] = index;
+		flBitmap_ |= (u64)1 << fl;
+		slBitmaps_[fl] |= 1u << sl;
+
+		freeSize_ += block.size;
+		freeBlockCount_++;
+	}
+
+	//----
+	void BufferHeapAllocator::RemoveFreeBlock(u32 index)
+	{
+		auto&& block = blocks_[index];
+		u32 fl, sl;
+		Mapping(block.size, fl, sl);
+
+		if (block.prevFree != kInvalidBlock)
+		{
+			blocks_[block.prevFree].nextFree = block.nextFree;
+		}
+		else
+		{
+			freeHeads_[fl][sl] = block.nextFree;
+			if (block.nextFree == kInvalidBlock)
+			{
+				slBitmaps_[fl] &= ~(1u << sl);
+				if (!slBitmaps_[fl])
+				{
+					flBitmap_ &= ~((u64)1 << fl);
+				}
+			}
+		}
+		if (block.nextFree != kInvalidBlock)
+		{
+			blocks_[block.nextFree].prevFree = block.prevFree;
+		}
+		block.prevFree = block.nextFree = kInvalidBlock;
+
+		freeSize_ -= block.size;
+		freeBlockCount_--;
+	}
+
+	//----
+	// good fit. size is rounded up to next size class, so any block in the found list can be used.
+	u32 BufferHeapAllocator::FindFreeBlock(size_t size) const
+	{
+		if (size >= kSmallBlockSize)
+		{
+			size += ((size_t)1 << (FindMostSignificantBit(size) - kSLCountLog2)) - 1;
+		}
+		else
+		{
+			size += (kSmallBlockSize / kSLCount) - 1;
+		}
+
+		u32 fl, sl;
+		Mapping(size, fl, sl);
+		if (fl >= kFLCount)
+		{
+			return kInvalidBlock;
+		}
+
+		u32 slMap = slBitmaps_[fl] & (~0u << sl);
+		if (!slMap)
+		{
+			u64 flMap = flBitmap_ & (~(u64)0 << (fl + 1));
+			if (!flMap)
+			{
+				return kInvalidBlock;
+			}
+			fl = CountTrailingZeros(flMap);
+			slMap = slBitmaps_[fl];
+		}
+		sl = CountTrailingZeros(slMap);
+		return freeHeads_[fl][sl];
+	}
+
+	//----
+	BufferHeapAllocator::Handle BufferHeapAllocator::Allocate(size_t inSize)
+	{
+		size_t alignedSize = GetAlignedSize(inSize, alignment_);
+		Handle ret;
+
+		u32 index = FindFreeBlock(alignedSize);
+		if (index == kInvalidBlock && pageSize_ > 0)
+		{
+			// add page.
+			index = CreateNewPage(alignedSize);
+			if (index == kInvalidBlock)
+			{
+				return ret;
+			}
+			growCount_++;
+		}
+		else if (index == kInvalidBlock)
+		{
+			// tail block can fit even if its size class is smaller than rounded size.
+			if (tailBlock_ != kInvalidBlock && !blocks_[tailBlock_].isUsed && blocks_[tailBlock_].size >= alignedSize)
+			{
+				index = tailBlock_;
+			}
+			// create new buffer. tail block is extended.
+			else if (CreateNewBuffer(alignedSize))
+			{
+				index = tailBlock_;
+				growCount_++;
+			}
+			else
+			{
+				return ret;
+			}
+		}
+		RemoveFreeBlock(index);
+
+		// split rest of block.
+		if (blocks_[index].size > alignedSize)
+		{
+			u32 rest = NewBlock();
+			auto&& block = blocks_[index];
+			auto&& restBlock = blocks_[rest];
+			restBlock.offset = block.offset + alignedSize;
+			restBlock.size = block.size - alignedSize;
+			restBlock.prevPhys = index;
+			restBlock.nextPhys = block.nextPhys;
+			if (block.nextPhys != kInvalidBlock)
+			{
+				blocks_[block.nextPhys].prevPhys = rest;
+			}
+			else
+			{
+				tailBlock_ = rest;
+			}
+			block.nextPhys = rest;
+			block.size = alignedSize;
+			InsertFreeBlock(rest);
+		}
+
+		auto&& block = blocks_[index];
+		block.isUsed = true;
+		usedSize_ += block.size;
+		usedBlockCount_++;
+
+		ret.heap = this;
+		ret.offset = block.offset;
+		ret.size = block.size;
+		ret.block = index;
+		return ret;
+	}
+
+	//----
+	void BufferHeapAllocator::Free(Handle handle)
+	{
+		if (handle.heap != this)
+		{
+			// error.
+			assert(!"[Error] handle.heap is NOT this heap.");
+			return;
+		}
+		if (handle.block >= blocks_.size() || !blocks_[handle.block].isUsed || blocks_[handle.block].offset != handle.offset)
+		{
+			// error.
+			assert(!"[Error] free block is NOT in this buffer.");
+			return;
+		}
+
+		u32 index = handle.block;
+		blocks_[index].isUsed = false;
+		usedSize_ -= blocks_[index].size;
+		usedBlockCount_--;
+
+		// merge next block.
+		u32 next = blocks_[index].nextPhys;
+		if (next != kInvalidBlock && !blocks_[next].isUsed)
+		{
+			RemoveFreeBlock(next);
+			blocks_[index].size += blocks_[next].size;
+			blocks_[index].nextPhys = blocks_[next].nextPhys;
+			if (blocks_[next].nextPhys != kInvalidBlock)
+			{
+				blocks_[blocks_[next].nextPhys].prevPhys = index;
+			}
+			else
+			{
+				tailBlock_ = index;
+			}
+			DeleteBlock(next);
+		}
+
+		// merge prev block.
+		u32 prev = blocks_[index].prevPhys;
+		if (prev != kInvalidBlock && !blocks_[prev].isUsed)
+		{
+			RemoveFreeBlock(prev);
+			blocks_[prev].size += blocks_[index].size;
+			blocks_[prev].nextPhys = blocks_[index].nextPhys;
+			if (blocks_[index].nextPhys != kInvalidBlock)
+			{
+				blocks_[blocks_[index].nextPhys].prevPhys = prev;
+			}
+			else
+			{
+				tailBlock_ = prev;
+			}
+			DeleteBlock(index);
+			index = prev;
+		}
+
+		InsertFreeBlock(index);
+	}
+
+	//----
+	BufferHeapAllocator::Stats BufferHeapAllocator::GetStats() const
+	{
+		Stats ret;
+		ret.totalSize = totalSize_;
+		ret.usedSize = usedSize_;
+		ret.freeSize = freeSize_;
+		ret.usedBlockCount = usedBlockCount_;
+		ret.freeBlockCount = freeBlockCount_;
+		ret.pageCount = pageCount_;
+		ret.growCount = growCount_;
+		ret.growCopyBytes = growCopyBytes_;
+		ret.growPeakBytes = growPeakBytes_;
+
+		// largest block is in the largest size class.
+		if (flBitmap_)
+		{
+			u32 fl = FindMostSignificantBit(flBitmap_);
+			u32 sl = FindMostSignificantBit(slBitmaps_[fl]);
+			for (u32 index = freeHeads_[fl][sl]; index != kInvalidBlock; index = blocks_[index].nextFree)
+			{
+				ret.largestFreeSize = std::max(ret.largestFreeSize, blocks_[index].size);
+			}
+		}
+		return ret;
+	}
+
+	//----
+	bool BufferHeapAllocator::CreateNewBuffer(size_t alignedSize)
+	{
+		auto incSize = initSize_;
+		while (incSize < alignedSize)
+		{
+			incSize += initSize_;
+		}
+
+		auto currSize = (nextBufferSize_ > 0) ? nextBufferSize_ : bufferSize_;
+		auto newSize = currSize + incSize;
+		Buffer* pNewBuffer = nullptr;
+		BufferView* pNewSrv = nullptr;
+		if (!hooks_.createBufferFn(newSize, pNewBuffer, pNewSrv))
+		{
+			return false;
+		}
+		if (nextBufferSize_ > 0)
+		{
+			hooks_.killBufferFn(pNextBuffer_, pNextBufferSrv_);
+		}
+		pNextBuffer_ = pNewBuffer;
+		pNextBufferSrv_ = pNewSrv;
+		nextBufferSize_ = newSize;
+
+		// current and next buffer are alive until copy is finished.
+		growPeakBytes_ = std::max(growPeakBytes_, bufferSize_ + newSize);
+
+		// extend tail block, or add new free block.
+		if (tailBlock_ != kInvalidBlock && !blocks_[tailBlock_].isUsed)
+		{
+			RemoveFreeBlock(tailBlock_);
+			blocks_[tailBlock_].size += incSize;
+			InsertFreeBlock(tailBlock_);
+		}
+		else
+		{
+			u32 index = NewBlock();
+			blocks_[index].offset = currSize;
+			blocks_[index].size = incSize;
+			blocks_[index].prevPhys = tailBlock_;
+			if (tailBlock_ != kInvalidBlock)
+			{
+				blocks_[tailBlock_].nextPhys = index;
+			}
+			tailBlock_ = index;
+			InsertFreeBlock(index);
+		}
+		totalSize_ += incSize;
+
+		return true;
+	}
+
+	//----
+	// page is not linked with other pages, and blocks in page are not merged over page boundary.
+	u32 BufferHeapAllocator::CreateNewPage(size_t alignedSize)
+	{
+		size_t size = GetAlignedSize(alignedSize, pageSize_);
+		u32 tableCount = (u32)(size / pageSize_);
+		if (pageTableCount_ + tableCount > kMaxPageTableCount)
+		{
+			ConsolePrint("Error: buffer heap page table is full.\n");
+			return kInvalidBlock;
+		}
+
+		Page page;
+		if (!hooks_.createBufferFn(size, page.pBuffer, page.pSrv))
+		{
+			return kInvalidBlock;
+		}
+		page.offset = (size_t)pageTableCount_ * pageSize_;
+		page.size = size;
+
+		// publish page before blocks in it are allocated.
+		u32 pageIndex = pageCount_;
+		pages_[pageIndex] = page;
+		for (u32 i = 0; i < tableCount; i++)
+		{
+			pageTable_[pageTableCount_ + i] = pageIndex;
+		}
+		pageTableCount_ += tableCount;
+		pageCount_++;
+
+		u32 index = NewBlock();
+		blocks_[index].offset = page.offset;
+		blocks_[index].size = size;
+		InsertFreeBlock(index);
+		totalSize_ += size;
+		growPeakBytes_ = std::max(growPeakBytes_, totalSize_);
+
+		return index;
+	}
+
+	//----
+	const BufferHeapAllocator::Page& BufferHeapAllocator::FindPage(size_t offset) const
+	{
+		assert(pageSize_ > 0);
+		size_t tableIndex = offset / pageSize_;
+		assert(tableIndex < pageTableCount_);
+		return pages_[pageTable_[tableIndex]];
+	}
+
+	//----
+	Buffer* BufferHeapAllocator::GetBuffer(size_t offset, size_t& outLocalOffset) const
+	{
+		if (pageSize_ == 0)
+		{
+			outLocalOffset = offset;
+			return pBuffer_;
+		}
+		auto&& page = FindPage(offset);
+		outLocalOffset = offset - page.offset;
+		return page.pBuffer;
+	}
+
+	//----
+	BufferView* BufferHeapAllocator::GetBufferSRV(size_t offset, size_t& outLocalOffset) const
+	{
+		if (pageSize_ == 0)
+		{
+			outLocalOffset = offset;
+			return pBufferSrv_;
+		}
+		auto&& page = FindPage(offset);
+		outLocalOffset = offset - page.offset;
+		return page.pSrv;
+	}
+
+	//----
+	D3D12_GPU_VIRTUAL_ADDRESS BufferHeapAllocator::GetGpuAddress(size_t offset) const
+	{
+		size_t localOffset;
+		Buffer* pBuffer = GetBuffer(offset, localOffset);
+		return pBuffer->GetResourceDep()->GetGPUVirtualAddress() + localOffset;
+	}
+
+	//----
+	void BufferHeapAllocator::BeginNewFrame(CommandList* pCmdList)
+	{
+		if (nextBufferSize_ > 0)
+		{
+			hooks_.copyBufferFn(pCmdList, pNextBuffer_, pBuffer_, bufferSize_);
+			growCopyBytes_ += bufferSize_;
+
+			hooks_.killBufferFn(pBuffer_, pBufferSrv_);
+
+			pBuffer_ = pNextBuffer_;
+			pBufferSrv_ = pNextBufferSrv_;
+			bufferSize_ = nextBufferSize_;
+			pNextBuffer_ = nullptr;
+			pNextBufferSrv_ = nullptr;
+			nextBufferSize_ = 0;
+		}
+	}
+
+}	// namespace sl12
+
+
+//	EOF
@@ -69,6 +69,23 @@ namespace sl12
 		dynamicDescInfo_.Free();
 	}
 
+	//----
+	void ConstantBufferView::UpdateView(Device* pDev, Buffer* pBuffer, size_t offset, size_t size)
+	{
+		assert(descInfo_.IsValid());
+		assert((offset % D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT) == 0);
+		assert((size % D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT) == 0);
+
+		D3D12_CONSTANT_BUFFER_VIEW_DESC viewDesc{};
+		viewDesc.BufferLocation = pBuffer->GetResourceDep()->GetGPUVirtualAddress() + offset;
+		viewDesc.SizeInBytes = static_cast<u32>(size);
+		pDev->GetDeviceDep()->CreateConstantBufferView(&viewDesc, descInfo_.cpuHandle);
+		if (dynamicDescInfo_.IsValid())
+		{
+			pDev->GetDeviceDep()->CreateConstantBufferView(&viewDesc, dynamicDescInfo_.cpuHandle);
+		}
+	}
+
 
 	//----
 	bool VertexBufferView::Initialize(Device* pDev, Buffer* pBuffer, size_t offset, size_t size)
@@ -216,12 +233,24 @@ namespace sl12
 			}
 		}
 
+		// register to bindless registry.
+		pBindless_ = pDev->GetBindlessRegistry();
+		if (pBindless_)
+		{
+			bindlessHandle_ = pBindless_->Register(descInfo_.cpuHandle);
+		}
+
 		return true;
 	}
 
 	//----
 	void BufferView::Destroy()
 	{
+		if (pBindless_)
+		{
+			pBindless_->Unregister(bindlessHandle_);
+			pBindless_ = nullptr;
+		}
 		descInfo_.Free();
 		dynamicDescInfo_.Free();
 	}
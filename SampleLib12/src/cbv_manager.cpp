@@ -1,10 +1,16 @@
 ﻿#include <sl12/cbv_manager.h>
 #include <algorithm>
+#include <atomic>
 #include <sl12/command_list.h>
 
 
 namespace sl12
 {
+	namespace
+	{
+		std::atomic<u64>	sCbvManagerId(0);
+	}
+
 	//----------------
 	//----
 	CbvInstance::CbvInstance(Device* pDev, BufferSuballocAllocator* Allocator, const BufferSuballocInfo& Mem, ConstantBufferView* View, u32 Size)
@@ -73,14 +79,28 @@ namespace sl12
 
 
 	//----------------
+	//----
+	CbvManager::LinearPage::~LinearPage()
+	{
+		for (auto&& inst : instances)
+		{
+			delete inst;
+		}
+		instances.clear();
+		buffer.Reset();
+	}
+
 	//----
 	CbvManager::CbvManager(Device* pDev)
 		: pParentDevice_(pDev)
 	{
+		managerId_ = ++sCbvManagerId;
+
 		const size_t kBlockSize = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
 		residentAllocator_ = MakeUnique<BufferSuballocAllocator>(nullptr, pDev, kBlockSize, BufferHeap::Default, ResourceUsage::ConstantBuffer, D3D12_RESOURCE_STATE_COMMON);
 		temporalAllocator_ = MakeUnique<BufferSuballocAllocator>(nullptr, pDev, kBlockSize, BufferHeap::Dynamic, ResourceUsage::ConstantBuffer, D3D12_RESOURCE_STATE_GENERIC_READ);
 		ringBuffer_ = MakeUnique<CopyRingBuffer>(nullptr, pDev);
+		uploadBatcher_ = MakeUnique<UploadBatcher>(nullptr, &ringBuffer_);
 	}
 
 	//----
@@ -109,9 +129,29 @@ namespace sl12
 		}
 		residentUnused_.clear();
 		temporalUnused_.clear();
+
+		for (auto&& ctx : linearContexts_)
+		{
+			for (auto&& page : ctx.second->usedPages)
+			{
+				delete page;
+			}
+		}
+		for (auto&& page : linearFreePages_)
+		{
+			delete page;
+		}
+		for (auto&& page : linearPendingPages_)
+		{
+			delete page;
+		}
+		linearContexts_.clear();
+		linearFreePages_.clear();
+		linearPendingPages_.clear();
 		
 		residentAllocator_.Reset();
 		temporalAllocator_.Reset();
+		uploadBatcher_.Reset();
 		ringBuffer_.Reset();
 	}
 
@@ -147,6 +187,63 @@ namespace sl12
 
 	//----
 	CbvHandle CbvManager::GetTemporal(const void* pData, size_t size)
+	{
+		const size_t kBlockSize = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+		u32 allocSize = (u32)GetAlignedSize(size, kBlockSize);
+
+		// too large for linear page.
+		if (allocSize > kLinearPageSize)
+		{
+			return GetTemporalFromPool(pData, size);
+		}
+
+		// this thread's page is not shared with other threads.
+		auto pCtx = GetLinearContext();
+		pCtx->requestCount++;
+		pCtx->requestBytes += allocSize;
+
+		// find same payload in this frame.
+		// 64bit hash and size are compared, mapped memory is not read back.
+		u64 hash = 0;
+		if (isTemporalDedupe_)
+		{
+			hash = CalcMurmur64(pData, size, size);
+			auto findIt = pCtx->dedupeMap.find(hash);
+			if (findIt != pCtx->dedupeMap.end() && findIt->second->allocSize_ == allocSize)
+			{
+				pCtx->hitCount++;
+				pCtx->savedBytes += allocSize;
+				return CbvHandle(this, findIt->second);
+			}
+		}
+
+		auto pPage = pCtx->pCurrentPage;
+		if (!pPage || (pPage->offset + allocSize > kLinearPageSize))
+		{
+			pPage = AcquireLinearPage();
+			pCtx->pCurrentPage = pPage;
+			pCtx->usedPages.push_back(pPage);
+		}
+		assert(pPage->instanceCount < (u32)pPage->instances.size());
+
+		u32 offset = pPage->offset;
+		auto pInst = pPage->instances[pPage->instanceCount++];
+		pPage->offset += allocSize;
+
+		memcpy(pPage->pMapped + offset, pData, size);
+		pInst->view_->UpdateView(pParentDevice_, &pPage->buffer, offset, allocSize);
+		pInst->allocSize_ = allocSize;
+
+		if (isTemporalDedupe_)
+		{
+			pCtx->dedupeMap[hash] = pInst;
+		}
+
+		return CbvHandle(this, pInst);
+	}
+
+	//----
+	CbvHandle CbvManager::GetTemporalFromPool(const void* pData, size_t size)
 	{
 		std::lock_guard<std::mutex> lock(mutex_);
 
@@ -190,11 +287,88 @@ namespace sl12
 		return CbvHandle(this, pInst);
 	}
 
+	//----
+	CbvManager::LinearContext* CbvManager::GetLinearContext()
+	{
+		struct ContextCache
+		{
+			u64				managerId = 0;
+			LinearContext*	pContext = nullptr;
+		};	// struct ContextCache
+		thread_local ContextCache tCache;
+
+		if (tCache.managerId == managerId_)
+		{
+			return tCache.pContext;
+		}
+
+		std::lock_guard<std::mutex> lock(linearMutex_);
+
+		auto&& ctx = linearContexts_[std::this_thread::get_id()];
+		if (!ctx)
+		{
+			ctx = std::make_unique<LinearContext>();
+		}
+		tCache.managerId = managerId_;
+		tCache.pContext = ctx.get();
+		return tCache.pContext;
+	}
+
+	//----
+	CbvManager::LinearPage* CbvManager::AcquireLinearPage()
+	{
+		{
+			std::lock_guard<std::mutex> lock(linearMutex_);
+			if (!linearFreePages_.empty())
+			{
+				auto pPage = linearFreePages_.back();
+				linearFreePages_.pop_back();
+				return pPage;
+			}
+		}
+
+		// create new page.
+		const size_t kBlockSize = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+		auto pPage = new LinearPage();
+
+		BufferDesc desc{};
+		desc.size = kLinearPageSize;
+		desc.usage = ResourceUsage::ConstantBuffer;
+		desc.heap = BufferHeap::Dynamic;
+		desc.initialState = D3D12_RESOURCE_STATE_GENERIC_READ;
+		pPage->buffer = MakeUnique<Buffer>(pParentDevice_);
+		bool isSucceeded = pPage->buffer->Initialize(pParentDevice_, desc);
+		assert(isSucceeded);
+		pPage->pMapped = (u8*)pPage->buffer->Map();
+
+		// descriptors are allocated once per page from global allocator, and rewritten at every allocation.
+		// pages are recycled, so GetTemporal does not allocate descriptors after warm up.
+		// per-thread stack is not used, because bindless index of the view must be alive while page is pending.
+		pPage->instances.resize(kLinearPageSlotCount);
+		for (u32 i = 0; i < kLinearPageSlotCount; i++)
+		{
+			auto cbv = new ConstantBufferView();
+			bool isCbvInit = cbv->Initialize(pParentDevice_, &pPage->buffer, i * kBlockSize, kBlockSize);
+			assert(isCbvInit);
+			auto pInst = new CbvInstance(pParentDevice_, nullptr, BufferSuballocInfo(), cbv, (u32)kBlockSize);
+			pInst->isLinear_ = true;
+			pPage->instances[i] = pInst;
+		}
+
+		return pPage;
+	}
+
 	//----
 	void CbvManager::ReturnInstance(CbvInstance* Instance)
 	{
 		assert(Instance != nullptr);
 
+		// linear instances are reset in bulk.
+		if (Instance->isLinear_)
+		{
+			return;
+		}
+
 		Instance->pendingCount_ = 2;
 
 		std::lock_guard<std::mutex> lock(mutex_);
@@ -237,8 +411,49 @@ namespace sl12
 			}
 		}
 
+		// retire linear pages used in previous frame.
+		{
+			std::lock_guard<std::mutex> linearLock(linearMutex_);
+
+			std::vector<LinearPage*> pages;
+			pages.swap(linearPendingPages_);
+			for (auto&& page : pages)
+			{
+				if (page->pendingCount > 0)
+				{
+					page->pendingCount--;
+					linearPendingPages_.push_back(page);
+					continue;
+				}
+
+				page->offset = 0;
+				page->instanceCount = 0;
+				linearFreePages_.push_back(page);
+			}
+
+			lastTemporalStats_ = TemporalStats();
+			for (auto&& ctx : linearContexts_)
+			{
+				lastTemporalStats_.requestCount += ctx.second->requestCount;
+				lastTemporalStats_.hitCount += ctx.second->hitCount;
+				lastTemporalStats_.requestBytes += ctx.second->requestBytes;
+				lastTemporalStats_.savedBytes += ctx.second->savedBytes;
+				ctx.second->requestCount = ctx.second->hitCount = 0;
+				ctx.second->requestBytes = ctx.second->savedBytes = 0;
+				ctx.second->dedupeMap.clear();
+
+				for (auto&& page : ctx.second->usedPages)
+				{
+					page->pendingCount = 2;
+					linearPendingPages_.push_back(page);
+				}
+				ctx.second->usedPages.clear();
+				ctx.second->pCurrentPage = nullptr;
+			}
+		}
+
 		ringBuffer_->BeginNewFrame();
-		copyRequests_.clear();
+		uploadBatcher_->Clear();
 	}
 
 	//----
@@ -249,48 +464,15 @@ namespace sl12
 			return;
 		}
 
-		CopyRequest req{};
-		req.copySrc = ringBuffer_->CopyToRing(pData, (u32)size);
-		req.copyDst = Handle.pInstance_;
-
-		std::lock_guard<std::mutex> lock(mutex_);
-		copyRequests_.push_back(req);
+		auto&& mem = Handle.pInstance_->memInfo_;
+		uploadBatcher_->RequestCopy(mem.GetBuffer(), (u32)mem.GetOffset(), pData, (u32)size);
 	}
 
 	//----
 	void CbvManager::ExecuteCopy(CommandList* pCmdList, bool bTransition)
 	{
-		std::lock_guard<std::mutex> lock(mutex_);
-
-		std::sort(copyRequests_.begin(), copyRequests_.end(),
-			[](const CopyRequest& l, const CopyRequest& r) { return l.copyDst->memInfo_.GetBuffer() < r.copyDst->memInfo_.GetBuffer(); });
-
-		Buffer* prev = nullptr;
-		std::vector<Buffer*> transitions;
-		transitions.reserve(copyRequests_.size());
-		for (auto&& req : copyRequests_)
-		{
-			if (prev != req.copyDst->memInfo_.GetBuffer() && bTransition)
-			{
-				prev = req.copyDst->memInfo_.GetBuffer();
-				transitions.push_back(prev);
-
-				pCmdList->TransitionBarrier(req.copyDst->memInfo_.GetBuffer(), D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_COPY_DEST);
-			}
-
-			pCmdList->GetLatestCommandList()->CopyBufferRegion(
-				req.copyDst->memInfo_.GetBuffer()->GetResourceDep(), req.copyDst->memInfo_.GetOffset(),
-				req.copySrc.pBuffer->GetResourceDep(), req.copySrc.offset, req.copySrc.size);
-		}
-
-		if (bTransition)
-		{
-			for (auto&& t : transitions)
-			{
-				pCmdList->AddTransitionBarrier(t, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ);
-			}
-			pCmdList->FlushBarriers();
-		}
+		// contiguous resident cbs are merged to one copy command.
+		uploadBatcher_->Flush(pCmdList, bTransition);
 	}
 
 }   // namespace sl12
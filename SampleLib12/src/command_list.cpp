@@ -8,6 +8,7 @@
 #include <sl12/descriptor_set.h>
 #include <sl12/root_signature.h>
 #include <sl12/pipeline_state.h>
+#include <sl12/bindless_registry.h>
 
 #define USE_PIX 1
 #include <pix3.h>
@@ -66,7 +67,11 @@ namespace sl12
 	{
 		pParentQueue_ = nullptr;
 		SafeDelete(pSamplerDescCache_);
-		SafeDelete(pViewDescStack_);
+		if (pViewDescStack_)
+		{
+			pViewDescStack_->Destroy();
+			SafeDelete(pViewDescStack_);
+		}
 		SafeRelease(pLatestCmdList_);
 		SafeRelease(pCmdList_);
 		SafeRelease(pCmdAllocator_);
@@ -83,6 +88,11 @@ namespace sl12
 
 		if (pViewDescStack_)
 			pViewDescStack_->Reset();
+		for (auto&& entry : viewTableCache_)
+		{
+			entry = ViewTableCacheEntry();
+		}
+		viewTableKeys_.clear();
 
 		changeHeap_ = true;
 	}
@@ -301,11 +311,49 @@ namespace sl12
 		}
 	}
 
+	//----
+	// copy view descriptors to view stack and return gpu handle of the table.
+	// same table in this command list is reused without copy.
+	D3D12_GPU_DESCRIPTOR_HANDLE CommandList::CopyViewDescriptorTable(u32 count, const D3D12_CPU_DESCRIPTOR_HANDLE* handles)
+	{
+		auto def_view = pParentDevice_->GetDefaultViewDescInfo().cpuHandle;
+
+		viewHandleScratch_.resize(count);
+		for (u32 i = 0; i < count; i++)
+		{
+			viewHandleScratch_[i] = (handles[i].ptr > 0) ? handles[i] : def_view;
+		}
+
+		// stack is reset with this command list, so cached tables are alive until Reset().
+		auto hash = CalcMurmur64(viewHandleScratch_.data(), sizeof(D3D12_CPU_DESCRIPTOR_HANDLE) * count, count);
+		auto&& entry = viewTableCache_[hash % kViewTableCacheSize];
+		// verify full key, hash collision must not return wrong views.
+		if (entry.count == count && entry.hash == hash
+			&& memcmp(viewTableKeys_.data() + entry.keyOffset, viewHandleScratch_.data(), sizeof(D3D12_CPU_DESCRIPTOR_HANDLE) * count) == 0)
+		{
+			return entry.gpuHandle;
+		}
+
+		D3D12_CPU_DESCRIPTOR_HANDLE dst_cpu;
+		D3D12_GPU_DESCRIPTOR_HANDLE dst_gpu;
+		pViewDescStack_->Allocate(count, dst_cpu, dst_gpu);
+		pParentDevice_->GetDeviceDep()->CopyDescriptors(
+			1, &dst_cpu, &count,
+			count, viewHandleScratch_.data(), nullptr,
+			D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+		entry.hash = hash;
+		entry.keyOffset = (u32)viewTableKeys_.size();
+		entry.count = count;
+		entry.gpuHandle = dst_gpu;
+		viewTableKeys_.insert(viewTableKeys_.end(), viewHandleScratch_.begin(), viewHandleScratch_.end());
+		return dst_gpu;
+	}
+
 	//----
 	void CommandList::SetGraphicsRootSignatureAndDescriptorSet(RootSignature* pRS, DescriptorSet* pDSet, const std::vector<std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>>* pBindlessArrays)
 	{
 		auto pCmdList = GetCommandList();
-		auto def_view = pParentDevice_->GetDefaultViewDescInfo().cpuHandle;
 		auto def_sampler = pParentDevice_->GetDefaultSamplerDescInfo().cpuHandle;
 
 		auto&& input_index = pRS->GetInputIndex();
@@ -341,10 +389,9 @@ namespace sl12
 		}
 		if (sampler_count > 0)
 		{
-			bool isSuccess = pSamplerDescCache_->AllocateAndCopy(sampler_count, sampler_handles, samplerGpuHandle);
+			bool isSuccess = pSamplerDescCache_->AllocateAndCopy(sampler_count, sampler_handles, samplerGpuHandle, pCurrentSamplerHeap_);
 			assert(isSuccess);
 
-			pCurrentSamplerHeap_ = pSamplerDescCache_->GetHeap();
 			if (pCurrentSamplerHeap_ != pPrevSamplerHeap_)
 			{
 				pPrevSamplerHeap_ = pCurrentSamplerHeap_;
@@ -389,20 +436,7 @@ namespace sl12
 		{
 			if (count > 0)
 			{
-				std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> tmp;
-				tmp.resize(count);
-				for (u32 i = 0; i < count; i++)
-				{
-					tmp[i] = (handles[i].ptr > 0) ? handles[i] : def_view;
-				}
-
-				D3D12_CPU_DESCRIPTOR_HANDLE dst_cpu;
-				D3D12_GPU_DESCRIPTOR_HANDLE dst_gpu;
-				pViewDescStack_->Allocate(count, dst_cpu, dst_gpu);
-				pParentDevice_->GetDeviceDep()->CopyDescriptors(
-					1, &dst_cpu, &count,
-					count, tmp.data(), nullptr,
-					D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+				auto dst_gpu = CopyViewDescriptorTable(count, handles);
 				pCmdList->SetGraphicsRootDescriptorTable(index, dst_gpu);
 			}
 		};
@@ -419,7 +453,7 @@ namespace sl12
 		SetViewDesc(pDSet->GetDsSrv().maxCount, pDSet->GetDsSrv().cpuHandles, input_index.dsSrvIndex_);
 
 		// set bindless srv.
-		auto bindless_infos = pRS->GetBindlessInfos();
+		auto&& bindless_infos = pRS->GetBindlessInfos();
 		if (pBindlessArrays && bindless_infos.size() == pBindlessArrays->size())
 		{
 			auto& bindlessArrays = *pBindlessArrays;
@@ -433,13 +467,21 @@ namespace sl12
 				}
 			}
 		}
+		else if (!bindless_infos.empty() && pParentDevice_->GetBindlessRegistry())
+		{
+			// persistent registry is bound as one table. shaders use view's bindless index.
+			auto registryTable = pParentDevice_->GetBindlessRegistry()->GetTableGpuHandle();
+			for (auto&& info : bindless_infos)
+			{
+				pCmdList->SetGraphicsRootDescriptorTable(info.index_, registryTable);
+			}
+		}
 	}
 
 	//----
 	void CommandList::SetMeshRootSignatureAndDescriptorSet(RootSignature* pRS, DescriptorSet* pDSet, const std::vector<std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>>* pBindlessArrays)
 	{
 		auto pCmdList = GetCommandList();
-		auto def_view = pParentDevice_->GetDefaultViewDescInfo().cpuHandle;
 		auto def_sampler = pParentDevice_->GetDefaultSamplerDescInfo().cpuHandle;
 
 		auto&& input_index = pRS->GetInputIndex();
@@ -467,10 +509,9 @@ namespace sl12
 		}
 		if (sampler_count > 0)
 		{
-			bool isSuccess = pSamplerDescCache_->AllocateAndCopy(sampler_count, sampler_handles, samplerGpuHandle);
+			bool isSuccess = pSamplerDescCache_->AllocateAndCopy(sampler_count, sampler_handles, samplerGpuHandle, pCurrentSamplerHeap_);
 			assert(isSuccess);
 
-			pCurrentSamplerHeap_ = pSamplerDescCache_->GetHeap();
 			if (pCurrentSamplerHeap_ != pPrevSamplerHeap_)
 			{
 				pPrevSamplerHeap_ = pCurrentSamplerHeap_;
@@ -513,20 +554,7 @@ namespace sl12
 		{
 			if (count > 0)
 			{
-				std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> tmp;
-				tmp.resize(count);
-				for (u32 i = 0; i < count; i++)
-				{
-					tmp[i] = (handles[i].ptr > 0) ? handles[i] : def_view;
-				}
-
-				D3D12_CPU_DESCRIPTOR_HANDLE dst_cpu;
-				D3D12_GPU_DESCRIPTOR_HANDLE dst_gpu;
-				pViewDescStack_->Allocate(count, dst_cpu, dst_gpu);
-				pParentDevice_->GetDeviceDep()->CopyDescriptors(
-					1, &dst_cpu, &count,
-					count, tmp.data(), nullptr,
-					D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+				auto dst_gpu = CopyViewDescriptorTable(count, handles);
 				pCmdList->SetGraphicsRootDescriptorTable(index, dst_gpu);
 			}
 		};
@@ -540,7 +568,7 @@ namespace sl12
 		SetViewDesc(pDSet->GetPsUav().maxCount, pDSet->GetPsUav().cpuHandles, input_index.psUavIndex_);
 
 		// set bindless srv.
-		auto bindless_infos = pRS->GetBindlessInfos();
+		auto&& bindless_infos = pRS->GetBindlessInfos();
 		if (pBindlessArrays && bindless_infos.size() == pBindlessArrays->size())
 		{
 			auto& bindlessArrays = *pBindlessArrays;
@@ -554,13 +582,21 @@ namespace sl12
 				}
 			}
 		}
+		else if (!bindless_infos.empty() && pParentDevice_->GetBindlessRegistry())
+		{
+			// persistent registry is bound as one table. shaders use view's bindless index.
+			auto registryTable = pParentDevice_->GetBindlessRegistry()->GetTableGpuHandle();
+			for (auto&& info : bindless_infos)
+			{
+				pCmdList->SetGraphicsRootDescriptorTable(info.index_, registryTable);
+			}
+		}
 	}
 
 	//----
 	void CommandList::SetComputeRootSignatureAndDescriptorSet(RootSignature* pRS, DescriptorSet* pDSet, const std::vector<std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>>* pBindlessArrays)
 	{
 		auto pCmdList = GetCommandList();
-		auto def_view = pParentDevice_->GetDefaultViewDescInfo().cpuHandle;
 		auto def_sampler = pParentDevice_->GetDefaultSamplerDescInfo().cpuHandle;
 
 		auto&& input_index = pRS->GetInputIndex();
@@ -579,10 +615,9 @@ namespace sl12
 		}
 		if (sampler_count > 0)
 		{
-			bool isSuccess = pSamplerDescCache_->AllocateAndCopy(sampler_count, sampler_handles, samplerGpuHandle);
+			bool isSuccess = pSamplerDescCache_->AllocateAndCopy(sampler_count, sampler_handles, samplerGpuHandle, pCurrentSamplerHeap_);
 			assert(isSuccess);
 
-			pCurrentSamplerHeap_ = pSamplerDescCache_->GetHeap();
 			if (pCurrentSamplerHeap_ != pPrevSamplerHeap_)
 			{
 				pPrevSamplerHeap_ = pCurrentSamplerHeap_;
@@ -622,20 +657,7 @@ namespace sl12
 		{
 			if (count > 0)
 			{
-				std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> tmp;
-				tmp.resize(count);
-				for (u32 i = 0; i < count; i++)
-				{
-					tmp[i] = (handles[i].ptr > 0) ? handles[i] : def_view;
-				}
-
-				D3D12_CPU_DESCRIPTOR_HANDLE dst_cpu;
-				D3D12_GPU_DESCRIPTOR_HANDLE dst_gpu;
-				pViewDescStack_->Allocate(count, dst_cpu, dst_gpu);
-				pParentDevice_->GetDeviceDep()->CopyDescriptors(
-					1, &dst_cpu, &count,
-					count, tmp.data(), nullptr,
-					D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+				auto dst_gpu = CopyViewDescriptorTable(count, handles);
 				pCmdList->SetComputeRootDescriptorTable(index, dst_gpu);
 			}
 		};
@@ -644,7 +666,7 @@ namespace sl12
 		SetViewDesc(pDSet->GetCsUav().maxCount, pDSet->GetCsUav().cpuHandles, input_index.csUavIndex_);
 
 		// set bindless srv.
-		auto bindless_infos = pRS->GetBindlessInfos();
+		auto&& bindless_infos = pRS->GetBindlessInfos();
 		if (pBindlessArrays && bindless_infos.size() == pBindlessArrays->size())
 		{
 			auto& bindlessArrays = *pBindlessArrays;
@@ -658,6 +680,15 @@ namespace sl12
 				}
 			}
 		}
+		else if (!bindless_infos.empty() && pParentDevice_->GetBindlessRegistry())
+		{
+			// persistent registry is bound as one table. shaders use view's bindless index.
+			auto registryTable = pParentDevice_->GetBindlessRegistry()->GetTableGpuHandle();
+			for (auto&& info : bindless_infos)
+			{
+				pCmdList->SetComputeRootDescriptorTable(info.index_, registryTable);
+			}
+		}
 	}
 
 	//----
@@ -111,8 +111,11 @@ namespace sl12
 			return false;
 		}
 
-		pUseFlags_ = new u8[desc.NumDescriptors];
-		memset(pUseFlags_, 0, sizeof(u8) * desc.NumDescriptors);
+		if (!indexAllocator_.Initialize(desc.NumDescriptors))
+		{
+			SafeRelease(pHeap_);
+			return false;
+		}
 
 		cpuHandleStart_ = pHeap_->GetCPUDescriptorHandleForHeapStart();
 		if (desc.Flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE)
@@ -126,8 +129,6 @@ namespace sl12
 
 		heapDesc_ = desc;
 		descSize_ = pDev->GetDeviceDep()->GetDescriptorHandleIncrementSize(desc.Type);
-		allocCount_ = 0;
-		currentPosition_ = 0;
 
 		return true;
 	}
@@ -135,10 +136,8 @@ namespace sl12
 	//----
 	void DescriptorAllocator::Destroy()
 	{
-		assert(allocCount_ == 0);
-
+		indexAllocator_.Destroy();
 		SafeRelease(pHeap_);
-		SafeDeleteArray(pUseFlags_);
 	}
 
 	//----
@@ -146,31 +145,19 @@ namespace sl12
 	{
 		DescriptorInfo ret;
 
-		std::lock_guard<std::mutex> lock(mutex_);
-
-		if (allocCount_ == heapDesc_.NumDescriptors)
-			return ret;
-
-		auto cp = currentPosition_;
-		for (u32 i = 0; i < heapDesc_.NumDescriptors; i++, cp++)
+		u32 index;
+		if (!indexAllocator_.Allocate(index))
 		{
-			cp = cp % heapDesc_.NumDescriptors;
-			if (!pUseFlags_[cp])
-			{
-				pUseFlags_[cp] = 1;
-				ret.pAllocator = this;
-				ret.cpuHandle = cpuHandleStart_;
-				ret.gpuHandle = gpuHandleStart_;
-				ret.cpuHandle.ptr += descSize_ * cp;
-				ret.gpuHandle.ptr += descSize_ * cp;
-				ret.index = cp;
-
-				currentPosition_ = cp + 1;
-				allocCount_++;
-				break;
-			}
+			return ret;
 		}
 
+		ret.pAllocator = this;
+		ret.cpuHandle = cpuHandleStart_;
+		ret.gpuHandle = gpuHandleStart_;
+		ret.cpuHandle.ptr += descSize_ * index;
+		ret.gpuHandle.ptr += descSize_ * index;
+		ret.index = index;
+
 		return ret;
 	}
 
@@ -178,11 +165,9 @@ namespace sl12
 	void DescriptorAllocator::Free(DescriptorInfo info)
 	{
 		assert(info.pAllocator == this);
-		assert(pUseFlags_[info.index] != 0);
+		assert(info.index < heapDesc_.NumDescriptors);
 
-		std::lock_guard<std::mutex> lock(mutex_);
-		pUseFlags_[info.index] = 0;
-		allocCount_--;
+		indexAllocator_.Free(info.index);
 	}
 
 
@@ -208,23 +193,44 @@ namespace sl12
 	{
 		pParentHeap_ = parent;
 		stackIndex_ = 0;
+		usage_ = peakUsage_ = 0;
+
+		return AddStack(kStackSize);
+	}
 
-		return AddStack();
+	//----
+	void DescriptorStackList::Destroy()
+	{
+		if (pParentHeap_)
+		{
+			for (auto&& stack : stacks_)
+			{
+				pParentHeap_->FreeStack(stack);
+			}
+		}
+		stacks_.clear();
+		stackIndex_ = 0;
+		pParentHeap_ = nullptr;
 	}
 
 	//----
 	void DescriptorStackList::Allocate(u32 count, D3D12_CPU_DESCRIPTOR_HANDLE& cpuHandle, D3D12_GPU_DESCRIPTOR_HANDLE& gpuHandle)
 	{
+		usage_ += count;
+
 		if (stacks_[stackIndex_].Allocate(count, cpuHandle, gpuHandle))
 			return;
 
-		stackIndex_++;
-		if (stacks_.size() <= stackIndex_)
+		// find next stack that has enough space.
+		for (stackIndex_++; stackIndex_ < stacks_.size(); stackIndex_++)
 		{
-			if (!AddStack())
-				assert(!"[ERROR] Stack Empty!!");
+			if (stacks_[stackIndex_].Allocate(count, cpuHandle, gpuHandle))
+				return;
 		}
 
+		if (!AddStack(std::max(count, kStackSize)))
+			assert(!"[ERROR] Stack Empty!!");
+
 		if (!stacks_[stackIndex_].Allocate(count, cpuHandle, gpuHandle))
 			assert(!"[ERROR] Stack Empty!!");
 	}
@@ -232,18 +238,30 @@ namespace sl12
 	//----
 	void DescriptorStackList::Reset()
 	{
+		// return unused stacks. first stack is always kept.
+		u32 keepCount = stackIndex_ + 1;
+		while (stacks_.size() > keepCount)
+		{
+			pParentHeap_->FreeStack(stacks_.back());
+			stacks_.pop_back();
+		}
+
 		for (auto&& stack : stacks_) stack.Reset();
 		stackIndex_ = 0;
+		peakUsage_ = std::max(peakUsage_, usage_);
+		usage_ = 0;
 	}
 
 	//----
-	bool DescriptorStackList::AddStack()
+	bool DescriptorStackList::AddStack(u32 count)
 	{
 		DescriptorStack stack;
-		stacks_.push_back(stack);
+		if (!pParentHeap_->AllocateStack(stack, count))
+			return false;
 
-		auto&& s = stacks_.back();
-		return pParentHeap_->AllocateStack(s, 2000);
+		stacks_.push_back(stack);
+		stackIndex_ = (u32)stacks_.size() - 1;
+		return true;
 	}
 
 	//----
@@ -261,6 +279,7 @@ namespace sl12
 		heapDesc_ = desc;
 		descSize_ = pDev->GetDeviceDep()->GetDescriptorHandleIncrementSize(desc.Type);
 		allocCount_ = 0;
+		usedCount_ = peakUsedCount_ = 0;
 
 		return true;
 	}
@@ -268,6 +287,7 @@ namespace sl12
 	//----
 	void GlobalDescriptorHeap::Destroy()
 	{
+		freeStacks_.clear();
 		SafeRelease(pHeap_);
 	}
 
@@ -276,6 +296,21 @@ namespace sl12
 	{
 		std::lock_guard<std::mutex> lock(mutex_);
 
+		// reuse returned stack.
+		for (auto it = freeStacks_.begin(); it != freeStacks_.end(); it++)
+		{
+			if (it->stackMax_ >= count)
+			{
+				stack = *it;
+				stack.stackPosition_ = 0;
+				freeStacks_.erase(it);
+
+				usedCount_ += stack.stackMax_;
+				peakUsedCount_ = std::max(peakUsedCount_, usedCount_);
+				return true;
+			}
+		}
+
 		if (allocCount_ + count > heapDesc_.NumDescriptors)
 			return false;
 
@@ -288,10 +323,35 @@ namespace sl12
 		stack.stackPosition_ = 0;
 
 		allocCount_ += count;
+		usedCount_ += count;
+		peakUsedCount_ = std::max(peakUsedCount_, usedCount_);
 
 		return true;
 	}
 
+	//----
+	void GlobalDescriptorHeap::FreeStack(const DescriptorStack& stack)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		assert(usedCount_ >= stack.stackMax_);
+		usedCount_ -= stack.stackMax_;
+		freeStacks_.push_back(stack);
+	}
+
+	//----
+	GlobalDescriptorHeap::Stats GlobalDescriptorHeap::GetStats()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		Stats ret;
+		ret.totalCount = heapDesc_.NumDescriptors;
+		ret.reservedCount = allocCount_;
+		ret.usedCount = usedCount_;
+		ret.peakUsedCount = peakUsedCount_;
+		return ret;
+	}
+
 
 	//----
 	bool SamplerDescriptorHeap::Initialize(Device* pDev)
@@ -344,6 +404,9 @@ namespace sl12
 	{
 		pParentDevice_ = pDev;
 
+		table_.resize(256);
+		entryCount_ = 0;
+
 		return AddHeap();
 	}
 
@@ -351,6 +414,9 @@ namespace sl12
 	void SamplerDescriptorCache::Destroy()
 	{
 		heapList_.clear();
+		table_.clear();
+		keys_.clear();
+		entryCount_ = 0;
 	}
 
 	//----
@@ -366,15 +432,72 @@ namespace sl12
 	}
 
 	//----
-	bool SamplerDescriptorCache::AllocateAndCopy(u32 count, D3D12_CPU_DESCRIPTOR_HANDLE* cpuHandles, D3D12_GPU_DESCRIPTOR_HANDLE& gpuHandle)
+	SamplerDescriptorCache::CacheEntry* SamplerDescriptorCache::FindEntry(u64 hash, u32 count, const D3D12_CPU_DESCRIPTOR_HANDLE* cpuHandles)
+	{
+		const size_t mask = table_.size() - 1;
+		for (size_t i = hash & mask; ; i = (i + 1) & mask)
+		{
+			auto&& entry = table_[i];
+			if (entry.count == 0)
+			{
+				return nullptr;
+			}
+			// verify full key, hash collision must not return wrong samplers.
+			if (entry.hash == hash && entry.count == count
+				&& memcmp(&keys_[entry.keyOffset], cpuHandles, sizeof(D3D12_CPU_DESCRIPTOR_HANDLE) * count) == 0)
+			{
+				return &entry;
+			}
+		}
+	}
+
+	//----
+	void SamplerDescriptorCache::InsertEntry(const CacheEntry& entry)
 	{
+		// keep load factor under 0.75.
+		if ((entryCount_ + 1) * 4 > table_.size() * 3)
+		{
+			std::vector<CacheEntry> prev;
+			prev.swap(table_);
+			table_.resize(prev.size() * 2);
+			entryCount_ = 0;
+			for (auto&& e : prev)
+			{
+				if (e.count > 0)
+				{
+					InsertEntry(e);
+				}
+			}
+		}
+
+		const size_t mask = table_.size() - 1;
+		for (size_t i = entry.hash & mask; ; i = (i + 1) & mask)
+		{
+			if (table_[i].count == 0)
+			{
+				table_[i] = entry;
+				entryCount_++;
+				return;
+			}
+		}
+	}
+
+	//----
+	bool SamplerDescriptorCache::AllocateAndCopy(u32 count, const D3D12_CPU_DESCRIPTOR_HANDLE* cpuHandles, D3D12_GPU_DESCRIPTOR_HANDLE& gpuHandle, ID3D12DescriptorHeap*& pHeap)
+	{
+		assert(count > 0);
+
+		auto hash = CalcMurmur64(cpuHandles, sizeof(D3D12_CPU_DESCRIPTOR_HANDLE) * count, count);
+
+		std::lock_guard<std::mutex> lock(mutex_);
+
 		// キャッシュが存在するかどうか検索
-		auto hash = CalcFnv1a32(cpuHandles, sizeof(D3D12_CPU_DESCRIPTOR_HANDLE) * count);
-		auto findIt = descCache_.find(hash);
-		if (findIt != descCache_.end())
+		auto pEntry = FindEntry(hash, count, cpuHandles);
+		if (pEntry)
 		{
-			gpuHandle = findIt->second.gpuHandle;
-			pLastAllocateHeap_ = findIt->second.pHeap;
+			gpuHandle = pEntry->gpuHandle;
+			pHeap = pEntry->pHeap->GetHeap();
+			pLastAllocateHeap_ = pEntry->pHeap;
 			return true;
 		}
 
@@ -397,17 +520,44 @@ namespace sl12
 			D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
 
 		// キャッシュに保存しておく
-		MapItem item;
-		item.pHeap = pCurrentHeap_;
-		item.cpuHandle = ch;
-		item.gpuHandle = gpuHandle;
-		descCache_[hash] = item;
-
+		CacheEntry entry;
+		entry.hash = hash;
+		entry.keyOffset = (u32)keys_.size();
+		entry.count = count;
+		entry.pHeap = pCurrentHeap_;
+		entry.gpuHandle = gpuHandle;
+		keys_.insert(keys_.end(), cpuHandles, cpuHandles + count);
+		InsertEntry(entry);
+
+		pHeap = pCurrentHeap_->GetHeap();
 		pLastAllocateHeap_ = pCurrentHeap_;
 
 		return true;
 	}
 
+	//----
+	bool SamplerDescriptorCache::AllocateAndCopy(u32 count, const D3D12_CPU_DESCRIPTOR_HANDLE* cpuHandles, D3D12_GPU_DESCRIPTOR_HANDLE& gpuHandle)
+	{
+		ID3D12DescriptorHeap* pHeap;
+		return AllocateAndCopy(count, cpuHandles, gpuHandle, pHeap);
+	}
+
+	//----
+	bool SamplerDescriptorCache::Prewarm(const std::vector<std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>>& tables)
+	{
+		for (auto&& table : tables)
+		{
+			if (table.empty())
+				continue;
+
+			D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle;
+			ID3D12DescriptorHeap* pHeap;
+			if (!AllocateAndCopy((u32)table.size(), table.data(), gpuHandle, pHeap))
+				return false;
+		}
+		return true;
+	}
+
 
 	//----
 	bool RaytracingDescriptorHeap::Initialize(
@@ -0,0 +1,355 @@
+﻿#include <sl12/descriptor_index_allocator.h>
+
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <intrin.h>
+
+
+namespace sl12
+{
+	namespace
+	{
+		const u32	kInvalidWord = 0xffffffff;
+		const u64	kInvalidAllocatorId = 0;		// ids are pre-incremented, so 0 is never issued.
+
+		std::atomic<u64>	sDescriptorAllocatorId(kInvalidAllocatorId);
+
+		// initialized allocators. threads return their caches to these on exit.
+		std::mutex							sAllocatorListMutex;
+		std::vector<DescriptorIndexAllocator*>	sAllocatorList;
+
+		inline u32 CountTrailingZeros(u64 bits)
+		{
+			assert(bits != 0);
+			unsigned long index;
+			_BitScanForward64(&index, bits);
+			return (u32)index;
+		}
+	}
+
+	//----
+	struct DescriptorIndexAllocator::ThreadEntries
+	{
+		struct Entry
+		{
+			u64				allocatorId = kInvalidAllocatorId;
+			ThreadCache*	pCache = nullptr;
+		};	// struct Entry
+		static const u32 kEntryCount = 8;
+
+		Entry	entries[kEntryCount];
+		u32		nextEntry = 0;
+
+		~ThreadEntries()
+		{
+			// caches evicted from entries are also owned by this thread, so ask every allocator.
+			std::lock_guard<std::mutex> lock(sAllocatorListMutex);
+			auto threadId = std::this_thread::get_id();
+			for (auto&& allocator : sAllocatorList)
+			{
+				allocator->ReleaseThreadCache(threadId);
+			}
+		}
+	};	// struct ThreadEntries
+
+	//----
+	bool DescriptorIndexAllocator::Initialize(u32 slotCount)
+	{
+		assert(!IsInitialized());
+		if (slotCount == 0)
+		{
+			return false;
+		}
+
+		// all slots are free.
+		slotCount_ = slotCount;
+		wordCount_ = (slotCount + 63) / 64;
+		summaryCount_ = (wordCount_ + 63) / 64;
+		pFreeBits_ = new u64[wordCount_];
+		pSummaryBits_ = new u64[summaryCount_];
+		memset(pFreeBits_, 0xff, sizeof(u64) * wordCount_);
+		memset(pSummaryBits_, 0, sizeof(u64) * summaryCount_);
+		if (slotCount % 64)
+		{
+			pFreeBits_[wordCount_ - 1] = (1ULL << (slotCount % 64)) - 1;
+		}
+		for (u32 i = 0; i < wordCount_; i++)
+		{
+			pSummaryBits_[i / 64] |= 1ULL << (i % 64);
+		}
+
+		allocCount_ = 0;
+		currentPosition_ = 0;
+		allocatorId_ = ++sDescriptorAllocatorId;
+
+		std::lock_guard<std::mutex> lock(sAllocatorListMutex);
+		sAllocatorList.push_back(this);
+
+		return true;
+	}
+
+	//----
+	void DescriptorIndexAllocator::Destroy()
+	{
+		if (!IsInitialized())
+		{
+			return;
+		}
+
+		// exiting threads must not touch this allocator any more.
+		{
+			std::lock_guard<std::mutex> lock(sAllocatorListMutex);
+			auto it = std::find(sAllocatorList.begin(), sAllocatorList.end(), this);
+			if (it != sAllocatorList.end())
+			{
+				sAllocatorList.erase(it);
+			}
+		}
+
+		// return reserved slots.
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			for (auto&& cache : threadCaches_)
+			{
+				std::lock_guard<std::mutex> cacheLock(cache.second->mutex);
+				for (u32 i = 0; i < cache.second->count; i++)
+				{
+					FreeIndex(cache.second->indices[i]);
+				}
+				cache.second->count = 0;
+			}
+			threadCaches_.clear();
+		}
+		allocatorId_ = kInvalidAllocatorId;
+
+		assert(allocCount_ == 0);
+
+		delete[] pFreeBits_;
+		delete[] pSummaryBits_;
+		pFreeBits_ = nullptr;
+		pSummaryBits_ = nullptr;
+		slotCount_ = 0;
+	}
+
+	//----
+	DescriptorIndexAllocator::ThreadCache* DescriptorIndexAllocator::GetThreadCache()
+	{
+		thread_local ThreadEntries tEntries;
+
+		// not initialized, or already destroyed.
+		if (allocatorId_ == kInvalidAllocatorId)
+		{
+			return nullptr;
+		}
+
+		for (auto&& e : tEntries.entries)
+		{
+			if (e.allocatorId == allocatorId_)
+			{
+				return e.pCache;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		auto&& cache = threadCaches_[std::this_thread::get_id()];
+		if (!cache)
+		{
+			cache = std::make_unique<ThreadCache>();
+		}
+
+		auto&& e = tEntries.entries[tEntries.nextEntry];
+		tEntries.nextEntry = (tEntries.nextEntry + 1) % ThreadEntries::kEntryCount;
+		e.allocatorId = allocatorId_;
+		e.pCache = cache.get();
+		return e.pCache;
+	}
+
+	//----
+	// called when thread exits. sAllocatorListMutex is locked by caller.
+	void DescriptorIndexAllocator::ReleaseThreadCache(std::thread::id threadId)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		auto it = threadCaches_.find(threadId);
+		if (it == threadCaches_.end())
+		{
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> cacheLock(it->second->mutex);
+			for (u32 i = 0; i < it->second->count; i++)
+			{
+				FreeIndex(it->second->indices[i]);
+			}
+			it->second->count = 0;
+		}
+		threadCaches_.erase(it);
+	}
+
+	//----
+	// take slots reserved by other threads.
+	// mutex_ must be locked by caller. lock order is always mutex_ -> ThreadCache::mutex.
+	u32 DescriptorIndexAllocator::DrainThreadCaches(ThreadCache* pSelf, u32* pIndices, u32 count)
+	{
+		u32 taken = 0;
+		for (auto&& cache : threadCaches_)
+		{
+			if (taken == count)
+			{
+				break;
+			}
+			if (cache.second.get() == pSelf)
+			{
+				continue;
+			}
+
+			std::lock_guard<std::mutex> cacheLock(cache.second->mutex);
+			while (taken < count && cache.second->count > 0)
+			{
+				pIndices[taken++] = cache.second->indices[--cache.second->count];
+			}
+		}
+		return taken;
+	}
+
+	//----
+	// mutex_ must be locked by caller.
+	bool DescriptorIndexAllocator::AllocateIndex(u32& index)
+	{
+		if (allocCount_ == slotCount_)
+			return false;
+
+		// find a word that has free slot from current position.
+		u32 s = currentPosition_ / 64;
+		u64 bits = pSummaryBits_[s] & (~0ULL << (currentPosition_ % 64));
+		u32 word = kInvalidWord;
+		for (u32 i = 0; i <= summaryCount_; i++)
+		{
+			if (bits)
+			{
+				word = s * 64 + CountTrailingZeros(bits);
+				break;
+			}
+			s = (s + 1) % summaryCount_;
+			bits = pSummaryBits_[s];
+		}
+		if (word == kInvalidWord)
+			return false;
+
+		u32 bit = CountTrailingZeros(pFreeBits_[word]);
+		pFreeBits_[word] &= ~(1ULL << bit);
+		if (!pFreeBits_[word])
+		{
+			pSummaryBits_[word / 64] &= ~(1ULL << (word % 64));
+		}
+
+		index = word * 64 + bit;
+		currentPosition_ = word;
+		allocCount_++;
+		return true;
+	}
+
+	//----
+	// mutex_ must be locked by caller.
+	void DescriptorIndexAllocator::FreeIndex(u32 index)
+	{
+		u32 word = index / 64;
+		u64 mask = 1ULL << (index % 64);
+		assert((pFreeBits_[word] & mask) == 0);
+
+		pFreeBits_[word] |= mask;
+		pSummaryBits_[word / 64] |= 1ULL << (word % 64);
+		allocCount_--;
+	}
+
+	//----
+	bool DescriptorIndexAllocator::Allocate(u32& index)
+	{
+		auto pCache = GetThreadCache();
+		assert(pCache != nullptr);
+		if (!pCache)
+			return false;
+
+		{
+			std::lock_guard<std::mutex> cacheLock(pCache->mutex);
+			if (pCache->count > 0)
+			{
+				index = pCache->indices[--pCache->count];
+				return true;
+			}
+		}
+
+		// reserve some slots to thread cache at once.
+		// cache lock is not held here, because draining locks mutex_ first.
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		u32 refill[kThreadCacheRefill];
+		u32 count = 0;
+		while (count < kThreadCacheRefill && AllocateIndex(refill[count]))
+		{
+			count++;
+		}
+		if (count == 0)
+		{
+			// bitset is empty, but other threads may hold free slots.
+			count = DrainThreadCaches(pCache, refill, kThreadCacheRefill);
+			if (count == 0)
+				return false;
+		}
+
+		index = refill[--count];
+		if (count > 0)
+		{
+			std::lock_guard<std::mutex> cacheLock(pCache->mutex);
+			for (u32 i = 0; i < count; i++)
+			{
+				pCache->indices[pCache->count++] = refill[i];
+			}
+		}
+		return true;
+	}
+
+	//----
+	void DescriptorIndexAllocator::Free(u32 index)
+	{
+		assert(index < slotCount_);
+
+		auto pCache = GetThreadCache();
+		assert(pCache != nullptr);
+		if (!pCache)
+			return;
+
+		// return half of thread cache when it is full.
+		u32 overflow[kThreadCacheRefill];
+		u32 count = 0;
+		{
+			std::lock_guard<std::mutex> cacheLock(pCache->mutex);
+			if (pCache->count == kThreadCacheSize)
+			{
+				while (pCache->count > kThreadCacheSize - kThreadCacheRefill)
+				{
+					overflow[count++] = pCache->indices[--pCache->count];
+				}
+			}
+			pCache->indices[pCache->count++] = index;
+		}
+
+		if (count > 0)
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			for (u32 i = 0; i < count; i++)
+			{
+				FreeIndex(overflow[i]);
+			}
+		}
+	}
+
+}	// namespace sl12
+
+
+//	EOF
@@ -11,6 +11,7 @@
 #include <sl12/ring_buffer.h>
 #include <sl12/texture_streamer.h>
 #include <sl12/string_util.h>
+#include <sl12/bindless_registry.h>
 
 #ifdef _DEBUG
 #include <dxgidebug.h>
@@ -354,6 +355,15 @@ namespace sl12
 
 			defaultViewDescInfo_ = pViewDescHeap_->Allocate();
 			defaultSamplerDescInfo_ = pSamplerDescHeap_->Allocate();
+
+			if (devDesc.numBindless > 0)
+			{
+				pBindlessRegistry_ = new BindlessRegistry();
+				if (!pBindlessRegistry_->Initialize(this, pGlobalViewDescHeap_, devDesc.numBindless))
+				{
+					return false;
+				}
+			}
 		}
 
 		// create swapchain.
@@ -392,6 +402,20 @@ namespace sl12
 	//----
 	void Device::Destroy()
 	{
+		// discard unloaded commands.
+		for (auto p = PopAllCommands(queueCommandHead_); p; )
+		{
+			auto next = p->pNext;
+			delete p;
+			p = next;
+		}
+		for (auto p = PopAllCommands(renderCommandHead_); p; )
+		{
+			auto next = p->pNext;
+			delete p;
+			p = next;
+		}
+
 		// before clear death list.
 		pRingBuffer_.reset();
 		pTextureStreamAllocator_.reset();
@@ -403,6 +427,10 @@ namespace sl12
 		dummyTextureViews_.clear();
 		dummyTextures_.clear();
 
+		// bindless indices are freed through death list.
+		SyncKillObjects(true);
+		SafeDelete(pBindlessRegistry_);
+
 		SafeRelease(pFence_);
 
 		SafeDelete(pSwapchain_);
@@ -594,6 +622,53 @@ namespace sl12
 		return true;
 	}
 
+	//----
+	// load commands by phase order. commands added while loading are loaded next time.
+	void Device::LoadRenderCommands(CommandList* pCmdlist)
+	{
+		// producers are not blocked while loading.
+		for (auto p = PopAllCommands(renderCommandHead_); p; p = p->pNext)
+		{
+			renderCommandPhases_[p->GetPhase()].push_back(p);
+		}
+
+		for (auto&& phase : renderCommandPhases_)
+		{
+			if (phase.empty())
+			{
+				continue;
+			}
+
+			for (auto&& rc : phase)
+			{
+				rc->LoadCommand(pCmdlist);
+			}
+			for (auto&& rc : phase)
+			{
+				rc->LoadBarrier(pCmdlist);
+			}
+			pCmdlist->FlushBarriers();
+
+			for (auto&& rc : phase)
+			{
+				delete rc;
+			}
+			phase.clear();
+		}
+	}
+
+	//----
+	void Device::ExecuteQueueCommands()
+	{
+		for (auto p = PopAllCommands(queueCommandHead_); p; )
+		{
+			auto next = p->pNext;
+			p->ExecuteCommand(pGraphicsQueue_);
+			delete p;
+			p = next;
+		}
+	}
+
 	//----
 	void Device::CopyToBuffer(CommandList* pCmdList, Buffer* pDstBuffer, u32 dstOffset, const void* pSrcData, u32 srcSize)
 	{
@@ -2,333 +2,354 @@
 
 #include <sl12/device.h>
 #include <sl12/command_list.h>
+#include <sl12/swapchain.h>
+
+#include <algorithm>
 
 
 namespace sl12
 {
+	namespace
+	{
+		// one page per frame is enough to be recycled.
+		const size_t	kMaxFreeStagingPages = Swapchain::kMaxBuffer + 1;
+
+		BufferHeapAllocator::Hooks CreateDeviceHooks(Device* pDev, u32 usage)
+		{
+			BufferHeapAllocator::Hooks hooks;
+			hooks.createBufferFn = [pDev, usage](size_t size, Buffer*& outBuffer, BufferView*& outSrv)
+			{
+				BufferDesc creationDesc{};
+				creationDesc.size = size;
+				creationDesc.usage = usage | ResourceUsage::ShaderResource;
+				outBuffer = new Buffer();
+				if (!outBuffer->Initialize(pDev, creationDesc))
+				{
+					delete outBuffer;
+					outBuffer = nullptr;
+					return false;
+				}
+
+				outSrv = new BufferView();
+				bool bSuccess = outSrv->Initialize(pDev, outBuffer, 0, 0, 0);
+				assert(bSuccess);
+				return true;
+			};
+			hooks.killBufferFn = [pDev](Buffer* pBuffer, BufferView* pSrv)
+			{
+				if (pSrv)
+				{
+					pDev->KillObject(pSrv);
+				}
+				if (pBuffer)
+				{
+					pDev->KillObject(pBuffer);
+				}
+			};
+			hooks.copyBufferFn = [](CommandList* pCmdList, Buffer* pDst, Buffer* pSrc, size_t size)
+			{
+				pCmdList->TransitionBarrier(pDst, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_COPY_DEST);
+				pCmdList->GetLatestCommandList()->CopyBufferRegion(pDst->GetResourceDep(), 0, pSrc->GetResourceDep(), 0, size);
+			};
+			return hooks;
+		}
+	}
+
 	//----------------
 	//----
-	BufferHeapAllocator::BufferHeapAllocator(Device* pDev, size_t initSize, size_t align, u32 usage)
+	MeshManager::MeshManager(Device* pDev, size_t vertexSize, size_t indexSize, size_t pageSize)
 		: pParentDevice_(pDev)
-		, initSize_(initSize)
-		, alignment_(align)
-		, usage_(usage)
 	{
-		pBuffer_ = new Buffer();
-		pBufferSrv_ = new BufferView();
-
-		BufferDesc creationDesc{};
-		creationDesc.size = initSize;
-		creationDesc.usage = usage | ResourceUsage::ShaderResource;
-		bool bSuccess = pBuffer_->Initialize(pDev, creationDesc);
-		assert(bSuccess);
-
-		bSuccess = pBufferSrv_->Initialize(pDev, pBuffer_, 0, 0, 0);
-		assert(bSuccess);
-		
-		Block block;
-		block.size = initSize;
-		memoryBlocks_.push_back(block);
+		pVertexHeap_ = std::make_unique<BufferHeapAllocator>(CreateDeviceHooks(pDev, ResourceUsage::VertexBuffer), vertexSize, 4, pageSize);
+		pIndexHeap_ = std::make_unique<BufferHeapAllocator>(CreateDeviceHooks(pDev, ResourceUsage::IndexBuffer), indexSize, 4, pageSize);
 	}
 
 	//----
-	BufferHeapAllocator::~BufferHeapAllocator()
+	MeshManager::~MeshManager()
 	{
-		if (pBufferSrv_)
-		{
-			pParentDevice_->KillObject(pBufferSrv_);
-		}
-		if (pBuffer_)
-		{
-			pParentDevice_->KillObject(pBuffer_);
-		}
-		if (pNextBuffer_)
+		pVertexHeap_.reset(nullptr);
+		pIndexHeap_.reset(nullptr);
+
+		for (auto pages : { &stagingPages_, &freeStagingPages_ })
 		{
-			pParentDevice_->KillObject(pNextBuffer_);
+			for (auto&& page : *pages)
+			{
+				page->pBuffer->Unmap();
+				pParentDevice_->KillObject(page->pBuffer);
+			}
+			pages->clear();
 		}
 	}
 
 	//----
-	BufferHeapAllocator::Handle BufferHeapAllocator::Allocate(size_t inSize)
+	void MeshManager::BeginNewFrame(CommandList* pCmdList)
 	{
-		size_t alignedSize = GetAlignedSize(inSize, alignment_);
-		Handle ret;
-
-		// first fit search.
-		for (auto it = memoryBlocks_.begin(); it != memoryBlocks_.end(); it++)
+		auto BeginFunc = [pCmdList, this](BufferHeapAllocator* pHeap, std::vector<CopySrc>& src)
 		{
-			if (!it->isUsed && it->size >= alignedSize)
+			bool hasNext = pHeap->nextBufferSize_ > 0;
+			bool needDeploy = std::any_of(src.begin(), src.end(), [](const CopySrc& v) { return v.isReady; });
+
+			if (!hasNext && !needDeploy)
 			{
-				// allocate memory block.
-				Block newBlock(it->offset, alignedSize, true);
-				memoryBlocks_.insert(it, newBlock);
-				it->offset += alignedSize;
-				it->size -= alignedSize;
-				if (it->size == 0)
+				return;
+			}
+
+			pHeap->BeginNewFrame(pCmdList);
+
+			// destination buffers. pages with copies in paged mode.
+			std::vector<Buffer*> dstBuffers;
+			if (pHeap->IsPaged())
+			{
+				for (auto&& v : src)
 				{
-					memoryBlocks_.erase(it);
+					if (!v.isReady)
+					{
+						continue;
+					}
+					size_t localOffset;
+					Buffer* pBuffer = pHeap->GetBuffer(v.offset, localOffset);
+					if (std::find(dstBuffers.begin(), dstBuffers.end(), pBuffer) == dstBuffers.end())
+					{
+						dstBuffers.push_back(pBuffer);
+					}
 				}
-
-				ret.heap = this;
-				ret.offset = newBlock.offset;
-				ret.size = newBlock.size;
-				return ret;
 			}
-		}
+			else
+			{
+				dstBuffers.push_back(pHeap->pBuffer_);
+			}
 
-		// create new buffer.
-		if (CreateNewBuffer(alignedSize))
-		{
-			auto lastBlock = memoryBlocks_.end();
-			lastBlock--;
-
-			Block newBlock(lastBlock->offset, alignedSize, true);
-			lastBlock->offset += alignedSize;
-			lastBlock->size -= alignedSize;
-			memoryBlocks_.insert(lastBlock, newBlock);
-			if (lastBlock->size == 0)
+			if (!hasNext)
 			{
-				memoryBlocks_.erase(lastBlock);
+				for (auto pBuffer : dstBuffers)
+				{
+					pCmdList->TransitionBarrier(pBuffer, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_COPY_DEST);
+				}
 			}
 
-			ret.heap = this;
-			ret.offset = newBlock.offset;
-			ret.size = newBlock.size;
-			return ret;
-		}
+			if (needDeploy)
+			{
+				// copy from staging memory directly.
+				for (auto&& v : src)
+				{
+					if (!v.isReady)
+					{
+						continue;
+					}
+					size_t dstOffset;
+					Buffer* pDstBuffer = pHeap->GetBuffer(v.offset, dstOffset);
+					pCmdList->GetLatestCommandList()->CopyBufferRegion(pDstBuffer->GetResourceDep(), dstOffset, v.pStaging->pBuffer->GetResourceDep(), v.stagingOffset, v.size);
+				}
+				src.erase(std::remove_if(src.begin(), src.end(), [](const CopySrc& v) { return v.isReady; }), src.end());
+			}
 
-		return ret;
-	}
+			for (auto pBuffer : dstBuffers)
+			{
+				pCmdList->TransitionBarrier(pBuffer, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ);
+			}
+		};
 
-	//----
-	void BufferHeapAllocator::Free(Handle handle)
-	{
-		if (handle.heap != this)
-		{
-			// error.
-			assert(!"[Error] handle.heap is NOT this heap.");
-			return;
-		}
+		std::unique_lock<std::mutex> lock(mutex_);
+		BeginFunc(&*pVertexHeap_, vertexSrc_);
+		BeginFunc(&*pIndexHeap_, indexSrc_);
 
-		auto prevIt = memoryBlocks_.begin();
-		for (auto it = memoryBlocks_.begin(); it != memoryBlocks_.end(); it++)
+		// staging pages without unfinished deploys are retired.
+		// standard size pages are recycled, and others are released after GPU finished.
+		frameCount_++;
+		auto it = stagingPages_.begin();
+		while (it != stagingPages_.end())
 		{
-			if (it->isUsed && it->offset == handle.offset)
+			if ((*it)->pendingCount == 0)
 			{
-				// free memory block.
-				it->isUsed = false;
-				auto nextIt = it;
-				nextIt++;
-				if (nextIt != memoryBlocks_.end() && !nextIt->isUsed)
+				if ((*it)->size == kStagingPageSize && freeStagingPages_.size() < kMaxFreeStagingPages)
 				{
-					// merge next block.
-					it->size += nextIt->size;
-					memoryBlocks_.erase(nextIt);
+					(*it)->usedSize = 0;
+					(*it)->retiredFrame = frameCount_;
+					freeStagingPages_.push_back(std::move(*it));
 				}
-				if (it != prevIt && !prevIt->isUsed)
+				else
 				{
-					// merge prev block.
-					prevIt->size += it->size;
-					memoryBlocks_.erase(it);
-
+					(*it)->pBuffer->Unmap();
+					pParentDevice_->KillObject((*it)->pBuffer);
 				}
-				return;
+				it = stagingPages_.erase(it);
+			}
+			else
+			{
+				it++;
 			}
-			prevIt = it;
 		}
-
-		// error.
-		assert(!"[Error] free block is NOT in this buffer.");
 	}
 
 	//----
-	bool BufferHeapAllocator::CreateNewBuffer(size_t alignedSize)
+	MeshManager::StagingPage* MeshManager::AllocateStaging(size_t size, size_t& outOffset)
 	{
-		auto incSize = initSize_;
-		while (incSize < alignedSize)
+		size_t alignedSize = GetAlignedSize(size, kStagingAlignment);
+		StagingPage* pPage = stagingPages_.empty() ? nullptr : stagingPages_.back().get();
+		if (!pPage || pPage->usedSize + alignedSize > pPage->size)
 		{
-			incSize += initSize_;
-		}
+			// copies from retired page are finished after kMaxBuffer frames.
+			if (alignedSize <= kStagingPageSize && !freeStagingPages_.empty()
+				&& frameCount_ - freeStagingPages_.front()->retiredFrame >= Swapchain::kMaxBuffer)
+			{
+				pPage = freeStagingPages_.front().get();
+				stagingPages_.push_back(std::move(freeStagingPages_.front()));
+				freeStagingPages_.erase(freeStagingPages_.begin());
 
-		auto currSize = (pNextBuffer_ != nullptr) ? pNextBuffer_->GetBufferDesc().size : pBuffer_->GetBufferDesc().size;
-		auto newSize = currSize + incSize;
-		if (pNextBuffer_)
-		{
-			pParentDevice_->KillObject(pNextBuffer_);
+				outOffset = 0;
+				pPage->usedSize = alignedSize;
+				return pPage;
+			}
+
+			// large deploy has its own page.
+			auto page = std::make_unique<StagingPage>();
+			page->size = (alignedSize > kStagingPageSize) ? alignedSize : kStagingPageSize;
+			page->pBuffer = new Buffer();
+
+			BufferDesc creationDesc{};
+			creationDesc.size = page->size;
+			creationDesc.usage = ResourceUsage::VertexBuffer;
+			creationDesc.heap = BufferHeap::Dynamic;
+			creationDesc.initialState = D3D12_RESOURCE_STATE_GENERIC_READ;
+			if (!page->pBuffer->Initialize(pParentDevice_, creationDesc))
+			{
+				delete page->pBuffer;
+				return nullptr;
+			}
+			page->pMapped = (u8*)page->pBuffer->Map();
+
+			pPage = page.get();
+			stagingPages_.push_back(std::move(page));
 		}
-		pNextBuffer_ = new Buffer();
 
-		BufferDesc creationDesc = pBuffer_->GetBufferDesc();
-		creationDesc.size = newSize;
-		creationDesc.usage = usage_ | ResourceUsage::ShaderResource;
-		bool bSuccess = pNextBuffer_->Initialize(pParentDevice_, creationDesc);
-		if (!bSuccess)
+		outOffset = pPage->usedSize;
+		pPage->usedSize += alignedSize;
+		return pPage;
+	}
+
+	//----
+	u8* MeshManager::DeployNoLock(BufferHeapAllocator* pHeap, std::vector<CopySrc>& src, size_t size, bool isReady, Handle& outHandle)
+	{
+		outHandle = pHeap->Allocate(size);
+		if (!outHandle.IsValid())
 		{
-			return false;
+			return nullptr;
 		}
 
-		auto lastBlock = memoryBlocks_.end();
-		lastBlock--;
-		if (!lastBlock->isUsed)
+		size_t stagingOffset;
+		StagingPage* pPage = AllocateStaging(size, stagingOffset);
+		if (!pPage)
 		{
-			lastBlock->size += incSize;
+			pHeap->Free(outHandle);
+			outHandle = Handle();
+			return nullptr;
 		}
-		else
+
+		CopySrc copy;
+		copy.pStaging = pPage;
+		copy.stagingOffset = stagingOffset;
+		copy.size = size;
+		copy.offset = outHandle.offset;
+		copy.isReady = isReady;
+		src.push_back(copy);
+		if (!isReady)
 		{
-			memoryBlocks_.push_back(Block(currSize, incSize, false));
+			pPage->pendingCount++;
 		}
 
-		return true;
+		return pPage->pMapped + stagingOffset;
 	}
 
 	//----
-	void BufferHeapAllocator::BeginNewFrame(CommandList* pCmdList)
+	MeshManager::Handle MeshManager::DeployVertexBuffer(const void* pData, size_t size)
 	{
-		if (pNextBuffer_)
+		std::unique_lock<std::mutex> lock(mutex_);
+
+		Handle handle;
+		u8* pDst = DeployNoLock(&*pVertexHeap_, vertexSrc_, size, true, handle);
+		if (pDst)
 		{
-			auto copySize = pBuffer_->GetBufferDesc().size;
-			pCmdList->TransitionBarrier(pNextBuffer_, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_COPY_DEST);
-			pCmdList->GetLatestCommandList()->CopyBufferRegion(pNextBuffer_->GetResourceDep(), 0, pBuffer_->GetResourceDep(), 0, copySize);
+			memcpy(pDst, pData, size);
+		}
 
-			pParentDevice_->KillObject(pBufferSrv_);
-			pParentDevice_->KillObject(pBuffer_);
+		return handle;
+	}
 
-			pBuffer_ = pNextBuffer_;
-			pNextBuffer_ = nullptr;
+	//----
+	MeshManager::Handle MeshManager::DeployIndexBuffer(const void* pData, size_t size)
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
 
-			pBufferSrv_ = new BufferView();
-			pBufferSrv_->Initialize(pParentDevice_, pBuffer_, 0, 0, 0);
+		Handle handle;
+		u8* pDst = DeployNoLock(&*pIndexHeap_, indexSrc_, size, true, handle);
+		if (pDst)
+		{
+			memcpy(pDst, pData, size);
 		}
-	}
 
+		return handle;
+	}
 
-	//----------------
 	//----
-	MeshManager::MeshManager(Device* pDev, size_t vertexSize, size_t indexSize)
-		: pParentDevice_(pDev)
+	void* MeshManager::BeginDeployVertexBuffer(size_t size, Handle& outHandle)
 	{
-		pVertexHeap_ = std::make_unique<BufferHeapAllocator>(pDev, vertexSize, 4, ResourceUsage::VertexBuffer);
-		pIndexHeap_ = std::make_unique<BufferHeapAllocator>(pDev, indexSize, 4, ResourceUsage::IndexBuffer);
+		std::unique_lock<std::mutex> lock(mutex_);
+		return DeployNoLock(&*pVertexHeap_, vertexSrc_, size, false, outHandle);
 	}
 
 	//----
-	MeshManager::~MeshManager()
+	void* MeshManager::BeginDeployIndexBuffer(size_t size, Handle& outHandle)
 	{
-		pVertexHeap_.reset(nullptr);
-		pIndexHeap_.reset(nullptr);
+		std::unique_lock<std::mutex> lock(mutex_);
+		return DeployNoLock(&*pIndexHeap_, indexSrc_, size, false, outHandle);
 	}
 
 	//----
-	void MeshManager::BeginNewFrame(CommandList* pCmdList)
+	void MeshManager::EndDeploy(const Handle& handle)
 	{
-		auto BeginFunc = [pCmdList, this](BufferHeapAllocator* pHeap, std::vector<std::unique_ptr<CopySrc>>& src)
-		{
-			bool hasNext = pHeap->pNextBuffer_ != nullptr;
-			bool needDeploy = !src.empty();
+		std::unique_lock<std::mutex> lock(mutex_);
 
-			if (!hasNext && !needDeploy)
+		auto&& src = (handle.heap == pVertexHeap_.get()) ? vertexSrc_ : indexSrc_;
+		for (auto it = src.rbegin(); it != src.rend(); it++)
+		{
+			if (!it->isReady && it->offset == handle.offset)
 			{
+				it->isReady = true;
+				it->pStaging->pendingCount--;
 				return;
 			}
+		}
 
-			pHeap->BeginNewFrame(pCmdList);
-			if (!hasNext)
-			{
-				pCmdList->TransitionBarrier(pHeap->pBuffer_, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_COPY_DEST);
-			}
-
-			if (needDeploy)
-			{
-				size_t totalSize = 0;
-				for (auto&& v : src)
-				{
-					totalSize += v->src.size();
-				}
-				auto pSrcBuffer = new Buffer();
-
-				BufferDesc creationDesc{};
-				creationDesc.size = totalSize;
-				creationDesc.usage = ResourceUsage::VertexBuffer;
-				creationDesc.heap = BufferHeap::Dynamic;
-				creationDesc.initialState = D3D12_RESOURCE_STATE_GENERIC_READ;
-				pSrcBuffer->Initialize(pParentDevice_, creationDesc);
-				{
-					u8* p = (u8*)pSrcBuffer->Map();
-					for (auto&& v : src)
-					{
-						memcpy(p, v->src.data(), v->src.size());
-						p += v->src.size();
-					}
-					pSrcBuffer->Unmap();
-				}
-
-				size_t srcOffset = 0;
-				for (auto&& v : src)
-				{
-					pCmdList->GetLatestCommandList()->CopyBufferRegion(pHeap->pBuffer_->GetResourceDep(), v->offset, pSrcBuffer->GetResourceDep(), srcOffset, v->src.size());
-					srcOffset += v->src.size();
-				}
-
-				pParentDevice_->KillObject(pSrcBuffer);
-				src.clear();
-			}
-
-			pCmdList->TransitionBarrier(pHeap->pBuffer_, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ);
-		};
-
-		std::unique_lock<std::mutex> lock(mutex_);
-		BeginFunc(&*pVertexHeap_, vertexSrc_);
-		BeginFunc(&*pIndexHeap_, indexSrc_);
+		// error.
+		assert(!"[Error] deploy is NOT started.");
 	}
 
 	//----
-	MeshManager::Handle MeshManager::DeployVertexBuffer(const void* pData, size_t size)
+	void MeshManager::ReleaseVertexBuffer(Handle handle)
 	{
 		std::unique_lock<std::mutex> lock(mutex_);
-
-		auto handle = pVertexHeap_->Allocate(size);
-		if (handle.IsValid())
-		{
-			auto src = std::make_unique<CopySrc>();
-			src->src.resize(size);
-			memcpy(src->src.data(), pData, size);
-			src->offset = handle.offset;
-			vertexSrc_.push_back(std::move(src));
-		}
-
-		return handle;
+		pVertexHeap_->Free(handle);
 	}
 
 	//----
-	MeshManager::Handle MeshManager::DeployIndexBuffer(const void* pData, size_t size)
+	void MeshManager::ReleaseIndexBuffer(Handle handle)
 	{
 		std::unique_lock<std::mutex> lock(mutex_);
-
-		auto handle = pIndexHeap_->Allocate(size);
-		if (handle.IsValid())
-		{
-			auto src = std::make_unique<CopySrc>();
-			src->src.resize(size);
-			memcpy(src->src.data(), pData, size);
-			src->offset = handle.offset;
-			indexSrc_.push_back(std::move(src));
-		}
-
-		return handle;
+		pIndexHeap_->Free(handle);
 	}
 
 	//----
-	void MeshManager::ReleaseVertexBuffer(Handle handle)
+	BufferHeapAllocator::Stats MeshManager::GetVertexHeapStats()
 	{
 		std::unique_lock<std::mutex> lock(mutex_);
-		pVertexHeap_->Free(handle);
+		return pVertexHeap_->GetStats();
 	}
 
 	//----
-	void MeshManager::ReleaseIndexBuffer(Handle handle)
+	BufferHeapAllocator::Stats MeshManager::GetIndexHeapStats()
 	{
 		std::unique_lock<std::mutex> lock(mutex_);
-		pIndexHeap_->Free(handle);
+		return pIndexHeap_->GetStats();
 	}
 
 }	// namespace sl12
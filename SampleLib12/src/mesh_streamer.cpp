@@ -0,0 +1,198 @@
+﻿#include "sl12/mesh_streamer.h"
+
+#include "sl12/resource_mesh.h"
+
+
+namespace sl12
+{
+	//--------
+	MeshStreamer::~MeshStreamer()
+	{
+		Destroy();
+	}
+
+	//--------
+	bool MeshStreamer::Initialize(Device* pDevice)
+	{
+		assert(pDevice != nullptr);
+
+		pDevice_ = pDevice;
+		currentFrame_ = 0;
+
+		// create thread.
+		isAlive_ = true;
+		std::thread th([&]
+		{
+			while (isAlive_)
+			{
+				{
+					std::unique_lock<std::mutex> lock(requestMutex_);
+					requestCV_.wait(lock, [&]
+					{
+						std::lock_guard<std::mutex> listLock(listMutex_);
+						return !requestList_.empty() || !isAlive_;
+					});
+				}
+
+				if (!isAlive_)
+				{
+					break;
+				}
+
+				if (!ThreadBody())
+				{
+					break;
+				}
+			}
+		});
+		loadingThread_ = std::move(th);
+
+		return true;
+	}
+
+	//--------
+	bool MeshStreamer::ThreadBody()
+	{
+		std::list<Key> keys;
+		{
+			std::lock_guard<std::mutex> lock(listMutex_);
+			keys.swap(requestList_);
+		}
+
+		for (auto&& key : keys)
+		{
+			ResourceHandle handle;
+			{
+				std::lock_guard<std::mutex> lock(listMutex_);
+				auto it = trackedMap_.find(key);
+				if (it == trackedMap_.end())
+				{
+					continue;
+				}
+				handle = it->second.handle;
+			}
+
+			// mesh may be released on other threads while streaming, so keep a reference.
+			auto pLoader = handle.GetLoader();
+			if (pLoader && pLoader->AddReference(handle))
+			{
+				auto resMesh = const_cast<ResourceItemMesh*>(handle.GetItem<ResourceItemMesh>());
+				if (resMesh)
+				{
+					ResourceItemMesh::StreamInSubmesh(resMesh, key.second);
+				}
+				// item is killed here if other references are already released.
+				pLoader->ReleaseResource(handle);
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(listMutex_);
+				auto it = trackedMap_.find(key);
+				if (it != trackedMap_.end())
+				{
+					it->second.isRequested = false;
+				}
+			}
+
+			if (!isAlive_)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	//--------
+	void MeshStreamer::Destroy()
+	{
+		{
+			std::lock_guard<std::mutex> lock(requestMutex_);
+			isAlive_ = false;
+		}
+		requestCV_.notify_one();
+
+		if (loadingThread_.joinable())
+			loadingThread_.join();
+
+		// resident submeshes are released with their meshes.
+		requestList_.clear();
+		trackedMap_.clear();
+	}
+
+	//--------
+	void MeshStreamer::RequestSubmesh(ResourceHandle handle, u32 submeshIndex)
+	{
+		auto resMesh = handle.GetItem<ResourceItemMesh>();
+		if (!resMesh || !resMesh->IsPartial() || submeshIndex >= resMesh->GetSubmeshes().size())
+		{
+			return;
+		}
+
+		Key key(handle.GetID(), submeshIndex);
+		bool isNewRequest = false;
+		{
+			std::lock_guard<std::mutex> lock(listMutex_);
+			auto it = trackedMap_.find(key);
+			if (it == trackedMap_.end())
+			{
+				TrackItem item;
+				item.handle = handle;
+				item.submeshIndex = submeshIndex;
+				item.isRequested = false;
+				it = trackedMap_.insert(std::make_pair(key, item)).first;
+			}
+			it->second.lastRequestedFrame = currentFrame_;
+
+			// request again if evicted or failed.
+			if (!it->second.isRequested && resMesh->GetSubmeshState(submeshIndex) == ResourceItemMesh::SubmeshState::NotResident)
+			{
+				it->second.isRequested = true;
+				requestList_.push_back(key);
+				isNewRequest = true;
+			}
+		}
+
+		if (isNewRequest)
+		{
+			std::lock_guard<std::mutex> lock(requestMutex_);
+			requestCV_.notify_one();
+		}
+	}
+
+	//--------
+	void MeshStreamer::BeginNewFrame(u32 unusedFrameCount)
+	{
+		std::lock_guard<std::mutex> lock(listMutex_);
+
+		currentFrame_++;
+		auto it = trackedMap_.begin();
+		while (it != trackedMap_.end())
+		{
+			auto&& item = it->second;
+			auto resMesh = const_cast<ResourceItemMesh*>(item.handle.GetItem<ResourceItemMesh>());
+			if (!resMesh)
+			{
+				// mesh is already released.
+				it = trackedMap_.erase(it);
+				continue;
+			}
+
+			if (currentFrame_ - item.lastRequestedFrame > unusedFrameCount && !item.isRequested)
+			{
+				// loading submesh is evicted on next frame.
+				if (ResourceItemMesh::EvictSubmesh(pDevice_, resMesh, item.submeshIndex)
+					|| resMesh->GetSubmeshState(item.submeshIndex) == ResourceItemMesh::SubmeshState::NotResident)
+				{
+					it = trackedMap_.erase(it);
+					continue;
+				}
+			}
+			it++;
+		}
+	}
+
+}	// namespace sl12
+
+
+//	EOF
@@ -0,0 +1,156 @@
+﻿#include "sl12/resource_archive.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+
+
+namespace sl12
+{
+	//--------
+	bool ResourceArchive::Open(const std::string& filePath)
+	{
+		Close();
+
+		hFile_ = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+		if (hFile_ == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(hFile_, &size) || (u64)size.QuadPart < sizeof(ResourceArchiveHeader))
+		{
+			Close();
+			return false;
+		}
+		mappedSize_ = (u64)size.QuadPart;
+
+		hMapping_ = CreateFileMappingA(hFile_, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+		if (!hMapping_)
+		{
+			Close();
+			return false;
+		}
+		pMapped_ = reinterpret_cast<u8*>(MapViewOfFile(hMapping_, FILE_MAP_COPY, 0, 0, 0));
+		if (!pMapped_)
+		{
+			Close();
+			return false;
+		}
+
+		// validate.
+		pHeader_ = reinterpret_cast<const ResourceArchiveHeader*>(pMapped_);
+		if (pHeader_->magic != ResourceArchiveHeader::kMagic || pHeader_->version != ResourceArchiveHeader::kVersion
+			|| pHeader_->entryOffset > mappedSize_ || sizeof(ResourceArchiveEntry) * pHeader_->entryCount > mappedSize_ - pHeader_->entryOffset
+			|| pHeader_->nameOffset > mappedSize_ || pHeader_->nameSize > mappedSize_ - pHeader_->nameOffset)
+		{
+			ConsolePrint("Error: invalid archive. (%s)\n", filePath.c_str());
+			Close();
+			return false;
+		}
+		pEntries_ = reinterpret_cast<const ResourceArchiveEntry*>(pMapped_ + pHeader_->entryOffset);
+		pNames_ = reinterpret_cast<const char*>(pMapped_ + pHeader_->nameOffset);
+
+		// names and data of all entries must be in file. Find() does not check ranges.
+		for (u32 i = 0; i < pHeader_->entryCount; i++)
+		{
+			auto&& e = pEntries_[i];
+			if ((u64)e.nameOffset + e.nameLength > pHeader_->nameSize
+				|| e.dataSize > mappedSize_ || e.dataOffset > mappedSize_ - e.dataSize)
+			{
+				ConsolePrint("Error: invalid archive entry. (%s : %d)\n", filePath.c_str(), i);
+				Close();
+				return false;
+			}
+		}
+
+		filePath_ = filePath;
+		return true;
+	}
+
+	//--------
+	void ResourceArchive::Close()
+	{
+		if (pMapped_)
+		{
+			UnmapViewOfFile(pMapped_);
+			pMapped_ = nullptr;
+		}
+		if (hMapping_)
+		{
+			CloseHandle(hMapping_);
+			hMapping_ = nullptr;
+		}
+		if (hFile_ != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(hFile_);
+			hFile_ = INVALID_HANDLE_VALUE;
+		}
+		mappedSize_ = 0;
+		pHeader_ = nullptr;
+		pEntries_ = nullptr;
+		pNames_ = nullptr;
+		filePath_.clear();
+	}
+
+	//--------
+	// find entry. returned memory is valid until Close.
+	bool ResourceArchive::Find(const std::string& path, void** ppData, u64* pSize) const
+	{
+		if (!pHeader_)
+		{
+			return false;
+		}
+
+		std::string normalized = NormalizePath(path);
+		u64 hash = CalcPathHash(normalized);
+
+		// entries are sorted by hash.
+		const ResourceArchiveEntry* pEnd = pEntries_ + pHeader_->entryCount;
+		auto it = std::lower_bound(pEntries_, pEnd, hash,
+			[](const ResourceArchiveEntry& e, u64 h) { return e.hash < h; });
+		for (; it != pEnd && it->hash == hash; ++it)
+		{
+			// compare name for collision.
+			if (it->nameLength == normalized.size() && memcmp(pNames_ + it->nameOffset, normalized.data(), normalized.size()) == 0)
+			{
+				*ppData = pMapped_ + it->dataOffset;
+				*pSize = it->dataSize;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//--------
+	// touch pages of entry data.
+	void ResourceArchive::Prefetch(const void* pData, u64 size) const
+	{
+		if (!pData || !size)
+		{
+			return;
+		}
+		WIN32_MEMORY_RANGE_ENTRY range;
+		range.VirtualAddress = const_cast<void*>(pData);
+		range.NumberOfBytes = (SIZE_T)size;
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+	}
+
+	//--------
+	// lower case, '/' separated, and relative.
+	std::string ResourceArchive::NormalizePath(const std::string& path)
+	{
+		std::string ret = std::filesystem::path(path).lexically_normal().generic_string();
+		std::transform(ret.begin(), ret.end(), ret.begin(), [](char c) { return (char)std::tolower((unsigned char)c); });
+		while (!ret.empty() && ret[0] == '/')
+		{
+			ret.erase(0, 1);
+		}
+		return ret;
+	}
+
+}	// namespace sl12
+
+
+//	EOF
@@ -1,12 +1,32 @@
 ﻿#include "sl12/resource_loader.h"
 
+#include <algorithm>
 #include <filesystem>
 
 #include "sl12/device.h"
+#include "sl12/resource_mesh.h"
 
 
 namespace sl12
 {
+	namespace
+	{
+		// priority of the request being loaded on this thread.
+		thread_local ResourceLoadPriority::Type tCurrentPriority = ResourceLoadPriority::Max;
+
+		// prefetched file of the request being loaded on this thread.
+		thread_local std::unique_ptr<File>* tPrefetchedFile = nullptr;
+		thread_local const std::string* tPrefetchedPath = nullptr;
+
+		// same file loaded by different function is another resource.
+		std::string MakePathKey(const std::string& filepath, ResourceLoader::LoadFunc func)
+		{
+			std::string key = std::filesystem::path(filepath).lexically_normal().generic_string();
+			key += '|';
+			key += std::to_string(reinterpret_cast<uintptr_t>(func));
+			return key;
+		}
+	}
 
 	//--------
 	bool ResourceHandle::IsValid() const
@@ -21,7 +41,17 @@ namespace sl12
 	{
 		if (pParentLoader_ == nullptr)
 			return nullptr;
-		return pParentLoader_->GetItemBaseFromID(id_);
+		auto ret = pParentLoader_->GetItemBaseFromID(id_);
+		if (ret)
+		{
+			// avoid writing shared cache line every access.
+			u64 frame = pParentLoader_->currentFrame_.load(std::memory_order_relaxed);
+			if (ret->lastUsedFrame_.load(std::memory_order_relaxed) != frame)
+			{
+				ret->lastUsedFrame_.store(frame, std::memory_order_relaxed);
+			}
+		}
+		return ret;
 	}
 
 
@@ -32,88 +62,467 @@ namespace sl12
 	}
 
 	//--------
-	bool ResourceLoader::Initialize(Device* pDevice, MeshManager* pMeshMan, const std::string& basePath)
+	bool ResourceLoader::Initialize(Device* pDevice, MeshManager* pMeshMan, const std::string& basePath, u32 numThreads, u32 numIoThreads)
 	{
 		assert(pDevice != nullptr);
 		assert(pMeshMan != nullptr);
 
 		pDevice_ = pDevice;
 		pMeshManager_ = pMeshMan;
-		handleID_ = 0;
-		resourceMap_.clear();
+		resourceSlots_.Clear();
+		resourceEntries_.clear();
+		pathMap_.clear();
 		resourceBasePath_ = basePath;
+		pendingCount_ = 0;
+		prefetchCount_ = 0;
+		prefetchBytes_ = 0;
+		stats_ = Stats();
+		currentFrame_ = 0;
+		residentMemorySize_ = 0;
+		cachedCount_ = 0;
+
+		// partial mesh reads tables and streams by OpenFileRange.
+		noPrefetchFuncs_.clear();
+		noPrefetchFuncs_.push_back(ResourceItemMesh::LoadFunctionPartial);
+
+		if (numThreads == 0)
+		{
+			u32 hwThreads = std::thread::hardware_concurrency();
+			numThreads = (hwThreads > 1) ? hwThreads - 1 : 1;
+		}
 
-		// create thread.
-		std::thread th([&]
+		// create threads.
+		isAlive_ = true;
+		numIoThreads = std::max(numIoThreads, 1u);
+		ioThreads_.reserve(numIoThreads);
+		for (u32 i = 0; i < numIoThreads; i++)
 		{
-			isAlive_ = true;
-			while (isAlive_)
+			ioThreads_.push_back(std::thread([&] { IoThreadBody(); }));
+		}
+		loadingThreads_.reserve(numThreads);
+		for (u32 i = 0; i < numThreads; i++)
+		{
+			loadingThreads_.push_back(std::thread([&] { ThreadBody(); }));
+		}
+
+		return true;
+	}
+
+	//--------
+	// io stage. read files ahead of decode stage.
+	void ResourceLoader::IoThreadBody()
+	{
+		while (true)
+		{
+			RequestItem item;
 			{
+				std::unique_lock<std::mutex> lock(listMutex_);
+				auto GetList = [&]() -> std::list<RequestItem>*
 				{
-					std::unique_lock<std::mutex> lock(requestMutex_);
-					requestCV_.wait(lock, [&] { return !requestList_.empty() || !isAlive_; });
-				}
+					// bound read ahead.
+					if (prefetchCount_ >= kMaxPrefetchCount || prefetchBytes_ >= kMaxPrefetchBytes)
+						return nullptr;
+					for (auto&& list : ioLists_)
+					{
+						if (!list.empty())
+							return &list;
+					}
+					return nullptr;
+				};
+				std::list<RequestItem>* pList = nullptr;
+				ioCV_.wait(lock, [&] { pList = GetList(); return pList != nullptr || !isAlive_; });
 
 				if (!isAlive_)
 				{
 					break;
 				}
 
-				if (!ThreadBody())
+				item = std::move(pList->front());
+				pList->pop_front();
+				prefetchCount_++;
+			}
+
+			// file may not exist. load function decides.
+			bool bPrefetch = std::find(noPrefetchFuncs_.begin(), noPrefetchFuncs_.end(), item.funcLoad) == noPrefetchFuncs_.end();
+			auto start = CpuTimer::CurrentTime();
+			if (bPrefetch)
+			{
+				item.file = ReadFileDirect(item.filePath, true);
+			}
+			auto time = CpuTimer::CurrentTime() - start;
+
+			{
+				std::lock_guard<std::mutex> lock(listMutex_);
+				u64 size = item.file ? item.file->GetSize() : 0;
+				prefetchBytes_ += size;
+				if (bPrefetch)
+				{
+					stats_.ioCount++;
+					stats_.ioBytes += size;
+					stats_.ioTime += time.ToMilliSecond();
+				}
+
+				auto&& list = requestLists_[item.priority];
+				list.push_back(std::move(item));
+				u32 decodeCount = 0;
+				for (auto&& l : requestLists_)
+				{
+					decodeCount += (u32)l.size();
+				}
+				stats_.peakDecodeQueueCount = std::max(stats_.peakDecodeQueueCount, decodeCount);
+			}
+			requestCV_.notify_one();
+		}
+	}
+
+	//--------
+	// decode stage. call load functions.
+	void ResourceLoader::ThreadBody()
+	{
+		while (true)
+		{
+			RequestItem item;
+			{
+				std::unique_lock<std::mutex> lock(listMutex_);
+				auto GetList = [&]() -> std::list<RequestItem>*
+				{
+					for (auto&& list : requestLists_)
+					{
+						if (!list.empty())
+							return &list;
+					}
+					return nullptr;
+				};
+				std::list<RequestItem>* pList = nullptr;
+				requestCV_.wait(lock, [&] { pList = GetList(); return pList != nullptr || !taskList_.empty() || !isAlive_; });
+
+				if (!isAlive_)
 				{
 					break;
 				}
+
+				// tasks of loading items are processed first.
+				if (!taskList_.empty())
+				{
+					TaskItem task = taskList_.front();
+					taskList_.pop_front();
+					lock.unlock();
+					RunTask(task);
+					continue;
+				}
+
+				item = std::move(pList->front());
+				pList->pop_front();
+				prefetchCount_--;
+				prefetchBytes_ -= item.file ? item.file->GetSize() : 0;
 			}
-		});
-		loadingThread_ = std::move(th);
+			ioCV_.notify_one();
 
-		return true;
+			LoadItem(item);
+			pendingCount_--;
+		}
 	}
 
 	//--------
-	bool ResourceLoader::ThreadBody()
+	// run tasks on decode threads. caller also runs tasks, and returns when all tasks are finished.
+	void ResourceLoader::ParallelRun(std::vector<std::function<void()>>& tasks)
 	{
-		isLoading_ = true;
+		if (tasks.size() <= 1 || loadingThreads_.size() <= 1)
+		{
+			for (auto&& task : tasks)
+			{
+				task();
+			}
+			return;
+		}
 
-		std::list<RequestItem> items;
+		TaskGroup group;
+		group.remainCount = (u32)tasks.size();
 		{
 			std::lock_guard<std::mutex> lock(listMutex_);
-			items.swap(requestList_);
+			for (size_t i = 1; i < tasks.size(); i++)
+			{
+				taskList_.push_back({ &tasks[i], &group });
+			}
 		}
+		requestCV_.notify_all();
+
+		TaskItem first = { &tasks[0], &group };
+		RunTask(first);
 
-		for (auto&& item : items)
+		// help other tasks until this group is finished.
+		std::unique_lock<std::mutex> lock(listMutex_);
+		while (group.remainCount > 0)
 		{
-			ResourceItemBase* base = item.funcLoad(this, item.handle, item.filePath);
-			if (base)
+			if (!taskList_.empty())
 			{
-				base->pParentLoader_ = this;
-				base->filePath_ = item.filePath;
-				base->fullPath_ = MakeFullPath(item.filePath);
-				resourceMap_[item.id].reset(base);
+				TaskItem task = taskList_.front();
+				taskList_.pop_front();
+				lock.unlock();
+				RunTask(task);
+				lock.lock();
+				continue;
 			}
+			taskCV_.wait(lock, [&] { return group.remainCount == 0 || !taskList_.empty(); });
+		}
+	}
+
+	//--------
+	void ResourceLoader::RunTask(TaskItem& task)
+	{
+		(*task.pFunc)();
+		{
+			std::lock_guard<std::mutex> lock(listMutex_);
+			task.pGroup->remainCount--;
+		}
+		taskCV_.notify_all();
+	}
+
+	//--------
+	void ResourceLoader::LoadItem(RequestItem& item)
+	{
+		auto start = CpuTimer::CurrentTime();
+		auto prevPriority = tCurrentPriority;
+		tCurrentPriority = item.priority;
+		tPrefetchedFile = &item.file;
+		tPrefetchedPath = &item.filePath;
+		ResourceItemBase* base = item.funcLoad(this, item.handle, item.filePath);
+		tCurrentPriority = prevPriority;
+		tPrefetchedFile = nullptr;
+		tPrefetchedPath = nullptr;
+		auto time = CpuTimer::CurrentTime() - start;
 
-			if (!isAlive_)
+		{
+			std::lock_guard<std::mutex> lock(listMutex_);
+			stats_.decodeCount++;
+			stats_.decodeTime += time.ToMilliSecond();
+		}
+
+		std::vector<CallbackItem> callbacks;
+		if (base)
+		{
+			base->pParentLoader_ = this;
+			base->filePath_ = item.filePath;
+			base->fullPath_ = MakeFullPath(item.filePath);
+		}
+		{
+			std::lock_guard<std::mutex> lock(listMutex_);
+			auto entry = FindEntry(item.id);
+			if (entry && base)
 			{
-				return false;
+				base->lastUsedFrame_ = currentFrame_.load();
+				entry->memorySize = base->GetCpuMemorySize() + base->GetGpuMemorySize();
+				residentMemorySize_ += entry->memorySize;
+				entry->item.reset(base);
+				resourceSlots_.Publish(item.id, base);
+
+				// wait dependencies.
+				u32 pending = 0;
+				for (auto&& dep : base->dependencies_)
+				{
+					auto depEntry = FindEntry(dep.id_);
+					if (depEntry && dep.id_ != item.id && depEntry->state != ResourceState::Complete && depEntry->state != ResourceState::Failed)
+					{
+						depEntry->waiters.push_back(item.id);
+						pending++;
+					}
+				}
+				entry->pendingDependencyCount = pending;
+				if (pending == 0)
+				{
+					CompleteEntry(item.id, entry, true, callbacks);
+				}
+				else
+				{
+					entry->state = ResourceState::WaitDependencies;
+				}
+				base = nullptr;
+			}
+			else if (entry)
+			{
+				// failed to load.
+				CompleteEntry(item.id, entry, false, callbacks);
 			}
 		}
+		completeCV_.notify_all();
 
-		isLoading_ = false;
+		for (auto&& cb : callbacks)
+		{
+			cb.func(cb.handle, cb.isSuccess);
+		}
 
-		return true;
+		// cancelled while loading.
+		// load function may have queued GPU work referring this item, so kill it after GPU finished.
+		if (base)
+		{
+			ReleaseDependencies(base);
+			pDevice_->KillObject(base);
+		}
+	}
+
+	//--------
+	// listMutex_ must be locked.
+	void ResourceLoader::CompleteEntry(u64 id, ResourceEntry* entry, bool isSuccess, std::vector<CallbackItem>& outCallbacks)
+	{
+		entry->state = isSuccess ? ResourceState::Complete : ResourceState::Failed;
+		for (auto&& func : entry->callbacks)
+		{
+			outCallbacks.push_back({ std::move(func), ResourceHandle(this, id), isSuccess });
+		}
+		entry->callbacks.clear();
+
+		// parent items are complete even if dependency is failed.
+		std::vector<u64> waiters;
+		waiters.swap(entry->waiters);
+		for (auto&& w : waiters)
+		{
+			auto waiter = FindEntry(w);
+			if (waiter && waiter->state == ResourceState::WaitDependencies)
+			{
+				assert(waiter->pendingDependencyCount > 0);
+				if (--waiter->pendingDependencyCount == 0)
+				{
+					CompleteEntry(w, waiter, true, outCallbacks);
+				}
+			}
+		}
+	}
+
+	//--------
+	// listMutex_ must be locked.
+	bool ResourceLoader::IsFinishedNoLock(u64 id, bool* pIsSuccess)
+	{
+		auto entry = FindEntry(id);
+		if (!entry)
+		{
+			// released.
+			*pIsSuccess = false;
+			return true;
+		}
+		*pIsSuccess = entry->state == ResourceState::Complete;
+		return entry->state == ResourceState::Complete || entry->state == ResourceState::Failed;
+	}
+
+	//--------
+	// callback is called on loader thread. if already finished, it is called immediately.
+	void ResourceLoader::AddCompletionCallback(const ResourceHandle& handle, CompletionCallback func)
+	{
+		if (!func)
+		{
+			return;
+		}
+
+		bool isSuccess = false;
+		{
+			std::lock_guard<std::mutex> lock(listMutex_);
+			if (handle.pParentLoader_ == this && !IsFinishedNoLock(handle.id_, &isSuccess))
+			{
+				FindEntry(handle.id_)->callbacks.push_back(std::move(func));
+				return;
+			}
+		}
+		func(handle, isSuccess);
+	}
+
+	//--------
+	bool ResourceLoader::IsComplete(const ResourceHandle& handle) const
+	{
+		if (handle.pParentLoader_ != this)
+		{
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(listMutex_);
+		bool isSuccess = false;
+		return const_cast<ResourceLoader*>(this)->IsFinishedNoLock(handle.id_, &isSuccess) && isSuccess;
+	}
+
+	//--------
+	bool ResourceLoader::Wait(const ResourceHandle& handle)
+	{
+		return WaitAll({ handle });
+	}
+
+	//--------
+	// block until requests are finished. return true if all requests are complete.
+	bool ResourceLoader::WaitAll(const std::vector<ResourceHandle>& handles)
+	{
+		bool ret = true;
+		std::unique_lock<std::mutex> lock(listMutex_);
+		for (auto&& handle : handles)
+		{
+			if (handle.pParentLoader_ != this)
+			{
+				ret = false;
+				continue;
+			}
+
+			bool isSuccess = false;
+			completeCV_.wait(lock, [&] { return !isAlive_ || IsFinishedNoLock(handle.id_, &isSuccess); });
+			ret = ret && isSuccess;
+		}
+		return ret;
 	}
 
 	//--------
 	void ResourceLoader::Destroy()
 	{
-		isAlive_ = false;
-		requestCV_.notify_one();
+		{
+			std::lock_guard<std::mutex> lock(listMutex_);
+			isAlive_ = false;
+		}
+		ioCV_.notify_all();
+		requestCV_.notify_all();
+		completeCV_.notify_all();
 
-		if (loadingThread_.joinable())
-			loadingThread_.join();
+		for (auto&& th : ioThreads_)
+		{
+			if (th.joinable())
+				th.join();
+		}
+		ioThreads_.clear();
+		for (auto&& th : loadingThreads_)
+		{
+			if (th.joinable())
+				th.join();
+		}
+		loadingThreads_.clear();
 
-		requestList_.clear();
-		resourceMap_.clear();
+		for (auto&& list : ioLists_)
+		{
+			list.clear();
+		}
+		for (auto&& list : requestLists_)
+		{
+			list.clear();
+		}
+		prefetchCount_ = 0;
+		prefetchBytes_ = 0;
+		pathMap_.clear();
+
+		// NOTE: destructors of items call ReleaseResource, and it is ignored after isAlive_ is false.
+		std::vector<ResourceEntry> resources;
+		{
+			std::lock_guard<std::mutex> lock(listMutex_);
+			resources.swap(resourceEntries_);
+		}
+		resourceSlots_.Clear();
+		resources.clear();
+		pendingCount_ = 0;
+		residentMemorySize_ = 0;
+		cachedCount_ = 0;
+
+		// released items are still in death list, and their destructors may refer loader or mesh manager.
+		// kill them here while those are alive.
+		if (pDevice_)
+		{
+			pDevice_->WaitDrawDone();
+			pDevice_->SyncKillObjects(true);
+			pDevice_ = nullptr;
+		}
+
+		// items may refer mapped memory until destroyed.
+		UnmountAllArchives();
 	}
 
 	//--------
@@ -125,40 +534,465 @@ namespace sl12
 	}
 
 	//--------
-	ResourceHandle ResourceLoader::LoadRequest(const std::string& filepath, LoadFunc func)
+	// open file for load function.
+	// if file was prefetched in io stage, it is returned without reading.
+	std::unique_ptr<File> ResourceLoader::OpenFile(const std::string& filePath)
+	{
+		if (tPrefetchedFile && *tPrefetchedFile && *tPrefetchedPath == filePath)
+		{
+			return std::move(*tPrefetchedFile);
+		}
+
+		return ReadFileDirect(filePath, false);
+	}
+
+	//--------
+	// open a part of file.
+	std::unique_ptr<File> ResourceLoader::OpenFileRange(const std::string& filePath, u64 offset, u64 size)
 	{
+		std::unique_ptr<File> ret = std::make_unique<File>();
+		{
+			std::lock_guard<std::mutex> lock(archiveMutex_);
+			for (auto&& archive : archives_)
+			{
+				void* pData;
+				u64 fileSize;
+				if (archive->Find(filePath, &pData, &fileSize))
+				{
+					if (offset + size > fileSize)
+					{
+						return nullptr;
+					}
+					ret->AttachMemory(reinterpret_cast<u8*>(pData) + offset, size);
+					std::lock_guard<std::mutex> statLock(listMutex_);
+					stats_.archiveHitCount++;
+					return ret;
+				}
+			}
+		}
+
+		if (!ret->ReadFileRange(MakeFullPath(filePath).c_str(), offset, size))
+		{
+			return nullptr;
+		}
+		return ret;
+	}
+
+	//--------
+	std::unique_ptr<File> ResourceLoader::ReadFileDirect(const std::string& filePath, bool bPrefetch)
+	{
+		std::unique_ptr<File> ret = std::make_unique<File>();
+		{
+			std::lock_guard<std::mutex> lock(archiveMutex_);
+			for (auto&& archive : archives_)
+			{
+				void* pData;
+				u64 size;
+				if (archive->Find(filePath, &pData, &size))
+				{
+					// io stage touches pages before decode stage.
+					if (bPrefetch)
+					{
+						archive->Prefetch(pData, size);
+					}
+					ret->AttachMemory(pData, size);
+					std::lock_guard<std::mutex> statLock(listMutex_);
+					stats_.archiveHitCount++;
+					return ret;
+				}
+			}
+		}
+
+		if (!ret->ReadFile(MakeFullPath(filePath).c_str()))
+		{
+			return nullptr;
+		}
+		return ret;
+	}
+
+	//--------
+	// mount packed archive. archives are searched in mount order.
+	bool ResourceLoader::MountArchive(const std::string& archivePath)
+	{
+		std::unique_ptr<ResourceArchive> archive = std::make_unique<ResourceArchive>();
+		if (!archive->Open(archivePath))
+		{
+			ConsolePrint("Error: failed to mount archive. (%s)\n", archivePath.c_str());
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(archiveMutex_);
+		archives_.push_back(std::move(archive));
+		return true;
+	}
+
+	//--------
+	void ResourceLoader::UnmountAllArchives()
+	{
+		std::lock_guard<std::mutex> lock(archiveMutex_);
+		archives_.clear();
+	}
+
+	//--------
+	ResourceLoader::Stats ResourceLoader::GetStats() const
+	{
+		std::lock_guard<std::mutex> lock(listMutex_);
+		Stats ret = stats_;
+		ret.ioQueueCount = 0;
+		ret.decodeQueueCount = 0;
+		for (auto&& list : ioLists_)
+		{
+			ret.ioQueueCount += (u32)list.size();
+		}
+		for (auto&& list : requestLists_)
+		{
+			ret.decodeQueueCount += (u32)list.size();
+		}
+		ret.prefetchBytes = prefetchBytes_;
+		return ret;
+	}
+
+	//--------
+	ResourceHandle ResourceLoader::LoadRequest(const std::string& filepath, LoadFunc func, ResourceLoadPriority::Type priority)
+	{
+		assert(priority < ResourceLoadPriority::Max);
+
 		RequestItem item;
 		item.filePath = filepath;
 		item.funcLoad = func;
+		item.priority = std::min(priority, tCurrentPriority);
 
+		std::string pathKey = MakePathKey(filepath, func);
+
+		ResourceHandle ret;
 		{
 			std::lock_guard<std::mutex> lock(listMutex_);
-			auto it = resourceMap_.begin();
-			do
+
+			// already loaded or in flight.
+			auto pit = pathMap_.find(pathKey);
+			if (pit != pathMap_.end())
 			{
-				item.id = handleID_.fetch_add(1);
-				it = resourceMap_.find(item.id);
-			} while (it != resourceMap_.end());
+				auto entry = FindEntry(pit->second);
+				assert(entry != nullptr);
+				if (entry->refCount == 0 && entry->item)
+				{
+					// revive resident item.
+					cachedCount_--;
+				}
+				entry->refCount++;
+				return ResourceHandle(this, pit->second);
+			}
+
+			item.id = resourceSlots_.Allocate();
 			item.handle = ResourceHandle(this, item.id);
-			resourceMap_[item.id].reset();
-			requestList_.push_back(item);
+			u32 index = resourceSlots_.GetIndex(item.id);
+			if (index >= resourceEntries_.size())
+			{
+				resourceEntries_.resize(index + 1);
+			}
+			auto&& entry = resourceEntries_[index];
+			entry.pathKey = pathKey;
+			entry.refCount = 1;
+			pathMap_[pathKey] = item.id;
+			pendingCount_++;
+			ret = item.handle;
+			ioLists_[item.priority].push_back(std::move(item));
 		}
 
-		std::lock_guard<std::mutex> lock(requestMutex_);
-		requestCV_.notify_one();
+		ioCV_.notify_one();
 
-		return item.handle;
+		return ret;
 	}
 
 	//--------
-	const ResourceItemBase* ResourceLoader::GetItemBaseFromID(u64 id) const
+	// cancel request. this releases one reference.
+	// if loading is already started, loaded item is discarded.
+	bool ResourceLoader::CancelRequest(const ResourceHandle& handle)
 	{
-		auto it = resourceMap_.find(id);
-		if (it == resourceMap_.end())
+		if (handle.pParentLoader_ != this)
+		{
+			return false;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(listMutex_);
+			auto entry = FindEntry(handle.id_);
+			if (!entry || entry->item)
+			{
+				// not requested or already loaded.
+				return false;
+			}
+		}
+
+		ReleaseResource(handle);
+		return true;
+	}
+
+	//--------
+	// release one reference.
+	// item is killed through device when the last reference is released.
+	void ResourceLoader::ReleaseResource(const ResourceHandle& handle)
+	{
+		if (handle.pParentLoader_ != this || !isAlive_)
+		{
+			return;
+		}
+
+		ResourceItemBase* pItem = nullptr;
+		bool isCached = false;
+		std::vector<CompletionCallback> cancelledCallbacks;
+		{
+			std::lock_guard<std::mutex> lock(listMutex_);
+			auto entry = FindEntry(handle.id_);
+			if (!entry)
+			{
+				return;
+			}
+
+			assert(entry->refCount > 0);
+			if (--entry->refCount > 0)
+			{
+				return;
+			}
+
+			// loaded items stay resident while budget is set.
+			if (entry->item && memoryBudget_ > 0)
+			{
+				cachedCount_++;
+				isCached = true;
+			}
+			else
+			{
+				cancelledCallbacks.swap(entry->callbacks);
+				pItem = RemoveEntry(handle.id_, entry);
+			}
+		}
+		completeCV_.notify_all();
+
+		for (auto&& func : cancelledCallbacks)
+		{
+			func(handle, false);
+		}
+
+		// item may be used in gpu.
+		if (pItem)
+		{
+			ReleaseDependencies(pItem);
+			pDevice_->KillObject(pItem);
+		}
+		if (isCached)
+		{
+			EvictOverBudget();
+		}
+	}
+
+	//--------
+	bool ResourceLoader::AddReference(const ResourceHandle& handle)
+	{
+		if (handle.pParentLoader_ != this || !isAlive_)
+		{
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(listMutex_);
+		auto entry = FindEntry(handle.id_);
+		if (!entry)
+		{
+			return false;
+		}
+
+		if (entry->refCount == 0 && entry->item)
+		{
+			// revive resident item.
+			cachedCount_--;
+		}
+		entry->refCount++;
+		return true;
+	}
+
+	//--------
+	// listMutex_ must be locked.
+	// cached items are counted down by caller.
+	ResourceItemBase* ResourceLoader::RemoveEntry(u64 id, ResourceEntry* entry)
+	{
+		ResourceItemBase* pItem = entry->item.release();
+		if (!pItem)
+		{
+			// remove from request list if not started.
+			RemoveRequest(id);
+		}
+		residentMemorySize_ -= entry->memorySize;
+		pathMap_.erase(entry->pathKey);
+		*entry = ResourceEntry();
+
+		// readers can not see this item after here.
+		resourceSlots_.Free(id);
+		return pItem;
+	}
+
+	//--------
+	void ResourceLoader::SetMemoryBudget(u64 bytes)
+	{
+		memoryBudget_ = bytes;
+		EvictOverBudget();
+	}
+
+	//--------
+	void ResourceLoader::UpdateMemorySize(const ResourceHandle& handle)
+	{
+		if (handle.pParentLoader_ != this || !isAlive_)
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(listMutex_);
+		auto entry = FindEntry(handle.id_);
+		if (!entry || !entry->item)
+		{
+			// not published yet. size is calculated when published.
+			return;
+		}
+
+		u64 size = entry->item->GetCpuMemorySize() + entry->item->GetGpuMemorySize();
+		residentMemorySize_ += size - entry->memorySize;		// wraps around when shrunk.
+		entry->memorySize = size;
+	}
+
+	//--------
+	// advance frame for last used frame, and evict over budget.
+	void ResourceLoader::BeginNewFrame()
+	{
+		currentFrame_++;
+		EvictOverBudget();
+	}
+
+	//--------
+	// evict unreferenced items in LRU order.
+	void ResourceLoader::EvictOverBudget()
+	{
+		std::vector<ResourceItemBase*> evicted;
+		{
+			std::lock_guard<std::mutex> lock(listMutex_);
+
+			u64 budget = memoryBudget_;
+			if (residentMemorySize_ <= budget || cachedCount_ == 0)
+			{
+				return;
+			}
+
+			// unreferenced items.
+			struct Candidate
+			{
+				u64		lastUsedFrame;
+				u32		index;
+			};
+			std::vector<Candidate> candidates;
+			for (u32 i = 0; i < (u32)resourceEntries_.size(); i++)
+			{
+				auto&& entry = resourceEntries_[i];
+				if (entry.item && entry.refCount == 0)
+				{
+					candidates.push_back({ entry.item->GetLastUsedFrame(), i });
+				}
+			}
+			std::sort(candidates.begin(), candidates.end(),
+				[](const Candidate& l, const Candidate& r) { return l.lastUsedFrame < r.lastUsedFrame; });
+
+			for (auto&& c : candidates)
+			{
+				if (residentMemorySize_ <= budget)
+				{
+					break;
+				}
+				auto&& entry = resourceEntries_[c.index];
+				u64 id = entry.item->GetHandle().GetID();
+				evicted.push_back(RemoveEntry(id, &entry));
+				cachedCount_--;
+			}
+		}
+
+		// released through deferred kill.
+		for (auto&& pItem : evicted)
+		{
+			ReleaseDependencies(pItem);
+			pDevice_->KillObject(pItem);
+		}
+	}
+
+	//--------
+	void ResourceLoader::ReleaseDependencies(ResourceItemBase* pItem)
+	{
+		std::vector<ResourceHandle> deps;
+		deps.swap(pItem->dependencies_);
+		for (auto&& dep : deps)
+		{
+			ReleaseResource(dep);
+		}
+	}
+
+	//--------
+	u32 ResourceLoader::GetRefCount(const ResourceHandle& handle) const
+	{
+		if (handle.pParentLoader_ != this)
+		{
+			return 0;
+		}
+
+		std::lock_guard<std::mutex> lock(listMutex_);
+		auto entry = const_cast<ResourceLoader*>(this)->FindEntry(handle.id_);
+		return entry ? entry->refCount : 0;
+	}
+
+	//--------
+	// listMutex_ must be locked.
+	ResourceLoader::ResourceEntry* ResourceLoader::FindEntry(u64 id)
+	{
+		if (!resourceSlots_.IsAlive(id))
 		{
 			return nullptr;
 		}
-		return it->second.get();
+		u32 index = resourceSlots_.GetIndex(id);
+		return (index < resourceEntries_.size()) ? &resourceEntries_[index] : nullptr;
+	}
+
+	//--------
+	bool ResourceLoader::RemoveRequest(u64 id)
+	{
+		for (auto&& list : ioLists_)
+		{
+			for (auto rit = list.begin(); rit != list.end(); ++rit)
+			{
+				if (rit->id == id)
+				{
+					list.erase(rit);
+					pendingCount_--;
+					return true;
+				}
+			}
+		}
+		for (auto&& list : requestLists_)
+		{
+			for (auto rit = list.begin(); rit != list.end(); ++rit)
+			{
+				if (rit->id == id)
+				{
+					prefetchCount_--;
+					prefetchBytes_ -= rit->file ? rit->file->GetSize() : 0;
+					list.erase(rit);
+					pendingCount_--;
+					ioCV_.notify_one();
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	//--------
+	// lock free.
+	const ResourceItemBase* ResourceLoader::GetItemBaseFromID(u64 id) const
+	{
+		return resourceSlots_.Get(id);
 	}
 
 }	// namespace sl12
@@ -5,8 +5,13 @@
 #include "sl12/device.h"
 #include "sl12/command_list.h"
 
-#include <fstream>
+#include <streambuf>
+#include <istream>
 #include <set>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include "meshoptimizer.h"
 
 
 namespace sl12
@@ -30,220 +35,906 @@ namespace sl12
 				auto d3dCmdList = pCmdlist->GetLatestCommandList();
 				d3dCmdList->CopyResource(pDstBuffer->GetResourceDep(), pSrcBuffer->GetResourceDep());
 				pDevice->KillObject(pSrcBuffer);
-				pCmdlist->TransitionBarrier(pDstBuffer, D3D12_RESOURCE_STATE_COPY_DEST, initState);
+			}
+
+			void LoadBarrier(CommandList* pCmdlist) override
+			{
+				pCmdlist->AddTransitionBarrier(pDstBuffer, D3D12_RESOURCE_STATE_COPY_DEST, initState);
+			}
+
+			RenderCommandPhase::Type GetPhase() const override
+			{
+				return RenderCommandPhase::Copy;
 			}
 		};	// struct BufferInitRenderCommand
 
+		// read only stream buffer on memory.
+		struct MemoryStreamBuf
+			: public std::streambuf
+		{
+			MemoryStreamBuf(void* pData, size_t size)
+			{
+				char* p = reinterpret_cast<char*>(pData);
+				setg(p, p, p + size);
+			}
+		};	// struct MemoryStreamBuf
+
 		bool IsStreamingTexture(const std::string& path)
 		{
 			auto n = path.rfind(".stex");
 			return n == (path.size() - 5);
 		}
+
+		// v1 data converted to v2 tables. streams refer ResourceMesh.
+		struct SourceStorageV1
+		{
+			ResourceMesh							mesh;
+			std::vector<ResourceMeshFileMaterial>	materials;
+			std::vector<ResourceMeshFileSubmesh>	submeshes;
+			std::vector<ResourceMeshFileMeshlet>	meshlets;
+			std::string								strings;
+		};	// struct SourceStorageV1
+
+		ResourceMeshFileString AddString(std::string& table, const std::string& str)
+		{
+			ResourceMeshFileString ret;
+			ret.offset = (u32)table.size();
+			ret.length = (u32)str.size();
+			table += str;
+			return ret;
+		}
+
+		bool IsSourceV2(const void* pData, u64 size)
+		{
+			// older versions have shorter blob table.
+			return size >= offsetof(ResourceMeshFileHeader, blobs)
+				&& reinterpret_cast<const ResourceMeshFileHeader*>(pData)->magic == ResourceMeshFileHeader::kMagic;
+		}
+
+		bool IsTableSizeValid(const ResourceMeshFileHeader& header, const ResourceMeshBlob* blobs)
+		{
+			return blobs[ResourceMeshBlobType::Material].size == sizeof(ResourceMeshFileMaterial) * header.materialCount
+				&& blobs[ResourceMeshBlobType::Submesh].size == sizeof(ResourceMeshFileSubmesh) * header.submeshCount
+				&& blobs[ResourceMeshBlobType::Meshlet].size == sizeof(ResourceMeshFileMeshlet) * header.meshletCount
+				&& blobs[ResourceMeshBlobType::Lod].size % sizeof(ResourceMeshFileLod) == 0
+				&& blobs[ResourceMeshBlobType::Cluster].size % sizeof(ResourceMeshFileCluster) == 0;
+		}
+
+		// read header of uncompressed v2 file without reading whole file.
+		// blobs not stored in the file version are empty.
+		bool ReadHeaderForPartial(ResourceLoader* pLoader, const std::string& filepath, ResourceMeshFileHeader& header)
+		{
+			auto file = pLoader->OpenFileRange(filepath, 0, offsetof(ResourceMeshFileHeader, blobs));
+			if (!file || !IsSourceV2(file->GetData(), file->GetSize()))
+			{
+				return false;
+			}
+			auto pHeader = reinterpret_cast<const ResourceMeshFileHeader*>(file->GetData());
+			if (pHeader->version < ResourceMeshFileHeader::kMinVersion || pHeader->version > ResourceMeshFileHeader::kVersion
+				|| (pHeader->flags & ResourceMeshFileFlag::CompressedStreams))
+			{
+				return false;
+			}
+
+			u64 headerSize = offsetof(ResourceMeshFileHeader, blobs) + sizeof(ResourceMeshBlob) * ResourceMeshFileHeader::GetBlobCount(pHeader->version);
+			file = pLoader->OpenFileRange(filepath, 0, headerSize);
+			if (!file)
+			{
+				return false;
+			}
+			header = ResourceMeshFileHeader();
+			memcpy(&header, file->GetData(), (size_t)headerSize);
+			return true;
+		}
+
+		bool DecodeStream(const ResourceMeshStreamHeader& header, const u8* pSrc, size_t srcSize, void* pDst)
+		{
+			size_t count = (size_t)header.elementCount;
+			size_t size = (size_t)header.elementSize;
+			switch (header.codec)
+			{
+			case ResourceMeshStreamCodec::Vertex:
+				if (size == 0 || (size % 4) != 0 || size > 256)
+					return false;
+				return meshopt_decodeVertexBuffer(pDst, count, size, pSrc, srcSize) == 0;
+			case ResourceMeshStreamCodec::VertexOct:
+				{
+					if (size != 4 && size != 8)
+						return false;
+					// filter reads decoded data. it is not run on write combined staging memory.
+					std::vector<u8> decoded(count * size);
+					if (meshopt_decodeVertexBuffer(decoded.data(), count, size, pSrc, srcSize) != 0)
+						return false;
+					meshopt_decodeFilterOct(decoded.data(), count, size);
+					memcpy(pDst, decoded.data(), decoded.size());
+					return true;
+				}
+			case ResourceMeshStreamCodec::IndexBuffer:
+				if ((size != 2 && size != 4) || (count % 3) != 0)
+					return false;
+				return meshopt_decodeIndexBuffer(pDst, count, size, pSrc, srcSize) == 0;
+			case ResourceMeshStreamCodec::IndexSequence:
+				if (size != 2 && size != 4)
+					return false;
+				return meshopt_decodeIndexSequence(pDst, count, size, pSrc, srcSize) == 0;
+			}
+			return false;
+		}
+
+		void ConvertBounding(ResourceItemMesh::Bounding& dst, const ResourceMeshBoundingSphere& sphere, const ResourceMeshBoundingBox& box)
+		{
+			dst.sphere.center = DirectX::XMFLOAT3(sphere.centerX, sphere.centerY, sphere.centerZ);
+			dst.sphere.radius = sphere.radius;
+			dst.box.aabbMin = DirectX::XMFLOAT3(box.minX, box.minY, box.minZ);
+			dst.box.aabbMax = DirectX::XMFLOAT3(box.maxX, box.maxY, box.maxZ);
+		}
+
+		void ConvertMeshlet(ResourceItemMesh::Meshlet& dst, const ResourceMeshFileMeshlet& src)
+		{
+			dst.indexCount = src.indexCount;
+			dst.indexOffset = src.indexOffset;
+			dst.primitiveCount = src.primitiveCount;
+			dst.primitiveOffset = src.primitiveOffset;
+			dst.vertexIndexCount = src.vertexIndexCount;
+			dst.vertexIndexOffset = src.vertexIndexOffset;
+
+			ConvertBounding(dst.boundingInfo, src.boundingSphere, src.boundingBox);
+			dst.boundingInfo.cone.apex = DirectX::XMFLOAT3(src.cone.apexX, src.cone.apexY, src.cone.apexZ);
+			dst.boundingInfo.cone.axis = DirectX::XMFLOAT3(src.cone.axisX, src.cone.axisY, src.cone.axisZ);
+			dst.boundingInfo.cone.cutoff = src.cone.cutoff;
+		}
+
+		void ConvertClusterLod(ResourceItemMesh::ClusterLod& dst, const ResourceMeshClusterLod& src)
+		{
+			dst.center = DirectX::XMFLOAT3(src.sphere.centerX, src.sphere.centerY, src.sphere.centerZ);
+			dst.radius = src.sphere.radius;
+			dst.error = src.error;
+		}
+
+		// release evicted stream after GPU finished.
+		struct ReleaseMeshBufferItem
+			: public PendingKillItem
+		{
+			MeshManager*		pMeshMan = nullptr;
+			MeshManager::Handle	handle;
+			bool				isVertex = false;
+
+			ReleaseMeshBufferItem(MeshManager* m, const MeshManager::Handle& h, bool v)
+				: pMeshMan(m), handle(h), isVertex(v)
+			{}
+			~ReleaseMeshBufferItem()
+			{
+				if (isVertex)
+					pMeshMan->ReleaseVertexBuffer(handle);
+				else
+					pMeshMan->ReleaseIndexBuffer(handle);
+			}
+		};	// struct ReleaseMeshBufferItem
+
+		bool IsVertexStream(u32 stream)
+		{
+			return stream + ResourceMeshBlobType::StreamBegin < ResourceMeshBlobType::Index;
+		}
 	}
 
 	//---------------
 	ResourceItemMesh::~ResourceItemMesh()
 	{
+		// release mesh manager memory.
+		auto pMeshMan = pMeshManager_;
+		if (pMeshMan)
+		{
+			for (auto h : { hPosition_, hNormal_, hTangent_, hTexcoord_ })
+			{
+				if (h.IsValid())
+					pMeshMan->ReleaseVertexBuffer(h);
+			}
+			for (auto h : { hIndex_, hMeshletPackedPrim_, hMeshletVertexIndex_ })
+			{
+				if (h.IsValid())
+					pMeshMan->ReleaseIndexBuffer(h);
+			}
+
+			// item is killed after GPU finished.
+			for (size_t i = 0; submeshStreams_ && i < Submeshes_.size(); i++)
+			{
+				auto&& stream = submeshStreams_[i];
+				for (u32 s = 0; s < kStreamCount; s++)
+				{
+					if (!stream.handles[s].IsValid())
+						continue;
+					if (IsVertexStream(s))
+						pMeshMan->ReleaseVertexBuffer(stream.handles[s]);
+					else
+						pMeshMan->ReleaseIndexBuffer(stream.handles[s]);
+				}
+			}
+		}
 	}
 
 	//---------------
-	ResourceItemBase* ResourceItemMesh::LoadFunction(ResourceLoader* pLoader, ResourceHandle handle, const std::string& filepath)
+	u64 ResourceItemMesh::GetCpuMemorySize() const
 	{
-		ResourceMesh mesh_bin;
-		std::fstream ifs(pLoader->MakeFullPath(filepath), std::ios::in | std::ios::binary);
-		cereal::BinaryInputArchive ar(ifs);
-		ar(cereal::make_nvp("mesh", mesh_bin));
+		u64 ret = sizeof(*this);
+		ret += mateirals_.size() * sizeof(Material);
+		for (auto&& submesh : Submeshes_)
+		{
+			ret += sizeof(Submesh) + submesh.meshlets.size() * sizeof(Meshlet);
+		}
+		if (submeshStreams_)
+		{
+			ret += Submeshes_.size() * sizeof(SubmeshStream);
+		}
+		return ret;
+	}
 
-		if (mesh_bin.GetIndexBuffer().empty())
+	//---------------
+	u64 ResourceItemMesh::GetGpuMemorySize() const
+	{
+		u64 ret = 0;
+		for (auto h : { hPosition_, hNormal_, hTangent_, hTexcoord_, hIndex_, hMeshletPackedPrim_, hMeshletVertexIndex_ })
 		{
-			return nullptr;
+			ret += h.size;
 		}
+		for (size_t i = 0; submeshStreams_ && i < Submeshes_.size(); i++)
+		{
+			auto&& stream = submeshStreams_[i];
+			if (stream.state.load(std::memory_order_acquire) != SubmeshState::Resident)
+				continue;
+			for (auto&& h : stream.handles)
+			{
+				ret += h.size;
+			}
+		}
+		return ret;
+	}
 
-		std::unique_ptr<ResourceItemMesh> ret(new ResourceItemMesh(handle));
+	//---------------
+	// common view of v1 and v2 mesh data.
+	struct ResourceItemMesh::SourceData
+	{
+		ResourceMeshBoundingSphere			boundingSphere;
+		ResourceMeshBoundingBox				boundingBox;
 
-		// set bounding sphere.
-		ret->boundingInfo_.sphere.center.x = mesh_bin.GetBoundingSphere().centerX;
-		ret->boundingInfo_.sphere.center.y = mesh_bin.GetBoundingSphere().centerY;
-		ret->boundingInfo_.sphere.center.z = mesh_bin.GetBoundingSphere().centerZ;
-		ret->boundingInfo_.sphere.radius = mesh_bin.GetBoundingSphere().radius;
-		ret->boundingInfo_.box.aabbMin.x = mesh_bin.GetBoundingBox().minX;
-		ret->boundingInfo_.box.aabbMin.y = mesh_bin.GetBoundingBox().minY;
-		ret->boundingInfo_.box.aabbMin.z = mesh_bin.GetBoundingBox().minZ;
-		ret->boundingInfo_.box.aabbMax.x = mesh_bin.GetBoundingBox().maxX;
-		ret->boundingInfo_.box.aabbMax.y = mesh_bin.GetBoundingBox().maxY;
-		ret->boundingInfo_.box.aabbMax.z = mesh_bin.GetBoundingBox().maxZ;
+		const ResourceMeshFileMaterial*		pMaterials = nullptr;
+		u32									materialCount = 0;
+		const ResourceMeshFileSubmesh*		pSubmeshes = nullptr;
+		u32									submeshCount = 0;
+		const ResourceMeshFileMeshlet*		pMeshlets = nullptr;
+		u32									meshletCount = 0;
+		const ResourceMeshFileLod*			pLods = nullptr;
+		u32									lodCount = 0;
+		const ResourceMeshFileCluster*		pClusters = nullptr;
+		u32									clusterCount = 0;
+		const char*							pStrings = nullptr;
+		u64									stringSize = 0;
 
-		// create buffers.
-		auto pDev = pLoader->GetDevice();
-		auto pMeshMan = pLoader->GetMeshManager();
-		assert(pDev != nullptr && pMeshMan != nullptr);
-		auto CreateBuffer = [&](MeshManager::Handle* pHandle, const std::vector<u8>& data, size_t stride, u32 usage, bool isEmpyOk = false)
+		// file locations of uncompressed v2 streams. used for partial load.
+		bool								hasStreamBlobs = false;
+		ResourceMeshBlob					streamBlobs[ResourceMeshBlobType::Max] = {};
+
+		// tables read separately for partial load.
+		std::vector<std::unique_ptr<File>>	tableFiles;
+
+		const void*							pStreams[ResourceMeshBlobType::Max] = {};
+		u64									streamSizes[ResourceMeshBlobType::Max] = {};
+
+		// compressed streams are decoded into mesh manager staging memory.
+		// handles are moved to mesh item, and released here if not moved.
+		MeshManager*						pMeshManager = nullptr;
+		MeshManager::Handle					stagedHandles[ResourceMeshBlobType::Max];
+		bool								isStagingPending[ResourceMeshBlobType::Max] = {};
+
+		~SourceData()
 		{
-			if (data.empty())
+			for (u32 type = ResourceMeshBlobType::StreamBegin; type < ResourceMeshBlobType::StreamEnd; type++)
 			{
-				return isEmpyOk;
+				auto&& h = stagedHandles[type];
+				if (!h.IsValid())
+					continue;
+				if (isStagingPending[type])
+					pMeshManager->EndDeploy(h);
+				if (type < ResourceMeshBlobType::Index)
+					pMeshManager->ReleaseVertexBuffer(h);
+				else
+					pMeshManager->ReleaseIndexBuffer(h);
 			}
+		}
 
-			if (!pHandle)
+		std::string GetString(const ResourceMeshFileString& str) const
+		{
+			if (!pStrings || (u64)str.offset + str.length > stringSize)
+			{
+				return std::string();
+			}
+			return std::string(pStrings + str.offset, str.length);
+		}
+
+		bool ReadV1(void* pData, u64 size, SourceStorageV1& storage);
+		bool ReadV2(ResourceLoader* pLoader, const void* pData, u64 size);
+		bool ReadV2Tables(ResourceLoader* pLoader, const std::string& filepath, const ResourceMeshFileHeader& header);
+	};	// struct ResourceItemMesh::SourceData
+
+	//---------------
+	bool ResourceItemMesh::SourceData::ReadV1(void* pData, u64 size, SourceStorageV1& storage)
+	{
+		{
+			MemoryStreamBuf buf(pData, (size_t)size);
+			std::istream ifs(&buf);
+			cereal::BinaryInputArchive ar(ifs);
+			ar(cereal::make_nvp("mesh", storage.mesh));
+		}
+		auto&& mesh = storage.mesh;
+
+		storage.materials.resize(mesh.GetMaterials().size());
+		for (size_t i = 0; i < storage.materials.size(); i++)
+		{
+			auto&& src = mesh.GetMaterials()[i];
+			auto&& dst = storage.materials[i];
+			dst = ResourceMeshFileMaterial();
+			dst.name = AddString(storage.strings, src.GetName());
+			for (u32 t = 0; t < ResourceMeshFileMaterial::kTextureCount && t < src.GetTextureNames().size(); t++)
 			{
+				dst.textureNames[t] = AddString(storage.strings, src.GetTextureNames()[t]);
+			}
+			auto bc = src.GetBaseColor();
+			auto ec = src.GetEmissiveColor();
+			dst.baseColor[0] = bc.x; dst.baseColor[1] = bc.y; dst.baseColor[2] = bc.z; dst.baseColor[3] = bc.w;
+			dst.emissiveColor[0] = ec.x; dst.emissiveColor[1] = ec.y; dst.emissiveColor[2] = ec.z;
+			dst.roughness = src.GetRoughness();
+			dst.metallic = src.GetMetallic();
+			dst.blendType = src.GetBlendType();
+			dst.cullMode = src.GetCullMode();
+		}
+
+		storage.submeshes.resize(mesh.GetSubmeshes().size());
+		for (size_t i = 0; i < storage.submeshes.size(); i++)
+		{
+			auto&& src = mesh.GetSubmeshes()[i];
+			auto&& dst = storage.submeshes[i];
+			dst.materialIndex = src.GetMaterialIndex();
+			dst.vertexOffset = src.GetVertexOffset();
+			dst.vertexCount = src.GetVertexCount();
+			dst.indexOffset = src.GetIndexOffset();
+			dst.indexCount = src.GetIndexCount();
+			dst.meshletPrimitiveOffset = src.GetMeshletPrimitiveOffset();
+			dst.meshletPrimitiveCount = src.GetMeshletPrimitiveCount();
+			dst.meshletVertexIndexOffset = src.GetMeshletVertexIndexOffset();
+			dst.meshletVertexIndexCount = src.GetMeshletVertexIndexCount();
+			dst.meshletOffset = (u32)storage.meshlets.size();
+			dst.meshletCount = (u32)src.GetMeshlets().size();
+			dst.boundingSphere = src.GetBoundingSphere();
+			dst.boundingBox = src.GetBoundingBox();
+
+			for (auto&& let : src.GetMeshlets())
+			{
+				ResourceMeshFileMeshlet m;
+				m.indexOffset = let.GetIndexOffset();
+				m.indexCount = let.GetIndexCount();
+				m.primitiveOffset = let.GetPrimitiveOffset();
+				m.primitiveCount = let.GetPrimitiveCount();
+				m.vertexIndexOffset = let.GetVertexIndexOffset();
+				m.vertexIndexCount = let.GetVertexIndexCount();
+				m.boundingSphere = let.GetBoundingSphere();
+				m.boundingBox = let.GetBoundingBox();
+				m.cone = let.GetCone();
+				storage.meshlets.push_back(m);
+			}
+		}
+
+		boundingSphere = mesh.GetBoundingSphere();
+		boundingBox = mesh.GetBoundingBox();
+		pMaterials = storage.materials.data();
+		materialCount = (u32)storage.materials.size();
+		pSubmeshes = storage.submeshes.data();
+		submeshCount = (u32)storage.submeshes.size();
+		pMeshlets = storage.meshlets.data();
+		meshletCount = (u32)storage.meshlets.size();
+		pStrings = storage.strings.data();
+		stringSize = storage.strings.size();
+
+		auto SetStream = [&](ResourceMeshBlobType::Type type, const std::vector<u8>& data)
+		{
+			pStreams[type] = data.empty() ? nullptr : data.data();
+			streamSizes[type] = data.size();
+		};
+		SetStream(ResourceMeshBlobType::Position, mesh.GetVBPosition());
+		SetStream(ResourceMeshBlobType::Normal, mesh.GetVBNormal());
+		SetStream(ResourceMeshBlobType::Tangent, mesh.GetVBTangent());
+		SetStream(ResourceMeshBlobType::Texcoord, mesh.GetVBTexcoord());
+		SetStream(ResourceMeshBlobType::Index, mesh.GetIndexBuffer());
+		SetStream(ResourceMeshBlobType::MeshletPackedPrimitive, mesh.GetMeshletPackedPrimitive());
+		SetStream(ResourceMeshBlobType::MeshletVertexIndex, mesh.GetMeshletVertexIndex());
+		return true;
+	}
+
+	//---------------
+	// all tables and uncompressed streams refer file memory.
+	bool ResourceItemMesh::SourceData::ReadV2(ResourceLoader* pLoader, const void* pData, u64 size)
+	{
+		auto pHead = reinterpret_cast<const u8*>(pData);
+		auto pHeader = reinterpret_cast<const ResourceMeshFileHeader*>(pData);
+		if (pHeader->version < ResourceMeshFileHeader::kMinVersion || pHeader->version > ResourceMeshFileHeader::kVersion)
+		{
+			ConsolePrint("Error: unsupported rmesh version. (%d)\n", pHeader->version);
+			return false;
+		}
+
+		// blobs not stored in this version are empty.
+		ResourceMeshBlob blobs[ResourceMeshBlobType::Max] = {};
+		u32 blobCount = ResourceMeshFileHeader::GetBlobCount(pHeader->version);
+		if (size < offsetof(ResourceMeshFileHeader, blobs) + sizeof(ResourceMeshBlob) * blobCount)
+		{
+			ConsolePrint("Error: rmesh header is out of file.\n");
+			return false;
+		}
+		for (u32 type = 0; type < blobCount; type++)
+		{
+			auto&& blob = pHeader->blobs[type];
+			if (blob.offset + blob.size > size)
+			{
+				ConsolePrint("Error: rmesh blob is out of file.\n");
 				return false;
 			}
+			blobs[type] = blob;
+		}
 
-			// deploy to mesh manager.
-			if (usage & ResourceUsage::VertexBuffer)
+		if (!IsTableSizeValid(*pHeader, blobs))
+		{
+			ConsolePrint("Error: rmesh table size mismatch.\n");
+			return false;
+		}
+
+		boundingSphere = pHeader->boundingSphere;
+		boundingBox = pHeader->boundingBox;
+		pMaterials = reinterpret_cast<const ResourceMeshFileMaterial*>(pHead + blobs[ResourceMeshBlobType::Material].offset);
+		materialCount = pHeader->materialCount;
+		pSubmeshes = reinterpret_cast<const ResourceMeshFileSubmesh*>(pHead + blobs[ResourceMeshBlobType::Submesh].offset);
+		submeshCount = pHeader->submeshCount;
+		pMeshlets = reinterpret_cast<const ResourceMeshFileMeshlet*>(pHead + blobs[ResourceMeshBlobType::Meshlet].offset);
+		meshletCount = pHeader->meshletCount;
+		pStrings = reinterpret_cast<const char*>(pHead + blobs[ResourceMeshBlobType::String].offset);
+		stringSize = blobs[ResourceMeshBlobType::String].size;
+		pLods = reinterpret_cast<const ResourceMeshFileLod*>(pHead + blobs[ResourceMeshBlobType::Lod].offset);
+		lodCount = (u32)(blobs[ResourceMeshBlobType::Lod].size / sizeof(ResourceMeshFileLod));
+		pClusters = reinterpret_cast<const ResourceMeshFileCluster*>(pHead + blobs[ResourceMeshBlobType::Cluster].offset);
+		clusterCount = (u32)(blobs[ResourceMeshBlobType::Cluster].size / sizeof(ResourceMeshFileCluster));
+		if (!(pHeader->flags & ResourceMeshFileFlag::CompressedStreams))
+		{
+			for (u32 type = ResourceMeshBlobType::StreamBegin; type < ResourceMeshBlobType::StreamEnd; type++)
 			{
-				*pHandle = pMeshMan->DeployVertexBuffer(data.data(), data.size());
+				pStreams[type] = blobs[type].size ? pHead + blobs[type].offset : nullptr;
+				streamSizes[type] = blobs[type].size;
+				streamBlobs[type] = blobs[type];
 			}
-			else if (usage & ResourceUsage::IndexBuffer)
+			hasStreamBlobs = true;
+			return true;
+		}
+
+		// decode compressed streams in parallel.
+		// decoded data is written to staging memory directly, and is not kept on cpu memory.
+		pMeshManager = pLoader->GetMeshManager();
+		assert(pMeshManager != nullptr);
+		std::vector<std::function<void()>> tasks;
+		bool results[ResourceMeshBlobType::Max];
+		for (u32 type = ResourceMeshBlobType::StreamBegin; type < ResourceMeshBlobType::StreamEnd; type++)
+		{
+			results[type] = true;
+			if (!blobs[type].size)
+			{
+				continue;
+			}
+			if (blobs[type].size < sizeof(ResourceMeshStreamHeader))
+			{
+				ConsolePrint("Error: invalid rmesh stream.\n");
+				return false;
+			}
+
+			auto pStreamHeader = reinterpret_cast<const ResourceMeshStreamHeader*>(pHead + blobs[type].offset);
+			const u8* pEncoded = pHead + blobs[type].offset + sizeof(ResourceMeshStreamHeader);
+			size_t encodedSize = (size_t)(blobs[type].size - sizeof(ResourceMeshStreamHeader));
+			if (pStreamHeader->codec == ResourceMeshStreamCodec::None)
+			{
+				pStreams[type] = encodedSize ? pEncoded : nullptr;
+				streamSizes[type] = encodedSize;
+				continue;
+			}
+
+			size_t decodedSize = (size_t)(pStreamHeader->elementSize * pStreamHeader->elementCount);
+			void* pDst = (type < ResourceMeshBlobType::Index)
+				? pMeshManager->BeginDeployVertexBuffer(decodedSize, stagedHandles[type])
+				: pMeshManager->BeginDeployIndexBuffer(decodedSize, stagedHandles[type]);
+			if (!pDst)
 			{
-				*pHandle = pMeshMan->DeployIndexBuffer(data.data(), data.size());
+				ConsolePrint("Error: failed to deploy rmesh stream. (%d)\n", type);
+				return false;
 			}
+			isStagingPending[type] = true;
+			// staging memory is write only. streams are used through staged handles.
+			pStreams[type] = pDst;
+			streamSizes[type] = decodedSize;
+
+			bool* pResult = &results[type];
+			tasks.push_back([pStreamHeader, pEncoded, encodedSize, pDst, pResult]
+			{
+				*pResult = DecodeStream(*pStreamHeader, pEncoded, encodedSize, pDst);
+			});
+		}
+		pLoader->ParallelRun(tasks);
 
+		for (u32 type = ResourceMeshBlobType::StreamBegin; type < ResourceMeshBlobType::StreamEnd; type++)
+		{
+			if (isStagingPending[type])
+			{
+				pMeshManager->EndDeploy(stagedHandles[type]);
+				isStagingPending[type] = false;
+			}
+		}
+
+		for (u32 type = ResourceMeshBlobType::StreamBegin; type < ResourceMeshBlobType::StreamEnd; type++)
+		{
+			if (!results[type])
+			{
+				ConsolePrint("Error: failed to decode rmesh stream. (%d)\n", type);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//---------------
+	// read tables only. streams are read by StreamInSubmesh, and their sizes are used for validation.
+	bool ResourceItemMesh::SourceData::ReadV2Tables(ResourceLoader* pLoader, const std::string& filepath, const ResourceMeshFileHeader& header)
+	{
+		auto&& blobs = header.blobs;
+		if (!IsTableSizeValid(header, blobs))
+		{
+			ConsolePrint("Error: rmesh table size mismatch.\n");
+			return false;
+		}
+
+		auto ReadTable = [&](ResourceMeshBlobType::Type type, const void** ppData)
+		{
+			*ppData = nullptr;
+			if (!blobs[type].size)
+			{
+				return true;
+			}
+			auto file = pLoader->OpenFileRange(filepath, blobs[type].offset, blobs[type].size);
+			if (!file)
+			{
+				ConsolePrint("Error: rmesh blob is out of file.\n");
+				return false;
+			}
+			*ppData = file->GetData();
+			tableFiles.push_back(std::move(file));
 			return true;
 		};
-		if (!CreateBuffer(&ret->hPosition_, mesh_bin.GetVBPosition(), sizeof(DirectX::XMFLOAT3), ResourceUsage::VertexBuffer))
+		const void* pTables[ResourceMeshBlobType::Max] = {};
+		for (auto type : { ResourceMeshBlobType::Material, ResourceMeshBlobType::Submesh, ResourceMeshBlobType::Meshlet,
+			ResourceMeshBlobType::String, ResourceMeshBlobType::Lod, ResourceMeshBlobType::Cluster })
 		{
-			return nullptr;
+			if (!ReadTable(type, &pTables[type]))
+			{
+				return false;
+			}
 		}
-		if (!CreateBuffer(&ret->hNormal_, mesh_bin.GetVBNormal(), sizeof(DirectX::XMFLOAT3), ResourceUsage::VertexBuffer))
+
+		boundingSphere = header.boundingSphere;
+		boundingBox = header.boundingBox;
+		pMaterials = reinterpret_cast<const ResourceMeshFileMaterial*>(pTables[ResourceMeshBlobType::Material]);
+		materialCount = header.materialCount;
+		pSubmeshes = reinterpret_cast<const ResourceMeshFileSubmesh*>(pTables[ResourceMeshBlobType::Submesh]);
+		submeshCount = header.submeshCount;
+		pMeshlets = reinterpret_cast<const ResourceMeshFileMeshlet*>(pTables[ResourceMeshBlobType::Meshlet]);
+		meshletCount = header.meshletCount;
+		pStrings = reinterpret_cast<const char*>(pTables[ResourceMeshBlobType::String]);
+		stringSize = blobs[ResourceMeshBlobType::String].size;
+		pLods = reinterpret_cast<const ResourceMeshFileLod*>(pTables[ResourceMeshBlobType::Lod]);
+		lodCount = (u32)(blobs[ResourceMeshBlobType::Lod].size / sizeof(ResourceMeshFileLod));
+		pClusters = reinterpret_cast<const ResourceMeshFileCluster*>(pTables[ResourceMeshBlobType::Cluster]);
+		clusterCount = (u32)(blobs[ResourceMeshBlobType::Cluster].size / sizeof(ResourceMeshFileCluster));
+		for (u32 type = ResourceMeshBlobType::StreamBegin; type < ResourceMeshBlobType::StreamEnd; type++)
 		{
-			return nullptr;
+			streamSizes[type] = blobs[type].size;
+			streamBlobs[type] = blobs[type];
 		}
-		if (!CreateBuffer(&ret->hTangent_, mesh_bin.GetVBTangent(), sizeof(DirectX::XMFLOAT4), ResourceUsage::VertexBuffer))
+		hasStreamBlobs = true;
+		return true;
+	}
+
+	//---------------
+	ResourceItemBase* ResourceItemMesh::LoadFunction(ResourceLoader* pLoader, ResourceHandle handle, const std::string& filepath)
+	{
+		return LoadImpl(pLoader, handle, filepath, false);
+	}
+
+	//---------------
+	ResourceItemBase* ResourceItemMesh::LoadFunctionPartial(ResourceLoader* pLoader, ResourceHandle handle, const std::string& filepath)
+	{
+		return LoadImpl(pLoader, handle, filepath, true);
+	}
+
+	//---------------
+	ResourceItemBase* ResourceItemMesh::LoadImpl(ResourceLoader* pLoader, ResourceHandle handle, const std::string& filepath, bool bPartial)
+	{
+		// partial mesh reads header and tables only. file is not prefetched in io stage.
+		if (bPartial)
 		{
-			return nullptr;
+			ResourceMeshFileHeader header;
+			if (ReadHeaderForPartial(pLoader, filepath, header))
+			{
+				SourceData src;
+				if (!src.ReadV2Tables(pLoader, filepath, header))
+				{
+					return nullptr;
+				}
+				return CreateFromSource(pLoader, handle, filepath, src, true);
+			}
 		}
-		if (!CreateBuffer(&ret->hTexcoord_, mesh_bin.GetVBTexcoord(), sizeof(DirectX::XMFLOAT2), ResourceUsage::VertexBuffer))
+
+		// file is prefetched in io stage, except partial mesh.
+		auto meshFile = pLoader->OpenFile(filepath);
+		if (!meshFile)
 		{
 			return nullptr;
 		}
-		if (!CreateBuffer(&ret->hIndex_, mesh_bin.GetIndexBuffer(), sizeof(u32), ResourceUsage::IndexBuffer))
+
+		// v2 is used in place. v1 is deserialized.
+		SourceData src;
+		std::unique_ptr<SourceStorageV1> storage;
+		if (IsSourceV2(meshFile->GetData(), meshFile->GetSize()))
 		{
-			return nullptr;
+			if (!src.ReadV2(pLoader, meshFile->GetData(), meshFile->GetSize()))
+			{
+				return nullptr;
+			}
 		}
-		if (!CreateBuffer(&ret->hMeshletPackedPrim_, mesh_bin.GetMeshletPackedPrimitive(), sizeof(u32), ResourceUsage::IndexBuffer, true))
+		else
 		{
-			return nullptr;
+			storage = std::make_unique<SourceStorageV1>();
+			if (!src.ReadV1(meshFile->GetData(), meshFile->GetSize(), *storage))
+			{
+				return nullptr;
+			}
+			meshFile.reset();
 		}
-		if (!CreateBuffer(&ret->hMeshletVertexIndex_, mesh_bin.GetMeshletVertexIndex(), sizeof(u32), ResourceUsage::IndexBuffer, true))
+
+		// streams must be read from file without decoding.
+		if (bPartial && !src.hasStreamBlobs)
+		{
+			ConsolePrint("Warning: partial load needs uncompressed rmesh v2. whole mesh is loaded. (%s)\n", filepath.c_str());
+			bPartial = false;
+		}
+
+		return CreateFromSource(pLoader, handle, filepath, src, bPartial);
+	}
+
+	//---------------
+	ResourceItemMesh* ResourceItemMesh::CreateFromSource(ResourceLoader* pLoader, ResourceHandle handle, const std::string& filepath, SourceData& src, bool bPartial)
+	{
+		// partial mesh has no stream data here.
+		if (!src.streamSizes[ResourceMeshBlobType::Index])
 		{
 			return nullptr;
 		}
 
-		auto path = sl12::GetFilePath(filepath);
+		std::unique_ptr<ResourceItemMesh> ret(new ResourceItemMesh(handle));
 
-		// create materials.
-		auto&& src_materials = mesh_bin.GetMaterials();
-		auto mat_count = src_materials.size();
-		ret->mateirals_.resize(mat_count);
-		for (size_t i = 0; i < mat_count; i++)
+		// set bounding sphere.
+		ConvertBounding(ret->boundingInfo_, src.boundingSphere, src.boundingBox);
+
+		// create buffers.
+		// mesh manager copies data from source memory to staging memory directly.
+		auto pDev = pLoader->GetDevice();
+		auto pMeshMan = pLoader->GetMeshManager();
+		assert(pDev != nullptr && pMeshMan != nullptr);
+		ret->pMeshManager_ = pMeshMan;
+		auto CreateBuffer = [&](MeshManager::Handle* pHandle, ResourceMeshBlobType::Type type, u32 usage, bool isEmpyOk = false)
 		{
-			ret->mateirals_[i].name = src_materials[i].GetName();
-			auto& texNames = src_materials[i].GetTextureNames();
-			if (texNames.size() > 0 && !texNames[0].empty())
+			const void* pData = src.pStreams[type];
+			size_t size = (size_t)src.streamSizes[type];
+			if (!pData || !size)
 			{
-				std::string f = path + texNames[0];
-				ret->mateirals_[i].baseColorTex = IsStreamingTexture(f) ? pLoader->LoadRequest<ResourceItemStreamingTexture>(f) : pLoader->LoadRequest<ResourceItemTexture>(f);
+				return isEmpyOk;
+			}
+
+			if (!pHandle)
+			{
+				return false;
+			}
+
+			// decoded in staging memory.
+			if (src.stagedHandles[type].IsValid())
+			{
+				*pHandle = src.stagedHandles[type];
+				src.stagedHandles[type] = MeshManager::Handle();
+				return true;
+			}
+
+			// deploy to mesh manager.
+			if (usage & ResourceUsage::VertexBuffer)
+			{
+				*pHandle = pMeshMan->DeployVertexBuffer(pData, size);
+			}
+			else if (usage & ResourceUsage::IndexBuffer)
+			{
+				*pHandle = pMeshMan->DeployIndexBuffer(pData, size);
+			}
+
+			return true;
+		};
+		// partial mesh deploys submesh streams on demand.
+		if (!bPartial)
+		{
+			if (!CreateBuffer(&ret->hPosition_, ResourceMeshBlobType::Position, ResourceUsage::VertexBuffer))
+			{
+				return nullptr;
 			}
-			if (texNames.size() > 1 && !texNames[1].empty())
+			if (!CreateBuffer(&ret->hNormal_, ResourceMeshBlobType::Normal, ResourceUsage::VertexBuffer))
 			{
-				std::string f = path + texNames[1];
-				ret->mateirals_[i].normalTex = IsStreamingTexture(f) ? pLoader->LoadRequest<ResourceItemStreamingTexture>(f) : pLoader->LoadRequest<ResourceItemTexture>(f);
+				return nullptr;
 			}
-			if (texNames.size() > 2 && !texNames[2].empty())
+			if (!CreateBuffer(&ret->hTangent_, ResourceMeshBlobType::Tangent, ResourceUsage::VertexBuffer))
 			{
-				std::string f = path + texNames[2];
-				ret->mateirals_[i].ormTex = IsStreamingTexture(f) ? pLoader->LoadRequest<ResourceItemStreamingTexture>(f) : pLoader->LoadRequest<ResourceItemTexture>(f);
+				return nullptr;
 			}
-			if (texNames.size() > 3 && !texNames[3].empty())
+			if (!CreateBuffer(&ret->hTexcoord_, ResourceMeshBlobType::Texcoord, ResourceUsage::VertexBuffer))
 			{
-				std::string f = path + texNames[3];
-				ret->mateirals_[i].emissiveTex = IsStreamingTexture(f) ? pLoader->LoadRequest<ResourceItemStreamingTexture>(f) : pLoader->LoadRequest<ResourceItemTexture>(f);
+				return nullptr;
+			}
+			if (!CreateBuffer(&ret->hIndex_, ResourceMeshBlobType::Index, ResourceUsage::IndexBuffer))
+			{
+				return nullptr;
+			}
+			if (!CreateBuffer(&ret->hMeshletPackedPrim_, ResourceMeshBlobType::MeshletPackedPrimitive, ResourceUsage::IndexBuffer, true))
+			{
+				return nullptr;
+			}
+			if (!CreateBuffer(&ret->hMeshletVertexIndex_, ResourceMeshBlobType::MeshletVertexIndex, ResourceUsage::IndexBuffer, true))
+			{
+				return nullptr;
 			}
-			ret->mateirals_[i].baseColor = src_materials[i].GetBaseColor();
-			ret->mateirals_[i].emissiveColor = src_materials[i].GetEmissiveColor();
-			ret->mateirals_[i].roughness = src_materials[i].GetRoughness();
-			ret->mateirals_[i].metallic = src_materials[i].GetMetallic();
-			ret->mateirals_[i].blendType = src_materials[i].GetBlendType();
-			ret->mateirals_[i].cullMode = src_materials[i].GetCullMode();
 		}
 
+		auto path = sl12::GetFilePath(filepath);
+
+		// create materials.
+		ret->mateirals_.resize(src.materialCount);
+		for (u32 i = 0; i < src.materialCount; i++)
+		{
+			auto&& srcMat = src.pMaterials[i];
+			auto&& dstMat = ret->mateirals_[i];
+			dstMat.name = src.GetString(srcMat.name);
+
+			ResourceHandle* texHandles[] = { &dstMat.baseColorTex, &dstMat.normalTex, &dstMat.ormTex, &dstMat.emissiveTex };
+			for (u32 t = 0; t < ResourceMeshFileMaterial::kTextureCount; t++)
+			{
+				std::string texName = src.GetString(srcMat.textureNames[t]);
+				if (texName.empty())
+				{
+					continue;
+				}
+				std::string f = path + texName;
+				*texHandles[t] = IsStreamingTexture(f) ? pLoader->LoadRequest<ResourceItemStreamingTexture>(f) : pLoader->LoadRequest<ResourceItemTexture>(f);
+				// textures are released with this mesh.
+				if (texHandles[t]->GetLoader())
+				{
+					ret->AddDependency(*texHandles[t]);
+				}
+			}
+			dstMat.baseColor = DirectX::XMFLOAT4(srcMat.baseColor);
+			dstMat.emissiveColor = DirectX::XMFLOAT3(srcMat.emissiveColor);
+			dstMat.roughness = srcMat.roughness;
+			dstMat.metallic = srcMat.metallic;
+			dstMat.blendType = srcMat.blendType;
+			dstMat.cullMode = srcMat.cullMode;
+		}
+
+		// meshlet ranges are relative to submesh, and must be in streams.
+		auto IsMeshletInStreams = [&src](const ResourceMeshFileSubmesh& sub, const ResourceMeshFileMeshlet& let)
+		{
+			return ((u64)sub.indexOffset + let.indexOffset + let.indexCount) * ResourceItemMesh::GetIndexStride() <= src.streamSizes[ResourceMeshBlobType::Index]
+				&& ((u64)sub.meshletPrimitiveOffset + let.primitiveOffset + let.primitiveCount) * sizeof(u32) <= src.streamSizes[ResourceMeshBlobType::MeshletPackedPrimitive]
+				&& ((u64)sub.meshletVertexIndexOffset + let.vertexIndexOffset + let.vertexIndexCount) * ResourceItemMesh::GetIndexStride() <= src.streamSizes[ResourceMeshBlobType::MeshletVertexIndex];
+		};
+
 		// create submeshes.
-		auto&& src_submeshes = mesh_bin.GetSubmeshes();
-		auto sub_count = src_submeshes.size();
-		ret->Submeshes_.resize(sub_count);
-		for (size_t i = 0; i < sub_count; i++)
+		ret->Submeshes_.resize(src.submeshCount);
+		for (u32 i = 0; i < src.submeshCount; i++)
 		{
-			auto&& src = src_submeshes[i];
+			auto&& srcSub = src.pSubmeshes[i];
 			auto&& dst = ret->Submeshes_[i];
 
-			dst.materialIndex = src.GetMaterialIndex();
-			dst.vertexCount = src.GetVertexCount();
-			dst.indexCount = src.GetIndexCount();
+			dst.materialIndex = srcSub.materialIndex;
+			dst.vertexCount = srcSub.vertexCount;
+			dst.indexCount = srcSub.indexCount;
+
+			dst.positionSizeBytes = ResourceItemMesh::GetPositionStride() * srcSub.vertexCount;
+			dst.normalSizeBytes = ResourceItemMesh::GetNormalStride() * srcSub.vertexCount;
+			dst.tangentSizeBytes = ResourceItemMesh::GetTangentStride() * srcSub.vertexCount;
+			dst.texcoordSizeBytes = ResourceItemMesh::GetTexcoordStride() * srcSub.vertexCount;
+			dst.indexSizeBytes = ResourceItemMesh::GetIndexStride() * srcSub.indexCount;
+			dst.meshletPackedPrimSizeBytes = sizeof(u32) * srcSub.meshletPrimitiveCount;
+			dst.meshletVertexIndexSizeBytes = ResourceItemMesh::GetIndexStride() * srcSub.meshletVertexIndexCount;
+
+			dst.positionOffsetBytes = ResourceItemMesh::GetPositionStride() * srcSub.vertexOffset;
+			dst.normalOffsetBytes = ResourceItemMesh::GetNormalStride() * srcSub.vertexOffset;
+			dst.tangentOffsetBytes = ResourceItemMesh::GetTangentStride() * srcSub.vertexOffset;
+			dst.texcoordOffsetBytes = ResourceItemMesh::GetTexcoordStride() * srcSub.vertexOffset;
+			dst.indexOffsetBytes = ResourceItemMesh::GetIndexStride() * srcSub.indexOffset;
+			dst.meshletPackedPrimOffsetBytes = sizeof(u32) * srcSub.meshletPrimitiveOffset;
+			dst.meshletVertexIndexOffsetBytes = ResourceItemMesh::GetIndexStride() * srcSub.meshletVertexIndexOffset;
 
-			dst.positionSizeBytes = ResourceItemMesh::GetPositionStride() * src.GetVertexCount();
-			dst.normalSizeBytes = ResourceItemMesh::GetNormalStride() * src.GetVertexCount();
-			dst.tangentSizeBytes = ResourceItemMesh::GetTangentStride() * src.GetVertexCount();
-			dst.texcoordSizeBytes = ResourceItemMesh::GetTexcoordStride() * src.GetVertexCount();
-			dst.indexSizeBytes = ResourceItemMesh::GetIndexStride() * src.GetIndexCount();
-			dst.meshletPackedPrimSizeBytes = sizeof(u32) * src.GetMeshletPrimitiveCount();
-			dst.meshletVertexIndexSizeBytes = ResourceItemMesh::GetIndexStride() * src.GetMeshletVertexIndexCount();
-
-			dst.positionOffsetBytes = ResourceItemMesh::GetPositionStride() * src.GetVertexOffset();
-			dst.normalOffsetBytes = ResourceItemMesh::GetNormalStride() * src.GetVertexOffset();
-			dst.tangentOffsetBytes = ResourceItemMesh::GetTangentStride() * src.GetVertexOffset();
-			dst.texcoordOffsetBytes = ResourceItemMesh::GetTexcoordStride() * src.GetVertexOffset();
-			dst.indexOffsetBytes = ResourceItemMesh::GetIndexStride() * src.GetIndexOffset();
-			dst.meshletPackedPrimOffsetBytes = sizeof(u32) * src.GetMeshletPrimitiveOffset();
-			dst.meshletVertexIndexOffsetBytes = ResourceItemMesh::GetIndexStride() * src.GetMeshletVertexIndexOffset();
-
-			dst.boundingInfo.sphere.center.x = src.GetBoundingSphere().centerX;
-			dst.boundingInfo.sphere.center.y = src.GetBoundingSphere().centerY;
-			dst.boundingInfo.sphere.center.z = src.GetBoundingSphere().centerZ;
-			dst.boundingInfo.sphere.radius = src.GetBoundingSphere().radius;
-			dst.boundingInfo.box.aabbMin.x = src.GetBoundingBox().minX;
-			dst.boundingInfo.box.aabbMin.y = src.GetBoundingBox().minY;
-			dst.boundingInfo.box.aabbMin.z = src.GetBoundingBox().minZ;
-			dst.boundingInfo.box.aabbMax.x = src.GetBoundingBox().maxX;
-			dst.boundingInfo.box.aabbMax.y = src.GetBoundingBox().maxY;
-			dst.boundingInfo.box.aabbMax.z = src.GetBoundingBox().maxZ;
+			ConvertBounding(dst.boundingInfo, srcSub.boundingSphere, srcSub.boundingBox);
+
+			// lod0 is the base mesh.
+			Lod lod0;
+			lod0.indexCount = dst.indexCount;
+			lod0.indexOffsetBytes = dst.indexOffsetBytes;
+			lod0.indexSizeBytes = dst.indexSizeBytes;
+			lod0.error = 0.0f;
+			dst.lods.push_back(lod0);
 
 			// create meshlets.
-			auto&& src_meshlets = src.GetMeshlets();
-			if (!src_meshlets.empty())
+			if (srcSub.meshletCount > 0)
 			{
-				auto let_count = src_meshlets.size();
-				dst.meshlets.resize(let_count);
-				for (size_t j = 0; j < let_count; j++)
+				if ((u64)srcSub.meshletOffset + srcSub.meshletCount > src.meshletCount)
+				{
+					return nullptr;
+				}
+				dst.meshlets.resize(srcSub.meshletCount);
+				for (u32 j = 0; j < srcSub.meshletCount; j++)
 				{
-					dst.meshlets[j].indexCount = src_meshlets[j].GetIndexCount();
-					dst.meshlets[j].indexOffset = src_meshlets[j].GetIndexOffset();
-					dst.meshlets[j].primitiveCount = src_meshlets[j].GetPrimitiveCount();
-					dst.meshlets[j].primitiveOffset = src_meshlets[j].GetPrimitiveOffset();
-					dst.meshlets[j].vertexIndexCount = src_meshlets[j].GetVertexIndexCount();
-					dst.meshlets[j].vertexIndexOffset = src_meshlets[j].GetVertexIndexOffset();
-
-					dst.meshlets[j].boundingInfo.sphere.center.x = src_meshlets[j].GetBoundingSphere().centerX;
-					dst.meshlets[j].boundingInfo.sphere.center.y = src_meshlets[j].GetBoundingSphere().centerY;
-					dst.meshlets[j].boundingInfo.sphere.center.z = src_meshlets[j].GetBoundingSphere().centerZ;
-					dst.meshlets[j].boundingInfo.sphere.radius = src_meshlets[j].GetBoundingSphere().radius;
-					dst.meshlets[j].boundingInfo.box.aabbMin.x = src_meshlets[j].GetBoundingBox().minX;
-					dst.meshlets[j].boundingInfo.box.aabbMin.y = src_meshlets[j].GetBoundingBox().minY;
-					dst.meshlets[j].boundingInfo.box.aabbMin.z = src_meshlets[j].GetBoundingBox().minZ;
-					dst.meshlets[j].boundingInfo.box.aabbMax.x = src_meshlets[j].GetBoundingBox().maxX;
-					dst.meshlets[j].boundingInfo.box.aabbMax.y = src_meshlets[j].GetBoundingBox().maxY;
-					dst.meshlets[j].boundingInfo.box.aabbMax.z = src_meshlets[j].GetBoundingBox().maxZ;
-					dst.meshlets[j].boundingInfo.cone.apex.x = src_meshlets[j].GetCone().apexX;
-					dst.meshlets[j].boundingInfo.cone.apex.y = src_meshlets[j].GetCone().apexY;
-					dst.meshlets[j].boundingInfo.cone.apex.z = src_meshlets[j].GetCone().apexZ;
-					dst.meshlets[j].boundingInfo.cone.axis.x = src_meshlets[j].GetCone().axisX;
-					dst.meshlets[j].boundingInfo.cone.axis.y = src_meshlets[j].GetCone().axisY;
-					dst.meshlets[j].boundingInfo.cone.axis.z = src_meshlets[j].GetCone().axisZ;
-					dst.meshlets[j].boundingInfo.cone.cutoff = src_meshlets[j].GetCone().cutoff;
+					auto&& srcLet = src.pMeshlets[srcSub.meshletOffset + j];
+					if (!IsMeshletInStreams(srcSub, srcLet))
+					{
+						return nullptr;
+					}
+					ConvertMeshlet(dst.meshlets[j], srcLet);
 				}
 			}
 		}
 
+		// create lods.
+		for (u32 i = 0; i < src.lodCount; i++)
+		{
+			auto&& srcLod = src.pLods[i];
+			if (srcLod.submeshIndex >= src.submeshCount
+				|| ((u64)srcLod.indexOffset + srcLod.indexCount) * ResourceItemMesh::GetIndexStride() > src.streamSizes[ResourceMeshBlobType::Index])
+			{
+				return nullptr;
+			}
+			Lod lod;
+			lod.indexCount = srcLod.indexCount;
+			lod.indexOffsetBytes = ResourceItemMesh::GetIndexStride() * srcLod.indexOffset;
+			lod.indexSizeBytes = ResourceItemMesh::GetIndexStride() * srcLod.indexCount;
+			lod.error = srcLod.error;
+			ret->Submeshes_[srcLod.submeshIndex].lods.push_back(lod);
+		}
+
+		// create cluster dag.
+		for (u32 i = 0; i < src.clusterCount; i++)
+		{
+			auto&& srcCluster = src.pClusters[i];
+			if (srcCluster.submeshIndex >= src.submeshCount
+				|| !IsMeshletInStreams(src.pSubmeshes[srcCluster.submeshIndex], srcCluster.meshlet))
+			{
+				return nullptr;
+			}
+			Cluster cluster;
+			ConvertMeshlet(cluster.meshlet, srcCluster.meshlet);
+			cluster.level = srcCluster.level;
+			ConvertClusterLod(cluster.lod, srcCluster.lod);
+			ConvertClusterLod(cluster.parentLod, srcCluster.parentLod);
+			ret->Submeshes_[srcCluster.submeshIndex].clusters.push_back(cluster);
+		}
+
+		if (bPartial && !ret->SetupSubmeshStreams(src))
+		{
+			return nullptr;
+		}
+
 		// create box to local transform.
 		DirectX::XMVECTOR aabbMin = DirectX::XMLoadFloat3(&ret->boundingInfo_.box.aabbMin);
 		DirectX::XMVECTOR aabbMax = DirectX::XMLoadFloat3(&ret->boundingInfo_.box.aabbMax);
@@ -257,6 +948,200 @@ namespace sl12
 		return ret.release();
 	}
 
+	//---------------
+	// compute stream ranges of each submesh. lods and clusters are included in the range of their submesh.
+	bool ResourceItemMesh::SetupSubmeshStreams(const SourceData& src)
+	{
+		for (u32 s = 0; s < kStreamCount; s++)
+		{
+			streamBlobs_[s] = src.streamBlobs[ResourceMeshBlobType::StreamBegin + s];
+		}
+
+		submeshStreams_.reset(new SubmeshStream[Submeshes_.size()]);
+		for (size_t i = 0; i < Submeshes_.size(); i++)
+		{
+			auto&& sub = Submeshes_[i];
+			auto&& stream = submeshStreams_[i];
+			size_t begins[kStreamCount] = {
+				sub.positionOffsetBytes, sub.normalOffsetBytes, sub.tangentOffsetBytes, sub.texcoordOffsetBytes,
+				sub.indexOffsetBytes, sub.meshletPackedPrimOffsetBytes, sub.meshletVertexIndexOffsetBytes,
+			};
+			size_t ends[kStreamCount] = {
+				sub.positionOffsetBytes + sub.positionSizeBytes,
+				sub.normalOffsetBytes + sub.normalSizeBytes,
+				sub.tangentOffsetBytes + sub.tangentSizeBytes,
+				sub.texcoordOffsetBytes + sub.texcoordSizeBytes,
+				sub.indexOffsetBytes + sub.indexSizeBytes,
+				sub.meshletPackedPrimOffsetBytes + sub.meshletPackedPrimSizeBytes,
+				sub.meshletVertexIndexOffsetBytes + sub.meshletVertexIndexSizeBytes,
+			};
+			const u32 kIndex = ResourceMeshBlobType::Index - ResourceMeshBlobType::StreamBegin;
+			const u32 kPrim = ResourceMeshBlobType::MeshletPackedPrimitive - ResourceMeshBlobType::StreamBegin;
+			const u32 kVertexIndex = ResourceMeshBlobType::MeshletVertexIndex - ResourceMeshBlobType::StreamBegin;
+			for (auto&& lod : sub.lods)
+			{
+				begins[kIndex] = std::min(begins[kIndex], lod.indexOffsetBytes);
+				ends[kIndex] = std::max(ends[kIndex], lod.indexOffsetBytes + lod.indexSizeBytes);
+			}
+			for (auto&& cluster : sub.clusters)
+			{
+				auto&& let = cluster.meshlet;
+				ends[kIndex] = std::max(ends[kIndex], sub.indexOffsetBytes + GetIndexStride() * (let.indexOffset + let.indexCount));
+				ends[kPrim] = std::max(ends[kPrim], sub.meshletPackedPrimOffsetBytes + sizeof(u32) * (let.primitiveOffset + let.primitiveCount));
+				ends[kVertexIndex] = std::max(ends[kVertexIndex], sub.meshletVertexIndexOffsetBytes + GetIndexStride() * (let.vertexIndexOffset + let.vertexIndexCount));
+			}
+
+			for (u32 s = 0; s < kStreamCount; s++)
+			{
+				if (ends[s] > streamBlobs_[s].size)
+				{
+					ConsolePrint("Error: rmesh submesh stream is out of blob. (%d)\n", s);
+					return false;
+				}
+				stream.offsetBytes[s] = begins[s];
+				stream.sizeBytes[s] = ends[s] - begins[s];
+			}
+		}
+
+		isPartial_ = true;
+		return true;
+	}
+
+	//---------------
+	ResourceItemMesh::SubmeshState::Type ResourceItemMesh::GetSubmeshState(u32 submeshIndex) const
+	{
+		if (!isPartial_)
+		{
+			return SubmeshState::Resident;
+		}
+		assert(submeshIndex < Submeshes_.size());
+		return (SubmeshState::Type)submeshStreams_[submeshIndex].state.load(std::memory_order_acquire);
+	}
+
+	//---------------
+	bool ResourceItemMesh::GetSubmeshStream(u32 submeshIndex, ResourceMeshBlobType::Type type, MeshManager::Handle& outHandle, size_t& outBaseOffsetBytes) const
+	{
+		if (type < ResourceMeshBlobType::StreamBegin || type >= ResourceMeshBlobType::StreamEnd || submeshIndex >= Submeshes_.size())
+		{
+			return false;
+		}
+
+		u32 s = type - ResourceMeshBlobType::StreamBegin;
+		if (!isPartial_)
+		{
+			const MeshManager::Handle* handles[kStreamCount] = {
+				&hPosition_, &hNormal_, &hTangent_, &hTexcoord_, &hIndex_, &hMeshletPackedPrim_, &hMeshletVertexIndex_,
+			};
+			outHandle = *handles[s];
+			outBaseOffsetBytes = 0;
+			return outHandle.IsValid();
+		}
+
+		auto&& stream = submeshStreams_[submeshIndex];
+		if (stream.state.load(std::memory_order_acquire) != SubmeshState::Resident)
+		{
+			return false;
+		}
+		outHandle = stream.handles[s];
+		outBaseOffsetBytes = stream.offsetBytes[s];
+		return outHandle.IsValid();
+	}
+
+	//---------------
+	bool ResourceItemMesh::StreamInSubmesh(ResourceItemMesh* pMesh, u32 submeshIndex)
+	{
+		assert(pMesh != nullptr);
+		if (!pMesh->isPartial_ || submeshIndex >= pMesh->Submeshes_.size())
+		{
+			return false;
+		}
+
+		auto&& stream = pMesh->submeshStreams_[submeshIndex];
+		u32 state = SubmeshState::NotResident;
+		if (!stream.state.compare_exchange_strong(state, SubmeshState::Loading))
+		{
+			return state == SubmeshState::Resident;
+		}
+
+		// read ranges directly. ranges in mounted archive refer mapped memory.
+		auto pLoader = pMesh->pParentLoader_;
+		auto pMeshMan = pMesh->pMeshManager_;
+		MeshManager::Handle handles[kStreamCount];
+		bool isSuccess = true;
+		for (u32 s = 0; s < kStreamCount; s++)
+		{
+			if (!stream.sizeBytes[s])
+			{
+				continue;
+			}
+			auto file = pLoader->OpenFileRange(pMesh->filePath_, pMesh->streamBlobs_[s].offset + stream.offsetBytes[s], stream.sizeBytes[s]);
+			if (!file)
+			{
+				isSuccess = false;
+				break;
+			}
+			handles[s] = IsVertexStream(s)
+				? pMeshMan->DeployVertexBuffer(file->GetData(), (size_t)file->GetSize())
+				: pMeshMan->DeployIndexBuffer(file->GetData(), (size_t)file->GetSize());
+		}
+
+		if (!isSuccess)
+		{
+			// not referred from GPU yet.
+			for (u32 s = 0; s < kStreamCount; s++)
+			{
+				if (!handles[s].IsValid())
+					continue;
+				if (IsVertexStream(s))
+					pMeshMan->ReleaseVertexBuffer(handles[s]);
+				else
+					pMeshMan->ReleaseIndexBuffer(handles[s]);
+			}
+			ConsolePrint("Error: failed to stream in submesh. (%s : %d)\n", pMesh->filePath_.c_str(), submeshIndex);
+			stream.state.store(SubmeshState::NotResident, std::memory_order_release);
+			return false;
+		}
+
+		for (u32 s = 0; s < kStreamCount; s++)
+		{
+			stream.handles[s] = handles[s];
+		}
+		stream.state.store(SubmeshState::Resident, std::memory_order_release);
+		pLoader->UpdateMemorySize(pMesh->GetHandle());
+		return true;
+	}
+
+	//---------------
+	bool ResourceItemMesh::EvictSubmesh(Device* pDevice, ResourceItemMesh* pMesh, u32 submeshIndex)
+	{
+		assert(pDevice != nullptr);
+		assert(pMesh != nullptr);
+		if (!pMesh->isPartial_ || submeshIndex >= pMesh->Submeshes_.size())
+		{
+			return false;
+		}
+
+		// lock as loading while handles are released.
+		auto&& stream = pMesh->submeshStreams_[submeshIndex];
+		u32 state = SubmeshState::Resident;
+		if (!stream.state.compare_exchange_strong(state, SubmeshState::Loading))
+		{
+			return false;
+		}
+
+		auto pMeshMan = pMesh->pMeshManager_;
+		for (u32 s = 0; s < kStreamCount; s++)
+		{
+			if (!stream.handles[s].IsValid())
+				continue;
+			pDevice->PendingKill(new ReleaseMeshBufferItem(pMeshMan, stream.handles[s], IsVertexStream(s)));
+			stream.handles[s] = MeshManager::Handle();
+		}
+		stream.state.store(SubmeshState::NotResident, std::memory_order_release);
+		pMesh->pParentLoader_->UpdateMemorySize(pMesh->GetHandle());
+		return true;
+	}
+
 }	// namespace sl12
 
 
@@ -151,8 +151,16 @@ namespace sl12
 					pCmdlist->GetLatestCommandList()->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
 				}
 				pDevice->PendingKill(new ReleaseObjectItem<ID3D12Resource>(pSrcImage));
+			}
 
-				pCmdlist->TransitionBarrier(pTexture, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ);
+			void LoadBarrier(CommandList* pCmdlist) override
+			{
+				pCmdlist->AddTransitionBarrier(pTexture, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ);
+			}
+
+			RenderCommandPhase::Type GetPhase() const override
+			{
+				return RenderCommandPhase::Copy;
 			}
 		};	// struct TailMipInitRenderCommand
 
@@ -332,6 +340,26 @@ namespace sl12
 		}
 	}
 
+	//--------
+	u64 ResourceItemStreamingTexture::GetGpuMemorySize() const
+	{
+		// tail heap and allocated tiles.
+		u64 ret = 0;
+		if (tailHeap_)
+		{
+			ret += tailHeap_->GetDesc().SizeInBytes;
+		}
+		for (size_t i = 0; i < heapHandles_.size() && i < standardTiles_.size(); i++)
+		{
+			if (heapHandles_[i].IsValid())
+			{
+				auto&& tiles = standardTiles_[i];
+				ret += (u64)tiles.WidthInTiles * tiles.HeightInTiles * tiles.DepthInTiles * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+			}
+		}
+		return ret;
+	}
+
 	//--------
 	ResourceItemBase* ResourceItemStreamingTexture::LoadFunction(ResourceLoader* pLoader, ResourceHandle handle, const std::string& filepath)
 	{
@@ -340,8 +368,8 @@ namespace sl12
 		std::unique_ptr<ResourceItemStreamingTexture> ret(new ResourceItemStreamingTexture(handle));
 
 		// load file.
-		std::unique_ptr<File> texBin = std::make_unique<File>();
-		if (!texBin->ReadFile(pLoader->MakeFullPath(filepath).c_str()))
+		std::unique_ptr<File> texBin = pLoader->OpenFile(filepath);
+		if (!texBin)
 		{
 			return nullptr;
 		}
@@ -590,12 +618,11 @@ namespace sl12
 				// file read.
 				for (u32 i = 0; i < command->texBins.size(); i++)
 				{
-					auto file = std::make_unique<File>();
 					u32 index = nextMiplevel + i;
 					std::string index_str = std::to_string(index);
 					index_str = std::string(std::max(0, 2 - (int)index_str.size()), '0') + index_str;
-					std::string filepath = pSTex->fullPath_ + index_str;
-					if (!file->ReadFile(filepath.c_str()))
+					auto file = pSTex->pParentLoader_->OpenFile(pSTex->filePath_ + index_str);
+					if (!file)
 					{
 						return false;
 					}
@@ -658,6 +685,9 @@ namespace sl12
 		pSTex->nextTextureView_ = std::move(nextTexView);
 		pSTex->currMiplevel_ = nextMiplevel;
 
+		// tiles are allocated or released.
+		pSTex->pParentLoader_->UpdateMemorySize(pSTex->GetHandle());
+
 		return true;
 	}
 
@@ -17,6 +17,7 @@ namespace sl12
 			std::unique_ptr<DirectX::ScratchImage>	image;
 			Device*									pDevice;
 			Texture*								pTexture;
+			bool									isLoaded = false;
 
 			~TexInitRenderCommand()
 			{
@@ -30,8 +31,20 @@ namespace sl12
 					return;
 				}
 				pDevice->PendingKill(new ReleaseObjectItem<ID3D12Resource>(pSrcImage));
+				isLoaded = true;
+			}
 
-				pCmdlist->TransitionBarrier(pTexture, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ);
+			void LoadBarrier(CommandList* pCmdlist) override
+			{
+				if (isLoaded)
+				{
+					pCmdlist->AddTransitionBarrier(pTexture, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ);
+				}
+			}
+
+			RenderCommandPhase::Type GetPhase() const override
+			{
+				return RenderCommandPhase::Copy;
 			}
 		};	// struct TexInitRenderCommand
 	}
@@ -43,6 +56,19 @@ namespace sl12
 		texture_.Destroy();
 	}
 
+	//----------------
+	u64 ResourceItemTexture::GetGpuMemorySize() const
+	{
+		auto pLoader = GetHandle().GetLoader();
+		auto desc = texture_.GetResourceDesc();
+		if (!pLoader || desc.Width == 0)
+		{
+			return 0;
+		}
+		auto info = pLoader->GetDevice()->GetDeviceDep()->GetResourceAllocationInfo(0, 1, &desc);
+		return info.SizeInBytes;
+	}
+
 	//----------------
 	ResourceItemBase* ResourceItemTexture::LoadFunction(ResourceLoader* pLoader, ResourceHandle handle, const std::string& filepath)
 	{
@@ -59,8 +85,8 @@ namespace sl12
 		}
 
 		// load file.
-		File texBin;
-		if (!texBin.ReadFile(pLoader->MakeFullPath(filepath).c_str()))
+		std::unique_ptr<File> texBin = pLoader->OpenFile(filepath);
+		if (!texBin)
 		{
 			return nullptr;
 		}
@@ -76,23 +102,23 @@ namespace sl12
 		std::unique_ptr<DirectX::ScratchImage> image;
 		if (ext == ".png")
 		{
-			image = ret->texture_.InitializeFromPNGwoLoad(device, texBin.GetData(), texBin.GetSize(), 0);
+			image = ret->texture_.InitializeFromPNGwoLoad(device, texBin->GetData(), texBin->GetSize(), 0);
 		}
 		else if (ext == ".dds")
 		{
-			image = ret->texture_.InitializeFromDDSwoLoad(device, texBin.GetData(), texBin.GetSize(), 0);
+			image = ret->texture_.InitializeFromDDSwoLoad(device, texBin->GetData(), texBin->GetSize(), 0);
 		}
 		else if (ext == ".tga")
 		{
-			image = ret->texture_.InitializeFromTGAwoLoad(device, texBin.GetData(), texBin.GetSize(), 0);
+			image = ret->texture_.InitializeFromTGAwoLoad(device, texBin->GetData(), texBin->GetSize(), 0);
 		}
 		else if (ext == ".exr")
 		{
-			image = ret->texture_.InitializeFromEXRwoLoad(device, texBin.GetData(), texBin.GetSize(), 0);
+			image = ret->texture_.InitializeFromEXRwoLoad(device, texBin->GetData(), texBin->GetSize(), 0);
 		}
 		else if (ext == ".hdr")
 		{
-			image = ret->texture_.InitializeFromHDRwoLoad(device, texBin.GetData(), texBin.GetSize(), 0);
+			image = ret->texture_.InitializeFromHDRwoLoad(device, texBin->GetData(), texBin->GetSize(), 0);
 		}
 		if (image.get() == nullptr)
 		{
@@ -10,13 +10,11 @@ namespace sl12
 	//----
 	CopyRingBuffer::CopyRingBuffer(Device* pDev)
 		: pParentDevice_(pDev)
+		, offsetAllocator_(64 * 1024)		// init 64KB
 	{
-		head_ = tail_ = prevHead_ = 0;
-		size_ = 64 * 1024;		// init 64KB
-
 		pCopySource_ = new Buffer();
 		BufferDesc creationDesc{};
-		creationDesc.size = size_;
+		creationDesc.size = offsetAllocator_.GetSize();
 		creationDesc.usage = ResourceUsage::ConstantBuffer;
 		creationDesc.heap = BufferHeap::Dynamic;
 		creationDesc.initialState = D3D12_RESOURCE_STATE_GENERIC_READ;
@@ -38,41 +36,32 @@ namespace sl12
 	// need to call when frame begin.
 	void CopyRingBuffer::BeginNewFrame()
 	{
-		prevHead_ = head_;
-		head_ = tail_;
+		std::unique_lock<std::mutex> lock(mutex_);
+		offsetAllocator_.BeginNewFrame();
 	}
 
 	//----
 	// only copy data to ring buffer.
 	CopyRingBuffer::Result CopyRingBuffer::CopyToRing(const void* pData, u32 size)
 	{
-		static const u32 kWaterMark = 16;
 		Result result;
 
 		std::unique_lock<std::mutex> lock(mutex_);
-		if ((tail_ >= head_) && (size > size_ - tail_))
-		{
-			tail_ = 0;
-		}
-		if ((tail_ < head_) && (head_ < tail_ + size + kWaterMark))
+		u32 newSize;
+		u32 offset = offsetAllocator_.Allocate(size, newSize);
+		if (newSize > 0)
 		{
 			// create new ring buffer.
 			BufferDesc newDesc = pCopySource_->GetBufferDesc();
 			pParentDevice_->KillObject(pCopySource_);
 			pCopySource_ = new Buffer();
-			do
-			{
-				size_ *= 2;
-			} while(size_ < size);
-			newDesc.size = size_;
+			newDesc.size = newSize;
 			bool bSuccess = pCopySource_->Initialize(pParentDevice_, newDesc);
 			assert(bSuccess);
-
-			prevHead_ = head_ = tail_ = 0;
 		}
 
 		result.pBuffer = pCopySource_;
-		result.offset = tail_;
+		result.offset = offset;
 		result.size = size;
 
 		D3D12_RANGE range;
@@ -83,8 +72,6 @@ namespace sl12
 		memcpy(p, pData, size);
 		pCopySource_->Unmap(range);
 
-		tail_ += size;
-
 		return result;
 	}
 
@@ -0,0 +1,41 @@
+﻿#include <sl12/ring_offset_allocator.h>
+
+
+namespace sl12
+{
+	//----
+	u32 RingOffsetAllocator::Allocate(u32 size, u32& outNewSize)
+	{
+		outNewSize = 0;
+
+		bool isWrapped = false;
+		if ((tail_ >= head_) && (size > size_ - tail_))
+		{
+			tail_ = 0;
+			isWrapped = true;
+		}
+
+		// grow if request is larger than ring, or catches up with data of current frame.
+		// when current frame starts at 0, wrapped range overwrites it.
+		if ((size_ < size + kWaterMark)
+			|| (isWrapped && head_ == 0)
+			|| ((tail_ < head_) && (head_ < tail_ + size + kWaterMark)))
+		{
+			do
+			{
+				size_ *= 2;
+			} while (size_ < size + kWaterMark);
+			outNewSize = size_;
+
+			head_ = tail_ = 0;
+		}
+
+		u32 ret = tail_;
+		tail_ += size;
+		return ret;
+	}
+
+}	// namespace sl12
+
+
+//	EOF
@@ -2,6 +2,10 @@
 
 #include "sl12/device.h"
 #include "sl12/command_list.h"
+#include "sl12/upload_batcher.h"
+
+#include <algorithm>
+#include <cfloat>
 
 
 namespace sl12
@@ -24,6 +28,36 @@ namespace sl12
 			sl12::u32	indexCount;
 			sl12::u32	pad[2];
 		};	// struct MeshletDrawInfo
+
+		float GetMaxScale(const DirectX::XMMATRIX& mtx)
+		{
+			return std::max(std::max(
+				DirectX::XMVectorGetX(DirectX::XMVector3Length(mtx.r[0])),
+				DirectX::XMVectorGetX(DirectX::XMVector3Length(mtx.r[1]))),
+				DirectX::XMVectorGetX(DirectX::XMVector3Length(mtx.r[2])));
+		}
+
+		// project object space error of the sphere to pixels.
+		// camera inside of the sphere returns FLT_MAX unless error is zero.
+		float ProjectError(const DirectX::XMMATRIX& mtx, float scale, const DirectX::XMFLOAT3& center, float radius, float error, const DirectX::XMFLOAT3& cameraPos, float projScale)
+		{
+			if (error <= 0.0f)
+			{
+				return 0.0f;
+			}
+			if (error >= FLT_MAX)
+			{
+				return FLT_MAX;
+			}
+			DirectX::XMVECTOR c = DirectX::XMVector3Transform(DirectX::XMLoadFloat3(&center), mtx);
+			float distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(c, DirectX::XMLoadFloat3(&cameraPos))));
+			distance -= radius * scale;
+			if (distance <= 0.0f)
+			{
+				return FLT_MAX;
+			}
+			return error * scale * projScale / distance;
+		}
 	}
 
 
@@ -151,6 +185,7 @@ namespace sl12
 		// count total meshlets.
 		auto&& submeshes = pSrcMesh->GetSubmeshes();
 		u32 submesh_count = (u32)submeshes.size();
+		lodIndices_.resize(submesh_count, 0);
 		u32 total_meshlets_count = 0;
 		for (auto&& submesh : submeshes)
 		{
@@ -335,14 +370,86 @@ namespace sl12
 	{
 		if (!updateMaterials_.empty())
 		{
-			pCmdList->TransitionBarrier(pMaterialCB_, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_COPY_DEST);
+			// copy whole aligned block so that adjacent materials are merged to one copy command.
+			u32 matDataSize = (sizeof(MeshMaterialData) + D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1) / D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT * D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+			std::vector<u8> block(matDataSize);
+
+			UploadBatcher batcher(pParentDevice_->GetCopyRingBuffer());
 			for (auto&& data : updateMaterials_)
 			{
-				u32 matDataSize = (sizeof(MeshMaterialData) + D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1) / D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT * D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
-				pParentDevice_->CopyToBuffer(pCmdList, pMaterialCB_, data.first * matDataSize, &data.second, sizeof(data.second));
+				memcpy(block.data(), &data.second, sizeof(data.second));
+				batcher.RequestCopy(pMaterialCB_, data.first * matDataSize, block.data(), matDataSize);
 			}
 			updateMaterials_.clear();
-			pCmdList->TransitionBarrier(pMaterialCB_, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ);
+			batcher.Flush(pCmdList);
+		}
+	}
+
+	//----
+	u32 SceneMesh::SelectLod(u32 submeshIndex, const DirectX::XMFLOAT3& cameraPos, float projScale, float thresholdPixels) const
+	{
+		auto&& submeshes = pParentResource_->GetSubmeshes();
+		if (submeshIndex >= submeshes.size())
+		{
+			return 0;
+		}
+		auto&& submesh = submeshes[submeshIndex];
+		if (submesh.lods.size() <= 1)
+		{
+			return 0;
+		}
+
+		DirectX::XMMATRIX mtx = DirectX::XMLoadFloat4x4(&mtxLocalToWorld_);
+		float scale = GetMaxScale(mtx);
+
+		// errors increase with lod level.
+		u32 ret = 0;
+		for (u32 i = 1; i < (u32)submesh.lods.size(); i++)
+		{
+			float pixels = ProjectError(mtx, scale, submesh.boundingInfo.sphere.center, submesh.boundingInfo.sphere.radius, submesh.lods[i].error, cameraPos, projScale);
+			if (pixels > thresholdPixels)
+			{
+				break;
+			}
+			ret = i;
+		}
+		return ret;
+	}
+
+	//----
+	void SceneMesh::UpdateLod(const DirectX::XMFLOAT3& cameraPos, float projScale, float thresholdPixels)
+	{
+		for (u32 i = 0; i < (u32)lodIndices_.size(); i++)
+		{
+			lodIndices_[i] = SelectLod(i, cameraPos, projScale, thresholdPixels);
+		}
+	}
+
+	//----
+	void SceneMesh::SelectClusterCut(u32 submeshIndex, const DirectX::XMFLOAT3& cameraPos, float projScale, float thresholdPixels, std::vector<u32>& outClusters) const
+	{
+		outClusters.clear();
+		auto&& submeshes = pParentResource_->GetSubmeshes();
+		if (submeshIndex >= submeshes.size())
+		{
+			return;
+		}
+
+		DirectX::XMMATRIX mtx = DirectX::XMLoadFloat4x4(&mtxLocalToWorld_);
+		float scale = GetMaxScale(mtx);
+
+		// lod bounds of a cluster equal to parent lod bounds of its children,
+		// so each cluster can be tested independently and the result is a consistent cut.
+		auto&& clusters = submeshes[submeshIndex].clusters;
+		for (u32 i = 0; i < (u32)clusters.size(); i++)
+		{
+			auto&& c = clusters[i];
+			float selfPixels = ProjectError(mtx, scale, c.lod.center, c.lod.radius, c.lod.error, cameraPos, projScale);
+			float parentPixels = ProjectError(mtx, scale, c.parentLod.center, c.parentLod.radius, c.parentLod.error, cameraPos, projScale);
+			if (selfPixels <= thresholdPixels && parentPixels > thresholdPixels)
+			{
+				outClusters.push_back(i);
+			}
 		}
 	}
 
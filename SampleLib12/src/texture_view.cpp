@@ -128,12 +128,24 @@ namespace sl12
 			}
 		}
 
+		// register to bindless registry.
+		pBindless_ = pDev->GetBindlessRegistry();
+		if (pBindless_)
+		{
+			bindlessHandle_ = pBindless_->Register(descInfo_.cpuHandle);
+		}
+
 		return true;
 	}
 
 	//----
 	void TextureView::Destroy()
 	{
+		if (pBindless_)
+		{
+			pBindless_->Unregister(bindlessHandle_);
+			pBindless_ = nullptr;
+		}
 		descInfo_.Free();
 		dynamicDescInfo_.Free();
 	}
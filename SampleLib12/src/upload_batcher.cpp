@@ -0,0 +1,208 @@
+﻿#include <sl12/upload_batcher.h>
+
+#include <sl12/ring_buffer.h>
+#include <sl12/command_list.h>
+#include <sl12/buffer.h>
+
+#include <algorithm>
+
+
+namespace sl12
+{
+	//----
+	UploadBatcher::UploadBatcher(CopyRingBuffer* pRing)
+		: pRingBuffer_(pRing)
+	{
+		assert(pRingBuffer_ != nullptr);
+	}
+
+	//----
+	UploadBatcher::~UploadBatcher()
+	{
+		Clear();
+	}
+
+	//----
+	// store copy request. data is copied immediately.
+	void UploadBatcher::RequestCopy(Buffer* pDstBuffer, u32 dstOffset, const void* pData, u32 size)
+	{
+		if (!pDstBuffer || !pData || !size)
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		CopyRequest req;
+		req.pDstBuffer = pDstBuffer;
+		req.dstOffset = dstOffset;
+		req.size = size;
+		req.dataOffset = (u32)data_.size();
+		req.order = (u32)requests_.size();
+		requests_.push_back(req);
+
+		data_.resize(data_.size() + size);
+		memcpy(data_.data() + req.dataOffset, pData, size);
+	}
+
+	//----
+	// sort and merge requests, and load dma copy commands.
+	void UploadBatcher::Flush(CommandList* pCmdList, bool bTransition)
+	{
+		struct Run
+		{
+			Buffer*		pDstBuffer;
+			u32			dstOffset;
+			u32			size;
+			u32			srcOffset;
+			size_t		first;
+			size_t		last;
+			bool		hasOverlap;
+		};	// struct Run
+
+		std::vector<CopyRequest> requests;
+		std::vector<u8> data;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			requests.swap(requests_);
+			data.swap(data_);
+		}
+
+		lastStats_ = Stats();
+		if (requests.empty())
+		{
+			return;
+		}
+
+		// sort by destination. same range keeps request order.
+		std::sort(requests.begin(), requests.end(),
+			[](const CopyRequest& l, const CopyRequest& r)
+			{
+				if (l.pDstBuffer != r.pDstBuffer) return l.pDstBuffer < r.pDstBuffer;
+				if (l.dstOffset != r.dstOffset) return l.dstOffset < r.dstOffset;
+				return l.order < r.order;
+			});
+
+		// merge contiguous and overlapped ranges.
+		std::vector<Run> runs;
+		runs.reserve(requests.size());
+		u32 totalSize = 0;
+		for (size_t i = 0; i < requests.size(); i++)
+		{
+			auto&& req = requests[i];
+			lastStats_.requestBytes += req.size;
+
+			if (!runs.empty())
+			{
+				auto&& run = runs.back();
+				u32 runEnd = run.dstOffset + run.size;
+				if (run.pDstBuffer == req.pDstBuffer && req.dstOffset <= runEnd)
+				{
+					u32 reqEnd = req.dstOffset + req.size;
+					run.hasOverlap = run.hasOverlap || (req.dstOffset < runEnd);
+					if (reqEnd > runEnd)
+					{
+						totalSize += reqEnd - runEnd;
+						run.size = reqEnd - run.dstOffset;
+					}
+					run.last = i + 1;
+					continue;
+				}
+			}
+
+			Run run;
+			run.pDstBuffer = req.pDstBuffer;
+			run.dstOffset = req.dstOffset;
+			run.size = req.size;
+			run.srcOffset = totalSize;
+			run.first = i;
+			run.last = i + 1;
+			run.hasOverlap = false;
+			runs.push_back(run);
+			totalSize += req.size;
+		}
+
+		// gather merged data.
+		mergedData_.resize(totalSize);
+		for (auto&& run : runs)
+		{
+			if (run.hasOverlap)
+			{
+				// later request wins.
+				std::sort(requests.begin() + run.first, requests.begin() + run.last,
+					[](const CopyRequest& l, const CopyRequest& r) { return l.order < r.order; });
+			}
+			for (size_t i = run.first; i < run.last; i++)
+			{
+				auto&& req = requests[i];
+				memcpy(mergedData_.data() + run.srcOffset + (req.dstOffset - run.dstOffset), data.data() + req.dataOffset, req.size);
+			}
+		}
+
+		// upload once to ring buffer.
+		auto src = pRingBuffer_->CopyToRing(mergedData_.data(), totalSize);
+
+		if (bTransition)
+		{
+			Buffer* prev = nullptr;
+			for (auto&& run : runs)
+			{
+				if (prev != run.pDstBuffer)
+				{
+					prev = run.pDstBuffer;
+					pCmdList->AddTransitionBarrier(prev, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_COPY_DEST);
+				}
+			}
+			pCmdList->FlushBarriers();
+		}
+
+		for (auto&& run : runs)
+		{
+			pCmdList->GetLatestCommandList()->CopyBufferRegion(
+				run.pDstBuffer->GetResourceDep(), run.dstOffset,
+				src.pBuffer->GetResourceDep(), src.offset + run.srcOffset, run.size);
+		}
+
+		if (bTransition)
+		{
+			Buffer* prev = nullptr;
+			for (auto&& run : runs)
+			{
+				if (prev != run.pDstBuffer)
+				{
+					prev = run.pDstBuffer;
+					pCmdList->AddTransitionBarrier(prev, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ);
+				}
+			}
+			pCmdList->FlushBarriers();
+		}
+
+		lastStats_.requestCount = (u32)requests.size();
+		lastStats_.commandCount = (u32)runs.size();
+		lastStats_.uploadBytes = totalSize;
+
+		// reuse capacity.
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (requests_.empty())
+			{
+				requests.clear();
+				data.clear();
+				requests_.swap(requests);
+				data_.swap(data);
+			}
+		}
+	}
+
+	//----
+	// discard all requests.
+	void UploadBatcher::Clear()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		requests_.clear();
+		data_.clear();
+	}
+
+}	// namespace sl12
+
+//	EOF
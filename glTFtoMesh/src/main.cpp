@@ -18,6 +18,7 @@
 #include "utils.h"
 #include "mesh_work.h"
 #include "texture_convert.h"
+#include "mesh_writer.h"
 
 #define NOMINMAX
 #include <windows.h>
@@ -39,6 +40,14 @@ struct ToolOptions
 	bool			meshletFlag = false;
 	int				meshletMaxVertices = 64;
 	int				meshletMaxTriangles = 126;
+	int				meshVersion = 2;
+	int				compression = 0;
+	int				lodCount = 0;
+	float			lodRatio = 0.5f;
+	float			lodError = 0.01f;
+	bool			lodSloppy = false;
+	bool			clusterDagFlag = false;
+	int				clusterGroupSize = 4;
 };	// struct ToolOptions
 
 void DisplayHelp()
@@ -56,11 +65,48 @@ void DisplayHelp()
 	fprintf(stdout, "    -let <0/1>      : create meshlets. (default: 0)\n");
 	fprintf(stdout, "    -letvert <int>  : meshlet max vertices. (default: 64)\n");
 	fprintf(stdout, "    -lettri <int>   : meshlet max triangles. (default: 126)\n");
+	fprintf(stdout, "    -ver <1/2>      : rmesh format version. 2 is loaded without deserialization. (default: 2)\n");
+	fprintf(stdout, "    -comp <0/1/2>   : compress v2 streams. 1 is lossless, 2 also uses octahedral filter for normal and tangent. (default: 0)\n");
+	fprintf(stdout, "    -lod <int>      : max lod count except LOD0. lods are stored in v2 only. (default: 0)\n");
+	fprintf(stdout, "    -lodratio <f>   : triangle ratio of each lod to previous lod. (default: 0.5)\n");
+	fprintf(stdout, "    -loderr <f>     : max simplification error of each lod relative to mesh extents. (default: 0.01)\n");
+	fprintf(stdout, "    -lodsloppy <0/1>: use sloppy simplification if topology preserving one cannot reduce. (default: 0)\n");
+	fprintf(stdout, "    -dag <0/1>      : build cluster dag for continuous lod. cluster size is same as meshlet. stored in v2 only. (default: 0)\n");
+	fprintf(stdout, "    -daggroup <int> : cluster count of a group simplified together. (default: 4)\n");
 	fprintf(stdout, "\n");
 	fprintf(stdout, "example:\n");
 	fprintf(stdout, "    glTFtoMesh.exe -i \"D:/input/sample.glb\" -o \"D:/output/sample.rmesh\" -to \"D:/output/textures/\" -let 1\n");
 }
 
+sl12::ResourceMeshMeshlet ConvertMeshlet(const Meshlet& meshlet)
+{
+	sl12::ResourceMeshMeshlet m;
+	m.indexOffset_ = meshlet.indexOffset;
+	m.indexCount_ = meshlet.indexCount;
+	m.primitiveOffset_ = meshlet.primitiveOffset;
+	m.primitiveCount_ = meshlet.primitiveCount;
+	m.vertexIndexOffset_ = meshlet.vertexIndexOffset;
+	m.vertexIndexCount_ = meshlet.vertexIndexCount;
+	m.boundingSphere_.centerX = meshlet.boundingSphere.center.x;
+	m.boundingSphere_.centerY = meshlet.boundingSphere.center.y;
+	m.boundingSphere_.centerZ = meshlet.boundingSphere.center.z;
+	m.boundingSphere_.radius = meshlet.boundingSphere.radius;
+	m.boundingBox_.minX = meshlet.boundingBox.aabbMin.x;
+	m.boundingBox_.minY = meshlet.boundingBox.aabbMin.y;
+	m.boundingBox_.minZ = meshlet.boundingBox.aabbMin.z;
+	m.boundingBox_.maxX = meshlet.boundingBox.aabbMax.x;
+	m.boundingBox_.maxY = meshlet.boundingBox.aabbMax.y;
+	m.boundingBox_.maxZ = meshlet.boundingBox.aabbMax.z;
+	m.cone_.apexX = meshlet.cone.apex.x;
+	m.cone_.apexY = meshlet.cone.apex.y;
+	m.cone_.apexZ = meshlet.cone.apex.z;
+	m.cone_.axisX = meshlet.cone.axis.x;
+	m.cone_.axisY = meshlet.cone.axis.y;
+	m.cone_.axisZ = meshlet.cone.axis.z;
+	m.cone_.cutoff = meshlet.cone.cutoff;
+	return m;
+}
+
 int main(int argv, char* argc[])
 {
 	if (argv == 1)
@@ -187,6 +233,78 @@ int main(int argv, char* argc[])
 				}
 				options.meshletMaxTriangles = std::stoi(argc[++i]);
 			}
+			else if (op == "-ver" || op == "/ver")
+			{
+				if (i == argv - 1)
+				{
+					fprintf(stderr, "invalid argument. (%s)\n", op.c_str());
+					return -1;
+				}
+				options.meshVersion = std::stoi(argc[++i]);
+			}
+			else if (op == "-comp" || op == "/comp")
+			{
+				if (i == argv - 1)
+				{
+					fprintf(stderr, "invalid argument. (%s)\n", op.c_str());
+					return -1;
+				}
+				options.compression = std::stoi(argc[++i]);
+			}
+			else if (op == "-lod" || op == "/lod")
+			{
+				if (i == argv - 1)
+				{
+					fprintf(stderr, "invalid argument. (%s)\n", op.c_str());
+					return -1;
+				}
+				options.lodCount = std::stoi(argc[++i]);
+			}
+			else if (op == "-lodratio" || op == "/lodratio")
+			{
+				if (i == argv - 1)
+				{
+					fprintf(stderr, "invalid argument. (%s)\n", op.c_str());
+					return -1;
+				}
+				options.lodRatio = std::stof(argc[++i]);
+			}
+			else if (op == "-loderr" || op == "/loderr")
+			{
+				if (i == argv - 1)
+				{
+					fprintf(stderr, "invalid argument. (%s)\n", op.c_str());
+					return -1;
+				}
+				options.lodError = std::stof(argc[++i]);
+			}
+			else if (op == "-lodsloppy" || op == "/lodsloppy")
+			{
+				if (i == argv - 1)
+				{
+					fprintf(stderr, "invalid argument. (%s)\n", op.c_str());
+					return -1;
+				}
+				options.lodSloppy = std::stoi(argc[++i]) != 0;
+			}
+			else if (op == "-dag" || op == "/dag")
+			{
+				if (i == argv - 1)
+				{
+					fprintf(stderr, "invalid argument. (%s)\n", op.c_str());
+					return -1;
+				}
+				options.clusterDagFlag = std::stoi(argc[++i]) != 0;
+			}
+			else if (op == "-daggroup" || op == "/daggroup")
+			{
+				if (i == argv - 1)
+				{
+					fprintf(stderr, "invalid argument. (%s)\n", op.c_str());
+					return -1;
+				}
+				options.clusterGroupSize = std::stoi(argc[++i]);
+			}
 			else
 			{
 				fprintf(stderr, "invalid argument. (%s)\n", op.c_str());
@@ -259,6 +377,42 @@ int main(int argv, char* argc[])
 		mesh_work->BuildMeshlets(options.meshletMaxVertices, options.meshletMaxTriangles);
 	}
 
+	if (options.lodCount > 0)
+	{
+		if (options.meshVersion == 1)
+		{
+			fprintf(stdout, "lods are not supported in rmesh v1. skip.\n");
+		}
+		else if (options.lodRatio <= 0.0f || options.lodRatio >= 1.0f)
+		{
+			fprintf(stderr, "invalid lod ratio. (%f)\n", options.lodRatio);
+			return -1;
+		}
+		else
+		{
+			fprintf(stdout, "build lods.\n");
+			mesh_work->BuildLods(options.lodCount, options.lodRatio, options.lodError, options.lodSloppy);
+		}
+	}
+
+	if (options.clusterDagFlag)
+	{
+		if (options.meshVersion == 1)
+		{
+			fprintf(stdout, "cluster dag is not supported in rmesh v1. skip.\n");
+		}
+		else if (options.clusterGroupSize < 2)
+		{
+			fprintf(stderr, "invalid cluster group size. (%d)\n", options.clusterGroupSize);
+			return -1;
+		}
+		else
+		{
+			fprintf(stdout, "build cluster dag.\n");
+			mesh_work->BuildClusterDag(options.meshletMaxVertices, options.meshletMaxTriangles, options.clusterGroupSize);
+		}
+	}
+
 	// output textures.
 	if (options.streamingTex > 0)
 	{
@@ -473,6 +627,57 @@ int main(int argv, char* argc[])
 		pb_offset += out_sub.meshletPrimitiveCount_;
 		vib_offset += out_sub.meshletVertexIndexCount_;
 
+		// lod indices follow LOD0 indices, and refer same vertices.
+		for (auto&& lod : submesh->GetLods())
+		{
+			sl12::ResourceMeshLod out_lod;
+			out_lod.indexOffset = ib_offset;
+			out_lod.indexCount = (uint32_t)lod.indexBuffer.size();
+			out_lod.error = lod.error;
+			CopyBuffer(out_resource->indexBuffer_, lod.indexBuffer.data(), sizeof(uint32_t) * lod.indexBuffer.size());
+			ib_offset += out_lod.indexCount;
+			out_sub.lods_.push_back(out_lod);
+		}
+
+		// cluster data follows lods. offsets are relative to submesh same as meshlets.
+		{
+			auto&& src_cib = submesh->GetClusterIndexBuffer();
+			auto&& src_cpb = submesh->GetClusterPackedPrimitive();
+			auto&& src_cvib = submesh->GetClusterVertexIndexBuffer();
+			uint32_t cib_base = ib_offset - out_sub.indexOffset_;
+			uint32_t cpb_base = pb_offset - out_sub.meshletPrimitiveOffset_;
+			uint32_t cvib_base = vib_offset - out_sub.meshletVertexIndexOffset_;
+			CopyBuffer(out_resource->indexBuffer_, src_cib.data(), sizeof(uint32_t) * src_cib.size());
+			CopyBuffer(out_resource->meshletPackedPrimitive_, src_cpb.data(), sizeof(uint32_t) * src_cpb.size());
+			CopyBuffer(out_resource->meshletVertexIndex_, src_cvib.data(), sizeof(uint32_t) * src_cvib.size());
+			ib_offset += (uint32_t)src_cib.size();
+			pb_offset += (uint32_t)src_cpb.size();
+			vib_offset += (uint32_t)src_cvib.size();
+
+			auto ConvLod = [](const ClusterLodWork& src)
+			{
+				sl12::ResourceMeshClusterLod ret;
+				ret.sphere.centerX = src.sphere.center.x;
+				ret.sphere.centerY = src.sphere.center.y;
+				ret.sphere.centerZ = src.sphere.center.z;
+				ret.sphere.radius = src.sphere.radius;
+				ret.error = src.error;
+				return ret;
+			};
+			for (auto&& cluster : submesh->GetClusters())
+			{
+				sl12::ResourceMeshCluster c;
+				c.meshlet = ConvertMeshlet(cluster.meshlet);
+				c.meshlet.indexOffset_ += cib_base;
+				c.meshlet.primitiveOffset_ += cpb_base;
+				c.meshlet.vertexIndexOffset_ += cvib_base;
+				c.level = cluster.level;
+				c.lod = ConvLod(cluster.lod);
+				c.parentLod = ConvLod(cluster.parentLod);
+				out_sub.clusters_.push_back(c);
+			}
+		}
+
 		out_sub.boundingSphere_.centerX = submesh->GetBoundingSphere().center.x;
 		out_sub.boundingSphere_.centerY = submesh->GetBoundingSphere().center.y;
 		out_sub.boundingSphere_.centerZ = submesh->GetBoundingSphere().center.z;
@@ -486,40 +691,19 @@ int main(int argv, char* argc[])
 
 		for (auto&& meshlet : submesh->GetMeshlets())
 		{
-			sl12::ResourceMeshMeshlet m;
-			m.indexOffset_ = meshlet.indexOffset;
-			m.indexCount_ = meshlet.indexCount;
-			m.primitiveOffset_ = meshlet.primitiveOffset;
-			m.primitiveCount_ = meshlet.primitiveCount;
-			m.vertexIndexOffset_ = meshlet.vertexIndexOffset;
-			m.vertexIndexCount_ = meshlet.vertexIndexCount;
-			m.boundingSphere_.centerX = meshlet.boundingSphere.center.x;
-			m.boundingSphere_.centerY = meshlet.boundingSphere.center.y;
-			m.boundingSphere_.centerZ = meshlet.boundingSphere.center.z;
-			m.boundingSphere_.radius = meshlet.boundingSphere.radius;
-			m.boundingBox_.minX = meshlet.boundingBox.aabbMin.x;
-			m.boundingBox_.minY = meshlet.boundingBox.aabbMin.y;
-			m.boundingBox_.minZ = meshlet.boundingBox.aabbMin.z;
-			m.boundingBox_.maxX = meshlet.boundingBox.aabbMax.x;
-			m.boundingBox_.maxY = meshlet.boundingBox.aabbMax.y;
-			m.boundingBox_.maxZ = meshlet.boundingBox.aabbMax.z;
-			m.cone_.apexX = meshlet.cone.apex.x;
-			m.cone_.apexY = meshlet.cone.apex.y;
-			m.cone_.apexZ = meshlet.cone.apex.z;
-			m.cone_.axisX = meshlet.cone.axis.x;
-			m.cone_.axisY = meshlet.cone.axis.y;
-			m.cone_.axisZ = meshlet.cone.axis.z;
-			m.cone_.cutoff = meshlet.cone.cutoff;
-			out_sub.meshlets_.push_back(m);
+			out_sub.meshlets_.push_back(ConvertMeshlet(meshlet));
 		}
 
 		out_resource->submeshes_.push_back(out_sub);
 	}
 
+	bool writeResult = (options.meshVersion == 1)
+		? WriteMeshV1(*out_resource, options.outputFilePath)
+		: WriteMeshV2(*out_resource, options.outputFilePath, options.compression);
+	if (!writeResult)
 	{
-		std::fstream ofs(options.outputFilePath, std::ios::out | std::ios::binary);
-		cereal::BinaryOutputArchive ar(ofs);
-		ar(cereal::make_nvp("mesh", *out_resource));
+		fprintf(stderr, "failed to write rmesh binary. (%s)\n", options.outputFilePath.c_str());
+		return -1;
 	}
 
 	fprintf(stdout, "convert succeeded!!.\n");
@@ -4,6 +4,7 @@
 #include <fstream>
 #include <map>
 #include <cstdio>
+#include <cfloat>
 
 #define TINYGLTF_IMPLEMENTATION
 #define TINYGLTF_USE_RAPIDJSON
@@ -831,6 +832,68 @@ namespace
 		return meshopt_computeClusterBounds(indices.data(), meshlet->triangle_count * 3, vertex_positions, vertex_count, vertex_positions_stride);
 	}
 
+	// append meshlet to buffers, and compute bounds.
+	Meshlet AppendMeshlet(const modify_Meshlet& meshlet, const std::vector<Vertex>& vertexBuffer, std::vector<uint32_t>& indexBuffer, std::vector<uint32_t>& packedPrimitive, std::vector<uint32_t>& vertexIndexBuffer)
+	{
+		std::vector<Vertex> this_vtx;
+
+		// copy indices.
+		Meshlet work;
+		work.indexOffset = (uint32_t)indexBuffer.size();
+		work.indexCount = meshlet.triangle_count * 3;
+		work.primitiveOffset = (uint32_t)packedPrimitive.size();
+		work.primitiveCount = meshlet.triangle_count;
+		work.vertexIndexOffset = (uint32_t)vertexIndexBuffer.size();
+		work.vertexIndexCount = meshlet.vertex_count;
+		for (uint32_t i = 0; i < meshlet.triangle_count; i++)
+		{
+			uint32_t i0 = meshlet.indices[i * 3 + 0];
+			uint32_t i1 = meshlet.indices[i * 3 + 1];
+			uint32_t i2 = meshlet.indices[i * 3 + 2];
+
+			indexBuffer.push_back(meshlet.vertices[i0]);
+			indexBuffer.push_back(meshlet.vertices[i1]);
+			indexBuffer.push_back(meshlet.vertices[i2]);
+
+			packedPrimitive.push_back((i2 << 20) | (i1 << 10) | i0);
+
+			this_vtx.push_back(vertexBuffer[meshlet.vertices[i0]]);
+			this_vtx.push_back(vertexBuffer[meshlet.vertices[i1]]);
+			this_vtx.push_back(vertexBuffer[meshlet.vertices[i2]]);
+		}
+		for (uint32_t i = 0; i < meshlet.vertex_count; i++)
+		{
+			vertexIndexBuffer.push_back(meshlet.vertices[i]);
+		}
+
+		// compute bounds.
+		auto bounds = modify_computeMeshletBounds(&meshlet, &vertexBuffer[0].pos.x, vertexBuffer.size(), sizeof(Vertex));
+		work.boundingSphere.center.x = bounds.center[0];
+		work.boundingSphere.center.y = bounds.center[1];
+		work.boundingSphere.center.z = bounds.center[2];
+		work.boundingSphere.radius = bounds.radius;
+		work.cone.apex.x = bounds.cone_apex[0];
+		work.cone.apex.y = bounds.cone_apex[1];
+		work.cone.apex.z = bounds.cone_apex[2];
+		work.cone.axis.x = bounds.cone_axis[0];
+		work.cone.axis.y = bounds.cone_axis[1];
+		work.cone.axis.z = bounds.cone_axis[2];
+		work.cone.cutoff = bounds.cone_cutoff;
+
+		DirectX::XMVECTOR aabbMin = DirectX::XMLoadFloat3(&this_vtx[0].pos);
+		DirectX::XMVECTOR aabbMax = DirectX::XMLoadFloat3(&this_vtx[0].pos);
+		for (auto&& v : this_vtx)
+		{
+			DirectX::XMVECTOR p = DirectX::XMLoadFloat3(&v.pos);
+			aabbMin = DirectX::XMVectorMin(aabbMin, p);
+			aabbMax = DirectX::XMVectorMax(aabbMax, p);
+		}
+		DirectX::XMStoreFloat3(&work.boundingBox.aabbMin, aabbMin);
+		DirectX::XMStoreFloat3(&work.boundingBox.aabbMax, aabbMax);
+
+		return work;
+	}
+
 }
 
 void MeshWork::BuildMeshlets(int maxVertices, int maxTriangles)
@@ -854,80 +917,308 @@ void MeshWork::BuildMeshlets(int maxVertices, int maxTriangles)
 				continue;
 			}
 
-			std::vector<Vertex> this_vtx;
-
-			// copy indices.
-			Meshlet work;
-			work.indexOffset = (uint32_t)submesh->meshletIndexBuffer_.size();
-			work.indexCount = meshlet.triangle_count * 3;
-			work.primitiveOffset = (uint32_t)submesh->meshletPackedPrimitive_.size();
-			work.primitiveCount = meshlet.triangle_count;
-			work.vertexIndexOffset = (uint32_t)submesh->meshletVertexIndexBuffer_.size();
-			work.vertexIndexCount = meshlet.vertex_count;
-			for (uint32_t i = 0; i < meshlet.triangle_count; i++)
+			auto work = AppendMeshlet(meshlet, submesh->vertexBuffer_, submesh->meshletIndexBuffer_, submesh->meshletPackedPrimitive_, submesh->meshletVertexIndexBuffer_);
+			submesh->meshlets_.push_back(work);
+		}
+
+		// check.
+		size_t count = submesh->indexBuffer_.size();
+		for (size_t i = 0; i < count; i++)
+		{
+			if (submesh->indexBuffer_[i] != submesh->meshletIndexBuffer_[i])
 			{
-				//uint32_t i0 = meshlet.indices[i][0];
-				//uint32_t i1 = meshlet.indices[i][1];
-				//uint32_t i2 = meshlet.indices[i][2];
-				uint32_t i0 = meshlet.indices[i * 3 + 0];
-				uint32_t i1 = meshlet.indices[i * 3 + 1];
-				uint32_t i2 = meshlet.indices[i * 3 + 2];
-
-				submesh->meshletIndexBuffer_.push_back(meshlet.vertices[i0]);
-				submesh->meshletIndexBuffer_.push_back(meshlet.vertices[i1]);
-				submesh->meshletIndexBuffer_.push_back(meshlet.vertices[i2]);
-
-				submesh->meshletPackedPrimitive_.push_back((i2 << 20) | (i1 << 10) | i0);
-
-				//this_vtx.push_back(submesh->vertexBuffer_[meshlet.vertices[meshlet.indices[i][0]]]);
-				//this_vtx.push_back(submesh->vertexBuffer_[meshlet.vertices[meshlet.indices[i][1]]]);
-				//this_vtx.push_back(submesh->vertexBuffer_[meshlet.vertices[meshlet.indices[i][2]]]);
-				this_vtx.push_back(submesh->vertexBuffer_[meshlet.vertices[meshlet.indices[i * 3 + 0]]]);
-				this_vtx.push_back(submesh->vertexBuffer_[meshlet.vertices[meshlet.indices[i * 3 + 1]]]);
-				this_vtx.push_back(submesh->vertexBuffer_[meshlet.vertices[meshlet.indices[i * 3 + 2]]]);
+				fprintf(stderr, "There is a difference between index buffer and meshlet index buffer.\n");
 			}
-			for (uint32_t i = 0; i < meshlet.vertex_count; i++)
+		}
+	}
+}
+
+void MeshWork::BuildLods(int maxLodCount, float ratio, float targetError, bool useSloppy)
+{
+	// stop if reduction is less than this.
+	static const float kMinReduction = 0.95f;
+
+	for (auto&& submesh : submeshes_)
+	{
+		submesh->lods_.clear();
+		if (submesh->indexBuffer_.empty())
+		{
+			continue;
+		}
+
+		const float* positions = &submesh->vertexBuffer_[0].pos.x;
+		const size_t vertexCount = submesh->vertexBuffer_.size();
+		const float scale = meshopt_simplifyScale(positions, vertexCount, sizeof(Vertex));
+
+		const std::vector<uint32_t>* prevIndices = &submesh->indexBuffer_;
+		float prevError = 0.0f;
+		for (int lod = 1; lod <= maxLodCount; lod++)
+		{
+			size_t targetCount = (size_t)((float)prevIndices->size() * ratio) / 3 * 3;
+			if (targetCount < 3)
 			{
-				submesh->meshletVertexIndexBuffer_.push_back(meshlet.vertices[i]);
+				break;
 			}
 
-			// compute bounds.
-			//auto bounds = meshopt_computeMeshletBounds(&meshlet, &submesh->vertexBuffer_[0].pos.x, submesh->vertexBuffer_.size(), sizeof(Vertex));
-			auto bounds = modify_computeMeshletBounds(&meshlet, &submesh->vertexBuffer_[0].pos.x, submesh->vertexBuffer_.size(), sizeof(Vertex));
-			work.boundingSphere.center.x = bounds.center[0];
-			work.boundingSphere.center.y = bounds.center[1];
-			work.boundingSphere.center.z = bounds.center[2];
-			work.boundingSphere.radius = bounds.radius;
-			work.cone.apex.x = bounds.cone_apex[0];
-			work.cone.apex.y = bounds.cone_apex[1];
-			work.cone.apex.z = bounds.cone_apex[2];
-			work.cone.axis.x = bounds.cone_axis[0];
-			work.cone.axis.y = bounds.cone_axis[1];
-			work.cone.axis.z = bounds.cone_axis[2];
-			work.cone.cutoff = bounds.cone_cutoff;
-
-			DirectX::XMVECTOR aabbMin = DirectX::XMLoadFloat3(&this_vtx[0].pos);
-			DirectX::XMVECTOR aabbMax = DirectX::XMLoadFloat3(&this_vtx[0].pos);
-			for (auto&& v : this_vtx)
+			LodWork work;
+			work.indexBuffer.resize(prevIndices->size());
+			float resultError = 0.0f;
+			size_t count = meshopt_simplify(work.indexBuffer.data(), prevIndices->data(), prevIndices->size(), positions, vertexCount, sizeof(Vertex), targetCount, targetError, 0, &resultError);
+			if (useSloppy && (float)count > (float)prevIndices->size() * kMinReduction)
 			{
-				DirectX::XMVECTOR p = DirectX::XMLoadFloat3(&v.pos);
-				aabbMin = DirectX::XMVectorMin(aabbMin, p);
-				aabbMax = DirectX::XMVectorMax(aabbMax, p);
+				// topology preserving simplification is stuck. ignore topology.
+				count = meshopt_simplifySloppy(work.indexBuffer.data(), prevIndices->data(), prevIndices->size(), positions, vertexCount, sizeof(Vertex), targetCount, targetError, &resultError);
+			}
+			if (count == 0 || (float)count > (float)prevIndices->size() * kMinReduction)
+			{
+				break;
 			}
-			DirectX::XMStoreFloat3(&work.boundingBox.aabbMin, aabbMin);
-			DirectX::XMStoreFloat3(&work.boundingBox.aabbMax, aabbMax);
+			work.indexBuffer.resize(count);
+			meshopt_optimizeVertexCache(work.indexBuffer.data(), work.indexBuffer.data(), count, vertexCount);
 
-			submesh->meshlets_.push_back(work);
+			// each level is simplified from previous level, so error is accumulated from LOD0.
+			work.error = prevError + resultError * scale;
+			prevError = work.error;
+
+			submesh->lods_.push_back(std::move(work));
+			prevIndices = &submesh->lods_.back().indexBuffer;
 		}
+	}
+}
 
-		// check.
-		size_t count = submesh->indexBuffer_.size();
-		for (size_t i = 0; i < count; i++)
+namespace
+{
+	// bounding sphere of spheres.
+	BoundSphere MergeSpheres(const std::vector<BoundSphere>& spheres)
+	{
+		BoundSphere ret = spheres[0];
+		for (size_t i = 1; i < spheres.size(); i++)
 		{
-			if (submesh->indexBuffer_[i] != submesh->meshletIndexBuffer_[i])
+			auto&& s = spheres[i];
+			DirectX::XMVECTOR c0 = DirectX::XMLoadFloat3(&ret.center);
+			DirectX::XMVECTOR c1 = DirectX::XMLoadFloat3(&s.center);
+			float d = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(c1, c0)));
+			if (d + s.radius <= ret.radius)
 			{
-				fprintf(stderr, "There is a difference between index buffer and meshlet index buffer.\n");
+				continue;
+			}
+			if (d + ret.radius <= s.radius)
+			{
+				ret = s;
+				continue;
+			}
+			float r = (d + ret.radius + s.radius) * 0.5f;
+			DirectX::XMStoreFloat3(&ret.center, DirectX::XMVectorLerp(c0, c1, (r - ret.radius) / d));
+			ret.radius = r;
+		}
+		return ret;
+	}
+
+	// map vertices on same position to one index.
+	// attribute seams must not split cluster adjacency.
+	std::vector<uint32_t> BuildPositionRemap(const std::vector<Vertex>& vertices)
+	{
+		std::vector<uint32_t> order(vertices.size());
+		for (uint32_t i = 0; i < (uint32_t)order.size(); i++)
+		{
+			order[i] = i;
+		}
+		auto Less = [&](uint32_t l, uint32_t r)
+		{
+			auto&& pl = vertices[l].pos;
+			auto&& pr = vertices[r].pos;
+			if (pl.x != pr.x) return pl.x < pr.x;
+			if (pl.y != pr.y) return pl.y < pr.y;
+			return pl.z < pr.z;
+		};
+		std::sort(order.begin(), order.end(), Less);
+
+		std::vector<uint32_t> remap(vertices.size());
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			bool same = (i > 0) && !Less(order[i - 1], order[i]) && !Less(order[i], order[i - 1]);
+			remap[order[i]] = same ? remap[order[i - 1]] : order[i];
+		}
+		return remap;
+	}
+
+	// greedy grouping of clusters sharing most edges.
+	std::vector<std::vector<uint32_t>> GroupClusters(const SubmeshWork& submesh, const std::vector<uint32_t>& clusterIds, const std::vector<uint32_t>& remap, size_t groupSize)
+	{
+		auto&& clusters = submesh.GetClusters();
+		auto&& indices = submesh.GetClusterIndexBuffer();
+
+		// count shared edges between clusters.
+		std::vector<std::map<uint32_t, uint32_t>> adjacency(clusterIds.size());
+		std::map<uint64_t, uint32_t> edgeOwner;
+		for (uint32_t c = 0; c < (uint32_t)clusterIds.size(); c++)
+		{
+			auto&& meshlet = clusters[clusterIds[c]].meshlet;
+			for (uint32_t t = 0; t < meshlet.indexCount; t += 3)
+			{
+				const uint32_t* tri = &indices[meshlet.indexOffset + t];
+				for (int e = 0; e < 3; e++)
+				{
+					uint32_t v0 = remap[tri[e]];
+					uint32_t v1 = remap[tri[(e + 1) % 3]];
+					uint64_t key = ((uint64_t)std::min(v0, v1) << 32) | std::max(v0, v1);
+					auto it = edgeOwner.find(key);
+					if (it == edgeOwner.end())
+					{
+						edgeOwner[key] = c;
+					}
+					else if (it->second != c)
+					{
+						adjacency[c][it->second]++;
+						adjacency[it->second][c]++;
+					}
+				}
+			}
+		}
+
+		std::vector<std::vector<uint32_t>> groups;
+		std::vector<bool> grouped(clusterIds.size(), false);
+		for (uint32_t seed = 0; seed < (uint32_t)clusterIds.size(); seed++)
+		{
+			if (grouped[seed])
+			{
+				continue;
+			}
+
+			std::vector<uint32_t> group;
+			group.push_back(seed);
+			grouped[seed] = true;
+			while (group.size() < groupSize)
+			{
+				std::map<uint32_t, uint32_t> score;
+				for (auto&& member : group)
+				{
+					for (auto&& adj : adjacency[member])
+					{
+						if (!grouped[adj.first])
+						{
+							score[adj.first] += adj.second;
+						}
+					}
+				}
+				if (score.empty())
+				{
+					break;
+				}
+				auto best = std::max_element(score.begin(), score.end(),
+					[](const std::pair<const uint32_t, uint32_t>& l, const std::pair<const uint32_t, uint32_t>& r) { return l.second < r.second; });
+				group.push_back(best->first);
+				grouped[best->first] = true;
+			}
+
+			for (auto&& member : group)
+			{
+				member = clusterIds[member];
+			}
+			groups.push_back(group);
+		}
+		return groups;
+	}
+}
+
+void MeshWork::BuildClusterDag(int maxVertices, int maxTriangles, int groupSize)
+{
+	// group is not simplified if reduction is less than this.
+	static const float kMinReduction = 0.85f;
+	static const uint32_t kMaxLevel = 32;
+
+	for (auto&& submesh : submeshes_)
+	{
+		submesh->clusters_.clear();
+		submesh->clusterIndexBuffer_.clear();
+		submesh->clusterPackedPrimitive_.clear();
+		submesh->clusterVertexIndexBuffer_.clear();
+		if (submesh->indexBuffer_.empty())
+		{
+			continue;
+		}
+
+		const float* positions = &submesh->vertexBuffer_[0].pos.x;
+		const size_t vertexCount = submesh->vertexBuffer_.size();
+		const float scale = meshopt_simplifyScale(positions, vertexCount, sizeof(Vertex));
+		auto remap = BuildPositionRemap(submesh->vertexBuffer_);
+
+		// split index buffer to clusters.
+		auto BuildClusters = [&](const std::vector<uint32_t>& indices, uint32_t level, const ClusterLodWork* pLod)
+		{
+			std::vector<modify_Meshlet> meshlets;
+			meshlets.resize(meshopt_buildMeshletsBound(indices.size(), (size_t)maxVertices, (size_t)maxTriangles));
+			size_t count = modify_buildMeshlets(meshlets.data(), indices.data(), indices.size(), vertexCount, (size_t)maxVertices, (size_t)maxTriangles);
+
+			std::vector<uint32_t> ret;
+			for (size_t i = 0; i < count; i++)
+			{
+				ClusterWork work;
+				work.meshlet = AppendMeshlet(meshlets[i], submesh->vertexBuffer_, submesh->clusterIndexBuffer_, submesh->clusterPackedPrimitive_, submesh->clusterVertexIndexBuffer_);
+				work.level = level;
+				if (pLod)
+				{
+					work.lod = *pLod;
+				}
+				else
+				{
+					work.lod.sphere = work.meshlet.boundingSphere;
+					work.lod.error = 0.0f;
+				}
+				work.parentLod.sphere = work.lod.sphere;
+				work.parentLod.error = FLT_MAX;
+
+				ret.push_back((uint32_t)submesh->clusters_.size());
+				submesh->clusters_.push_back(work);
+			}
+			return ret;
+		};
+
+		auto current = BuildClusters(submesh->indexBuffer_, 0, nullptr);
+		for (uint32_t level = 0; level < kMaxLevel && current.size() > 1; level++)
+		{
+			auto groups = GroupClusters(*submesh, current, remap, (size_t)groupSize);
+
+			std::vector<uint32_t> next;
+			for (auto&& group : groups)
+			{
+				std::vector<uint32_t> merged;
+				std::vector<BoundSphere> spheres;
+				float childError = 0.0f;
+				for (auto&& id : group)
+				{
+					auto&& meshlet = submesh->clusters_[id].meshlet;
+					auto it = submesh->clusterIndexBuffer_.begin() + meshlet.indexOffset;
+					merged.insert(merged.end(), it, it + meshlet.indexCount);
+					spheres.push_back(submesh->clusters_[id].lod.sphere);
+					childError = std::max(childError, submesh->clusters_[id].lod.error);
+				}
+
+				// group border is the border of merged index buffer, and locked to keep the mesh crack-free.
+				std::vector<uint32_t> simplified(merged.size());
+				size_t targetCount = merged.size() / 6 * 3;
+				float resultError = 0.0f;
+				size_t count = meshopt_simplify(simplified.data(), merged.data(), merged.size(), positions, vertexCount, sizeof(Vertex), targetCount, FLT_MAX, meshopt_SimplifyLockBorder, &resultError);
+				if (count == 0 || (float)count > (float)merged.size() * kMinReduction)
+				{
+					// clusters of this group are roots.
+					continue;
+				}
+				simplified.resize(count);
+
+				// parent error must not be less than children error.
+				ClusterLodWork parentLod;
+				parentLod.sphere = MergeSpheres(spheres);
+				parentLod.error = childError + resultError * scale;
+				for (auto&& id : group)
+				{
+					submesh->clusters_[id].parentLod = parentLod;
+				}
+
+				auto ids = BuildClusters(simplified, level + 1, &parentLod);
+				next.insert(next.end(), ids.begin(), ids.end());
 			}
+			current.swap(next);
 		}
 	}
 }
@@ -55,6 +55,26 @@ struct Meshlet
 	Cone					cone;
 };	// struct Meshlet
 
+struct LodWork
+{
+	std::vector<uint32_t>	indexBuffer;
+	float					error;			// simplification error in object space.
+};	// struct LodWork
+
+struct ClusterLodWork
+{
+	BoundSphere				sphere;
+	float					error;			// simplification error in object space.
+};	// struct ClusterLodWork
+
+struct ClusterWork
+{
+	Meshlet					meshlet;		// offsets are in cluster buffers.
+	uint32_t				level;			// 0 is the finest.
+	ClusterLodWork			lod;			// bounds of the group this cluster is simplified from.
+	ClusterLodWork			parentLod;		// bounds of the group this cluster is simplified into. error is FLT_MAX for root.
+};	// struct ClusterWork
+
 struct NodeWork
 {
 	DirectX::XMFLOAT4X4		transformLocal;
@@ -105,6 +125,26 @@ public:
 	{
 		return meshlets_;
 	}
+	const std::vector<LodWork>& GetLods() const
+	{
+		return lods_;
+	}
+	const std::vector<ClusterWork>& GetClusters() const
+	{
+		return clusters_;
+	}
+	const std::vector<uint32_t>& GetClusterIndexBuffer() const
+	{
+		return clusterIndexBuffer_;
+	}
+	const std::vector<uint32_t>& GetClusterPackedPrimitive() const
+	{
+		return clusterPackedPrimitive_;
+	}
+	const std::vector<uint32_t>& GetClusterVertexIndexBuffer() const
+	{
+		return clusterVertexIndexBuffer_;
+	}
 
 private:
 	int						materialIndex_;
@@ -117,6 +157,13 @@ private:
 	std::vector<uint32_t>	meshletIndexBuffer_;
 	std::vector<uint32_t>	meshletPackedPrimitive_;
 	std::vector<uint32_t>	meshletVertexIndexBuffer_;
+
+	std::vector<LodWork>	lods_;		// LOD1 and coarser.
+
+	std::vector<ClusterWork>	clusters_;
+	std::vector<uint32_t>		clusterIndexBuffer_;
+	std::vector<uint32_t>		clusterPackedPrimitive_;
+	std::vector<uint32_t>		clusterVertexIndexBuffer_;
 };	// class SubmeshWork
 
 class MaterialWork
@@ -231,6 +278,14 @@ public:
 
 	void BuildMeshlets(int maxVertices, int maxTriangles);
 
+	// build lod chain from LOD0 index buffer.
+	// each level targets (previous triangle count * ratio) within relative error targetError.
+	void BuildLods(int maxLodCount, float ratio, float targetError, bool useSloppy);
+
+	// build cluster dag.
+	// neighboring clusters are grouped, simplified to half with locked group border, and split to clusters again.
+	void BuildClusterDag(int maxVertices, int maxTriangles, int groupSize);
+
 	const std::vector<std::unique_ptr<MaterialWork>>& GetMaterials() const
 	{
 		return materials_;
@@ -0,0 +1,275 @@
+﻿#include "mesh_writer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+#include "mesh_work.h"
+
+
+namespace
+{
+	sl12::ResourceMeshFileString AddString(std::string& table, const std::string& str)
+	{
+		sl12::ResourceMeshFileString ret;
+		ret.offset = (sl12::u32)table.size();
+		ret.length = (sl12::u32)str.size();
+		table += str;
+		return ret;
+	}
+
+	// encode stream with stream header. if encoded data is not smaller, raw data is stored.
+	std::vector<sl12::u8> EncodeStream(const std::vector<sl12::u8>& src, sl12::ResourceMeshStreamCodec::Type codec, size_t elementSize, size_t vertexCount)
+	{
+		std::vector<sl12::u8> ret;
+		if (src.empty())
+		{
+			return ret;
+		}
+
+		size_t count = src.size() / elementSize;
+		std::vector<sl12::u8> encoded;
+		size_t encodedSize = 0;
+		switch (codec)
+		{
+		case sl12::ResourceMeshStreamCodec::Vertex:
+			encoded.resize(meshopt_encodeVertexBufferBound(count, elementSize));
+			encodedSize = meshopt_encodeVertexBuffer(encoded.data(), encoded.size(), src.data(), count, elementSize);
+			break;
+		case sl12::ResourceMeshStreamCodec::VertexOct:
+			{
+				// snorm8x4 to float, and encode octahedral.
+				std::vector<float> vec(count * 4);
+				for (size_t i = 0; i < vec.size(); i++)
+				{
+					vec[i] = std::max((float)(sl12::s8)src[i] / 127.0f, -1.0f);
+				}
+				std::vector<sl12::u8> filtered(src.size());
+				meshopt_encodeFilterOct(filtered.data(), count, elementSize, 8, vec.data());
+				encoded.resize(meshopt_encodeVertexBufferBound(count, elementSize));
+				encodedSize = meshopt_encodeVertexBuffer(encoded.data(), encoded.size(), filtered.data(), count, elementSize);
+			}
+			break;
+		case sl12::ResourceMeshStreamCodec::IndexBuffer:
+			encoded.resize(meshopt_encodeIndexBufferBound(count, vertexCount));
+			encodedSize = meshopt_encodeIndexBuffer(encoded.data(), encoded.size(), reinterpret_cast<const unsigned int*>(src.data()), count);
+			break;
+		case sl12::ResourceMeshStreamCodec::IndexSequence:
+			encoded.resize(meshopt_encodeIndexSequenceBound(count, vertexCount));
+			encodedSize = meshopt_encodeIndexSequence(encoded.data(), encoded.size(), reinterpret_cast<const unsigned int*>(src.data()), count);
+			break;
+		default:
+			break;
+		}
+
+		sl12::ResourceMeshStreamHeader header{};
+		header.elementSize = (sl12::u32)elementSize;
+		header.elementCount = count;
+		const sl12::u8* pPayload = src.data();
+		size_t payloadSize = src.size();
+		if (encodedSize > 0 && encodedSize < src.size())
+		{
+			header.codec = codec;
+			pPayload = encoded.data();
+			payloadSize = encodedSize;
+		}
+		else
+		{
+			header.codec = sl12::ResourceMeshStreamCodec::None;
+		}
+
+		ret.resize(sizeof(header) + payloadSize);
+		memcpy(ret.data(), &header, sizeof(header));
+		memcpy(ret.data() + sizeof(header), pPayload, payloadSize);
+		return ret;
+	}
+
+	sl12::ResourceMeshFileMeshlet ConvertMeshlet(const sl12::ResourceMeshMeshlet& let)
+	{
+		sl12::ResourceMeshFileMeshlet m{};
+		m.indexOffset = let.indexOffset_;
+		m.indexCount = let.indexCount_;
+		m.primitiveOffset = let.primitiveOffset_;
+		m.primitiveCount = let.primitiveCount_;
+		m.vertexIndexOffset = let.vertexIndexOffset_;
+		m.vertexIndexCount = let.vertexIndexCount_;
+		m.boundingSphere = let.boundingSphere_;
+		m.boundingBox = let.boundingBox_;
+		m.cone = let.cone_;
+		return m;
+	}
+
+	sl12::u64 AlignBlob(sl12::u64 offset)
+	{
+		const sl12::u64 kAlign = sl12::ResourceMeshFileHeader::kBlobAlignment;
+		return (offset + kAlign - 1) / kAlign * kAlign;
+	}
+}
+
+bool WriteMeshV1(const sl12::ResourceMesh& mesh, const std::string& outputFilePath)
+{
+	std::fstream ofs(outputFilePath, std::ios::out | std::ios::binary);
+	if (!ofs.is_open())
+	{
+		return false;
+	}
+	cereal::BinaryOutputArchive ar(ofs);
+	ar(cereal::make_nvp("mesh", mesh));
+	return true;
+}
+
+bool WriteMeshV2(const sl12::ResourceMesh& mesh, const std::string& outputFilePath, int compression)
+{
+	// create tables.
+	std::string strings;
+	std::vector<sl12::ResourceMeshFileMaterial> materials;
+	std::vector<sl12::ResourceMeshFileSubmesh> submeshes;
+	std::vector<sl12::ResourceMeshFileMeshlet> meshlets;
+	std::vector<sl12::ResourceMeshFileLod> lods;
+	std::vector<sl12::ResourceMeshFileCluster> clusters;
+
+	for (auto&& src : mesh.materials_)
+	{
+		sl12::ResourceMeshFileMaterial dst{};
+		dst.name = AddString(strings, src.name_);
+		for (size_t t = 0; t < sl12::ResourceMeshFileMaterial::kTextureCount && t < src.textureNames_.size(); t++)
+		{
+			dst.textureNames[t] = AddString(strings, src.textureNames_[t]);
+		}
+		dst.baseColor[0] = src.baseColorR_;
+		dst.baseColor[1] = src.baseColorG_;
+		dst.baseColor[2] = src.baseColorB_;
+		dst.baseColor[3] = src.baseColorA_;
+		dst.emissiveColor[0] = src.emissiveColorR_;
+		dst.emissiveColor[1] = src.emissiveColorG_;
+		dst.emissiveColor[2] = src.emissiveColorB_;
+		dst.roughness = src.roughness_;
+		dst.metallic = src.metallic_;
+		dst.blendType = src.blendType_;
+		dst.cullMode = src.cullMode_;
+		materials.push_back(dst);
+	}
+
+	for (auto&& src : mesh.submeshes_)
+	{
+		sl12::ResourceMeshFileSubmesh dst{};
+		dst.materialIndex = src.materialIndex_;
+		dst.vertexOffset = src.vertexOffset_;
+		dst.vertexCount = src.vertexCount_;
+		dst.indexOffset = src.indexOffset_;
+		dst.indexCount = src.indexCount_;
+		dst.meshletPrimitiveOffset = src.meshletPrimitiveOffset_;
+		dst.meshletPrimitiveCount = src.meshletPrimitiveCount_;
+		dst.meshletVertexIndexOffset = src.meshletVertexIndexOffset_;
+		dst.meshletVertexIndexCount = src.meshletVertexIndexCount_;
+		dst.meshletOffset = (sl12::u32)meshlets.size();
+		dst.meshletCount = (sl12::u32)src.meshlets_.size();
+		dst.boundingSphere = src.boundingSphere_;
+		dst.boundingBox = src.boundingBox_;
+		submeshes.push_back(dst);
+
+		for (auto&& let : src.meshlets_)
+		{
+			meshlets.push_back(ConvertMeshlet(let));
+		}
+
+		for (auto&& lod : src.lods_)
+		{
+			sl12::ResourceMeshFileLod l{};
+			l.submeshIndex = (sl12::u32)(submeshes.size() - 1);
+			l.indexOffset = lod.indexOffset;
+			l.indexCount = lod.indexCount;
+			l.error = lod.error;
+			lods.push_back(l);
+		}
+
+		for (auto&& cluster : src.clusters_)
+		{
+			sl12::ResourceMeshFileCluster c{};
+			c.submeshIndex = (sl12::u32)(submeshes.size() - 1);
+			c.level = cluster.level;
+			c.meshlet = ConvertMeshlet(cluster.meshlet);
+			c.lod = cluster.lod;
+			c.parentLod = cluster.parentLod;
+			clusters.push_back(c);
+		}
+	}
+
+	// layout blobs.
+	struct BlobSource
+	{
+		const void*	pData;
+		size_t		size;
+	};
+	BlobSource sources[sl12::ResourceMeshBlobType::Max];
+	sources[sl12::ResourceMeshBlobType::Material] = { materials.data(), sizeof(materials[0]) * materials.size() };
+	sources[sl12::ResourceMeshBlobType::Submesh] = { submeshes.data(), sizeof(submeshes[0]) * submeshes.size() };
+	sources[sl12::ResourceMeshBlobType::Meshlet] = { meshlets.data(), sizeof(meshlets[0]) * meshlets.size() };
+	sources[sl12::ResourceMeshBlobType::String] = { strings.data(), strings.size() };
+	sources[sl12::ResourceMeshBlobType::Position] = { mesh.vbPosition_.data(), mesh.vbPosition_.size() };
+	sources[sl12::ResourceMeshBlobType::Normal] = { mesh.vbNormal_.data(), mesh.vbNormal_.size() };
+	sources[sl12::ResourceMeshBlobType::Tangent] = { mesh.vbTangent_.data(), mesh.vbTangent_.size() };
+	sources[sl12::ResourceMeshBlobType::Texcoord] = { mesh.vbTexcoord_.data(), mesh.vbTexcoord_.size() };
+	sources[sl12::ResourceMeshBlobType::Index] = { mesh.indexBuffer_.data(), mesh.indexBuffer_.size() };
+	sources[sl12::ResourceMeshBlobType::MeshletPackedPrimitive] = { mesh.meshletPackedPrimitive_.data(), mesh.meshletPackedPrimitive_.size() };
+	sources[sl12::ResourceMeshBlobType::MeshletVertexIndex] = { mesh.meshletVertexIndex_.data(), mesh.meshletVertexIndex_.size() };
+	sources[sl12::ResourceMeshBlobType::Lod] = { lods.data(), sizeof(sl12::ResourceMeshFileLod) * lods.size() };
+	sources[sl12::ResourceMeshBlobType::Cluster] = { clusters.data(), sizeof(sl12::ResourceMeshFileCluster) * clusters.size() };
+
+	// compress streams.
+	std::vector<sl12::u8> encodedStreams[sl12::ResourceMeshBlobType::Max];
+	if (compression > 0)
+	{
+		size_t vertexCount = mesh.vbPosition_.size() / (sizeof(sl12::u16) * 4);
+		auto normalCodec = (compression > 1) ? sl12::ResourceMeshStreamCodec::VertexOct : sl12::ResourceMeshStreamCodec::Vertex;
+		encodedStreams[sl12::ResourceMeshBlobType::Position] = EncodeStream(mesh.vbPosition_, sl12::ResourceMeshStreamCodec::Vertex, sizeof(sl12::u16) * 4, vertexCount);
+		encodedStreams[sl12::ResourceMeshBlobType::Normal] = EncodeStream(mesh.vbNormal_, normalCodec, sizeof(sl12::u32), vertexCount);
+		encodedStreams[sl12::ResourceMeshBlobType::Tangent] = EncodeStream(mesh.vbTangent_, normalCodec, sizeof(sl12::u32), vertexCount);
+		encodedStreams[sl12::ResourceMeshBlobType::Texcoord] = EncodeStream(mesh.vbTexcoord_, sl12::ResourceMeshStreamCodec::Vertex, sizeof(sl12::u16) * 2, vertexCount);
+		encodedStreams[sl12::ResourceMeshBlobType::Index] = EncodeStream(mesh.indexBuffer_, sl12::ResourceMeshStreamCodec::IndexBuffer, sizeof(sl12::u32), vertexCount);
+		encodedStreams[sl12::ResourceMeshBlobType::MeshletPackedPrimitive] = EncodeStream(mesh.meshletPackedPrimitive_, sl12::ResourceMeshStreamCodec::Vertex, sizeof(sl12::u32), vertexCount);
+		encodedStreams[sl12::ResourceMeshBlobType::MeshletVertexIndex] = EncodeStream(mesh.meshletVertexIndex_, sl12::ResourceMeshStreamCodec::IndexSequence, sizeof(sl12::u32), vertexCount);
+		for (int i = sl12::ResourceMeshBlobType::StreamBegin; i < sl12::ResourceMeshBlobType::StreamEnd; i++)
+		{
+			sources[i] = { encodedStreams[i].data(), encodedStreams[i].size() };
+		}
+	}
+
+	sl12::ResourceMeshFileHeader header{};
+	header.magic = sl12::ResourceMeshFileHeader::kMagic;
+	header.version = sl12::ResourceMeshFileHeader::kVersion;
+	header.materialCount = (sl12::u32)materials.size();
+	header.submeshCount = (sl12::u32)submeshes.size();
+	header.meshletCount = (sl12::u32)meshlets.size();
+	header.flags = (compression > 0) ? sl12::ResourceMeshFileFlag::CompressedStreams : 0;
+	header.boundingSphere = mesh.boundingSphere_;
+	header.boundingBox = mesh.boundingBox_;
+
+	sl12::u64 offset = AlignBlob(sizeof(header));
+	for (int i = 0; i < sl12::ResourceMeshBlobType::Max; i++)
+	{
+		header.blobs[i].offset = offset;
+		header.blobs[i].size = sources[i].size;
+		offset = AlignBlob(offset + sources[i].size);
+	}
+
+	// write.
+	std::fstream ofs(outputFilePath, std::ios::out | std::ios::binary);
+	if (!ofs.is_open())
+	{
+		return false;
+	}
+	std::vector<char> padding(sl12::ResourceMeshFileHeader::kBlobAlignment, 0);
+	sl12::u64 written = sizeof(header);
+	ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	for (int i = 0; i < sl12::ResourceMeshBlobType::Max; i++)
+	{
+		ofs.write(padding.data(), header.blobs[i].offset - written);
+		if (sources[i].size)
+		{
+			ofs.write(reinterpret_cast<const char*>(sources[i].pData), sources[i].size);
+		}
+		written = header.blobs[i].offset + sources[i].size;
+	}
+	return true;
+}
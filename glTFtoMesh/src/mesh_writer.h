@@ -0,0 +1,15 @@
+﻿#pragma once
+#include <string>
+
+namespace sl12
+{
+	class ResourceMesh;
+}
+
+// v1 : cereal binary archive. lods are not stored.
+bool WriteMeshV1(const sl12::ResourceMesh& mesh, const std::string& outputFilePath);
+// v2 : fixed header and aligned blobs. loaded in place.
+// compression 0 : raw streams.
+// compression 1 : meshopt vertex/index codecs. (lossless)
+// compression 2 : 1 and octahedral filter for normal and tangent.
+bool WriteMeshV2(const sl12::ResourceMesh& mesh, const std::string& outputFilePath, int compression = 0);